@@ -0,0 +1,58 @@
+#ifndef CLOCK_CLASS_H
+#define CLOCK_CLASS_H
+
+#include <chrono>
+
+// Source of time for the simulation, in seconds
+class Clock
+{
+public:
+    virtual ~Clock() = default;
+    virtual double Now() = 0;
+};
+
+// Wall clock time since the clock was created
+class SystemClock : public Clock
+{
+public:
+    SystemClock();
+    double Now() override;
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// Time only moves when Advance is called, so runs can be replayed exactly (benchmarks)
+class ManualClock : public Clock
+{
+public:
+    double Now() override { return time; }
+    void Advance(double seconds) { time += seconds; }
+
+private:
+    double time = 0.0;
+};
+
+// Splits the time elapsed on a clock into steps of constant length for the simulation,
+// the remainder is what the rendering interpolates with
+class FixedTimestep
+{
+public:
+    FixedTimestep(Clock &clock, double step = 1.0 / 60.0, int maxSteps = 5);
+
+    // Returns how many steps to simulate to catch up with the clock, at most maxSteps
+    int Advance();
+    // Length of a step in seconds
+    float Step() const { return (float)step; }
+    // How far the clock is between the last simulated step and the next one, from 0 to 1
+    float Alpha() const { return (float)(accumulator / step); }
+
+private:
+    Clock &clock;
+    double step;
+    int maxSteps;
+    double last;
+    double accumulator = 0.0;
+};
+
+#endif
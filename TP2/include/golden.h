@@ -0,0 +1,54 @@
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include "glTrace.h"
+#include <string>
+#include <vector>
+
+// 8 bits RGB image, first row at the top
+struct RGBImage
+{
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> pixels;
+};
+
+// Binary PPM (P6), the format the references are stored in
+bool readPPM(const std::string& path, RGBImage& image);
+bool writePPM(const std::string& path, const RGBImage& image);
+
+// Averages blocks of factor x factor pixels, which also hides single pixel differences of the rasterization
+RGBImage downsample(const RGBImage& image, int factor);
+
+// Color and depth renderbuffers the golden frames are drawn into instead of the window
+class OffscreenTarget
+{
+public:
+	GLuint ID;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+	int width;
+	int height;
+
+	OffscreenTarget(int width, int height);
+
+	bool Complete();
+	void Bind();
+	// Reads the color back (the GPU finishes the frame first)
+	RGBImage Read();
+	void Delete();
+};
+
+// Pixels further apart than threshold (0 to 1) in the YIQ color space, which weights the differences
+// the way the eye sees them, and the largest of these distances
+struct ImageDifference
+{
+	long long differentPixels = 0;
+	double maxDistance = 0.0;
+};
+ImageDifference compareImages(const RGBImage& a, const RGBImage& b, double threshold);
+
+// Compares image with the reference file, or replaces the reference with update.
+// Passes if at most maxDifferent of the pixels differ; otherwise writes the image next to the reference (.actual.ppm)
+bool checkGolden(const RGBImage& image, const std::string& reference, bool update, double threshold = 0.1, double maxDifferent = 0.001);
+#endif
@@ -1,7 +1,8 @@
 #include <iostream>
-#include <GL/glew.h>
+#include "glTrace.h"
 #include <GLFW/glfw3.h>
 #include <math.h>
+#include <string>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -12,6 +13,8 @@
 #include "VBO.h"
 #include "EBO.h"
 #include "camera.h"
+#include "clock.h"
+#include "golden.h"
 
 /// constants for the camera
 const float FOV = 45.0f;
@@ -21,12 +24,36 @@ const float farPlane = 100.0f;
 const unsigned int width = 800;
 const unsigned int height = 800;
 
+// rotation of the pyramid in degrees per second
+const float rotationSpeed = 60.0f;
+
+// frame compared with the golden image, half a second into the rotation
+const int goldenFrames = 30;
+
 // use left mouse button to interact with the camera
 // use z, q, d, d to move the camera
 // use left control to move down
 // use space to move up
-
-int main(){
+// run with --deterministic to simulate exactly one step per frame whatever the frame rate
+// run with --gl-trace file.csv to write the GL calls of each frame to a file (built with -DGL_TRACE=ON)
+// run with --golden reference.ppm to render offscreen and compare with the reference (--golden-update rewrites it),
+// the exit code is 1 if they differ
+
+int main(int argc, char* argv[]){
+    bool deterministic = false;
+    const char* goldenPath = nullptr;
+    bool goldenUpdate = false;
+    for (int i = 1; i < argc; i++){
+        if (i + 1 < argc && std::string(argv[i]) == "--gl-trace" && !startGLTrace(argv[i + 1])){
+            std::cout<<"no GL trace written to "<<argv[i + 1]<<" (needs a GL_TRACE build)"<<std::endl;
+        }
+        if (i + 1 < argc && std::string(argv[i]) == "--golden"){
+            goldenPath = argv[i + 1];
+            deterministic = true;
+        }
+        deterministic = deterministic || std::string(argv[i]) == "--deterministic";
+        goldenUpdate = goldenUpdate || std::string(argv[i]) == "--golden-update";
+    }
 
     GLfloat verticies[] = {
         -0.5f, 0.0f,  0.5f,    0.83f, 0.70f, 0.44f,    
@@ -52,6 +79,9 @@ int main(){
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR,3);
     glfwWindowHint(GLFW_OPENGL_PROFILE,GLFW_OPENGL_CORE_PROFILE);
+    if (goldenPath != nullptr){
+        glfwWindowHint(GLFW_VISIBLE,GLFW_FALSE);
+    }
 
     
 
@@ -91,42 +121,87 @@ int main(){
 
    // create camera
    Camera camera(width, height, glm::vec3(0.0f, 0.5f, 3.0f), FOV, nearPlane, farPlane);
-   glm::mat4 modelMatrix = glm::mat4(1.0f);
+   float angle = 0.0f;
+   float previousAngle = 0.0f;
+
+   // the simulation runs at a fixed 60 steps per second, the rendering at whatever rate it can
+   SystemClock systemClock;
+   ManualClock manualClock;
+   Clock *clock = &systemClock;
+   if (deterministic)
+   {
+       clock = &manualClock;
+   }
+   FixedTimestep timestep(*clock);
+
+    OffscreenTarget* goldenTarget = nullptr;
+    bool goldenPassed = true;
+    int frames = 0;
+    if (goldenPath != nullptr){
+        goldenTarget = new OffscreenTarget(width, height);
+        if (!goldenTarget->Complete()){
+            std::cout<<"offscreen target not supported, no golden image check"<<std::endl;
+            goldenPassed = false;
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+        goldenTarget->Bind();
+    }
 
     while (!glfwWindowShouldClose(window))
     {
+        if (deterministic)
+        {
+            manualClock.Advance(timestep.Step());
+        }
+
+        for (int steps = timestep.Advance(); steps > 0; steps--)
+        {
+            camera.Inputs(window, timestep.Step());
+
+            //rotate the pyramid
+            previousAngle = angle;
+            angle += rotationSpeed * timestep.Step();
+        }
+        float alpha = timestep.Alpha();
+
         glClearColor(0.07f,0.13f,0.17f,1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         shaderProgram.Activate();
 
-        camera.Inputs(window);
-
-        // retrieve view and projection matrices
-        glm::mat4 viewMatrix = camera.getViewMatrix();
+        // retrieve view and projection matrices, between the two last steps
+        glm::mat4 viewMatrix = camera.getViewMatrix(alpha);
         glm::mat4 projectionMatrix = camera.getProjectionMatrix();
+        glm::mat4 modelMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(glm::mix(previousAngle, angle, alpha)), glm::vec3(0.0f, 1.0f, 0.0f));
 
         // pass matrices to shader
         glUniformMatrix4fv(glGetUniformLocation(shaderProgram.ID, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
         glUniformMatrix4fv(glGetUniformLocation(shaderProgram.ID, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
         glUniformMatrix4fv(glGetUniformLocation(shaderProgram.ID, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(viewMatrix));
 
-        //rotate the pyramid using model matrix
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-
         VAO1.Bind();
 
         glDrawElements(GL_TRIANGLES,sizeof(indices)/sizeof(int),GL_UNSIGNED_INT,0);
+        if (goldenTarget != nullptr && ++frames == goldenFrames){
+            goldenPassed = checkGolden(downsample(goldenTarget->Read(), 4), goldenPath, goldenUpdate);
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
         glfwSwapBuffers(window);
 
         glfwPollEvents();
+        endGLTraceFrame();
     }
+    printGLTraceSummary();
 
     VAO1.Delete();
     VBO1.Delete();
     EBO1.Delete();
     shaderProgram.Delete();    
+    if (goldenTarget != nullptr){
+        goldenTarget->Delete();
+        delete goldenTarget;
+    }
 
     glfwDestroyWindow(window);
     glfwTerminate();
-    return 0;
+    return goldenPassed ? 0 : 1;
 }
\ No newline at end of file
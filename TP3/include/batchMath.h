@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Axis aligned box
+struct AABB
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Array versions of the glm operations the scene graph runs the most, using SSE or AVX2 + FMA
+// depending on what the CPU supports (checked once at startup), plain glm otherwise.
+// Output arrays may alias the inputs.
+
+// out[i] = a[i] * b[i]
+void multiply_matrices(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *out, size_t count);
+// out[i] = parent * b[i], children of one node
+void multiply_matrices(const glm::mat4 &parent, const glm::mat4 *b, glm::mat4 *out, size_t count);
+// out[i] = m * vec4(in[i], 1), m being affine
+void transform_points(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count);
+// out[i] = smallest box holding the box in[i] transformed by the affine m
+void transform_aabbs(const glm::mat4 &m, const AABB *in, AABB *out, size_t count);
+
+// name of the instruction set the functions above run with
+const char *batch_math_instruction_set();
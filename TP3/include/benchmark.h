@@ -0,0 +1,10 @@
+#pragma once
+
+#include "shaderClass.h"
+
+// times the batch math kernels against plain glm loops, from 1k to 1M elements
+void benchmark_math();
+
+// times the recording of a tree of about 37k shapes into command buffers, on one thread then from 1 to N workers,
+// and its submission replayed against the immediate traversal; needs a context
+void benchmark_recording(Shader &shader);
@@ -1,7 +1,7 @@
 #ifndef CAMERA_CLASS_H
 #define CAMERA_CLASS_H
 
-#include <GL/glew.h>
+#include "glTrace.h"
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -18,6 +18,10 @@ public:
     glm::vec3 Orientation = glm::vec3(0.0f, 0.0f, -1.0f);
     glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
 
+    // state before the last Inputs step, the view is interpolated from it
+    glm::vec3 PreviousPosition;
+    glm::vec3 PreviousOrientation = glm::vec3(0.0f, 0.0f, -1.0f);
+
     float FOV;
     float nearPlane;
     float farPlane;
@@ -26,22 +30,47 @@ public:
 
     bool firstClick = true;
 
-    float speed = 0.1f;
+    // in units per second
+    float speed = 6.0f;
     float sensitivity = 100.0f;
 
     Camera(int width, int height, glm::vec3 position, float FOV, float nearPlane, float farPlane);
 
-    void Inputs(GLFWwindow *window);
+    // moves the camera by one simulation step of dt seconds
+    void Inputs(GLFWwindow *window, float dt);
+
+    // matrices are cached and only rebuilt when the values they come from change,
+    // alpha blends between the two last steps, 1 being the latest one
+    const glm::mat4 &getViewMatrix(float alpha = 1.0f);
+    const glm::mat4 &getProjectionMatrix();
+    const glm::mat4 &getViewProjectionMatrix(float alpha = 1.0f);
+    const glm::mat4 &getInverseViewProjectionMatrix(float alpha = 1.0f);
+    // left, right, bottom, top, near and far planes (xyz normal pointing inside, w distance)
+    const glm::vec4 *getFrustumPlanes(float alpha = 1.0f);
+
+private:
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseViewProjection;
+    glm::vec4 frustumPlanes[6];
+
+    // values the cached matrices were built from
+    glm::vec3 viewPosition;
+    glm::vec3 viewOrientation;
+    glm::vec3 viewUp;
+    float projectionFOV = 0.0f;
+    float projectionNear = 0.0f;
+    float projectionFar = 0.0f;
+    int projectionWidth = 0;
+    int projectionHeight = 0;
 
-    glm::mat4 getViewMatrix()
-    {
-        return glm::lookAt(Position, Position + Orientation, Up);
-    }
+    bool viewValid = false;
+    bool projectionValid = false;
+    bool viewProjectionValid = false;
+    bool inverseValid = false;
 
-    glm::mat4 getProjectionMatrix()
-    {
-        return glm::perspective(glm::radians(FOV), (float)(width / height), nearPlane, farPlane);
-    }
+    void updateViewProjection(float alpha);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct RenderStats;
+
+// what a command does; the handles and enums are the backend's (GL names here) but recording never calls it
+enum class CommandType : uint8_t
+{
+    BIND_PROGRAM,
+    BIND_MESH,
+    SET_MATRIX,
+    DRAW
+};
+
+// matrix uniforms a command can set, looked up by name when the program is bound
+enum UniformSlot
+{
+    UNIFORM_MODEL = 0,
+    UNIFORM_VIEW = 1,
+    UNIFORM_PROJECTION = 2,
+    UNIFORM_COUNT = 3
+};
+
+// BIND_PROGRAM and BIND_MESH: value is the handle; SET_MATRIX: value indexes the matrices, slot the uniform;
+// DRAW: value is the index count, mode the primitive
+struct Command
+{
+    CommandType type;
+    uint8_t slot;
+    uint32_t mode;
+    uint32_t value;
+};
+
+// draws recorded as a flat list of state changes, on any thread, then replayed on the one owning the context.
+// A bind of what is already bound is dropped while recording, so replay is one GL call per command
+class CommandBuffer
+{
+public:
+    void clear();
+    void bind_program(uint32_t program);
+    void bind_mesh(uint32_t mesh);
+    void set_matrix(UniformSlot slot, const glm::mat4 &matrix);
+    // indexed draw of count indices of the bound mesh
+    void draw(uint32_t mode, uint32_t count);
+
+    // adds the commands of other after these, without the binds that change nothing at the seam
+    void append(const CommandBuffer &other);
+
+    // issues the commands, on the context thread; view and projection are uploaded whenever a program is bound
+    RenderStats replay(const glm::mat4 &view, const glm::mat4 &projection);
+
+    size_t size() const { return commands_.size(); }
+
+private:
+    std::vector<Command> commands_;
+    std::vector<glm::mat4> matrices_;
+    // what the commands leave bound, 0 being nothing
+    uint32_t program_ = 0;
+    uint32_t mesh_ = 0;
+
+    // uniform locations of the programs replayed so far, looked up by name the first time only.
+    // Kept by clear, the programs outlive the frames
+    struct ProgramLocations
+    {
+        uint32_t program;
+        int32_t locations[UNIFORM_COUNT];
+    };
+    std::vector<ProgramLocations> locations_;
+
+    // locations of program, on the context thread
+    const int32_t *locations(uint32_t program);
+};
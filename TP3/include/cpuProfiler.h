@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// times the enclosing block on the CPU under name (a string literal), once the profile is started
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_NAME(profile_zone_, __LINE__)(name)
+#define PROFILE_ZONE_NAME(prefix, line) PROFILE_ZONE_JOIN(prefix, line)
+#define PROFILE_ZONE_JOIN(prefix, line) prefix##line
+
+// starts recording the zones of every thread, the timestamps count from here
+void start_cpu_profile();
+bool cpu_profile_started();
+// writes the zones recorded so far as Chrome trace events (chrome://tracing, Perfetto).
+// Threads may keep recording meanwhile, what they add is left out
+bool write_cpu_profile(const std::string &path);
+
+// nanoseconds since the profile started
+int64_t cpu_profile_time();
+// adds a zone to the buffer of the calling thread
+void record_cpu_zone(const char *name, int64_t start, int64_t end);
+
+class ProfileZone
+{
+public:
+    ProfileZone(const char *name) : name_(name), start_(cpu_profile_started() ? cpu_profile_time() : -1) {}
+    ~ProfileZone()
+    {
+        if (start_ >= 0)
+        {
+            record_cpu_zone(name_, start_, cpu_profile_time());
+        }
+    }
+
+private:
+    const char *name_;
+    int64_t start_;
+};
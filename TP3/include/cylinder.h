@@ -12,6 +12,7 @@ class Cylinder : public Shape
 public:
     Cylinder(Shader *shader_program, float height = 1.0f, float radius = 0.5f, int slices = 16);
     void draw(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection) override;
+    void submit(RenderQueue &queue, const glm::mat4 &model, const glm::mat4 &view) override;
 
 private:
     unsigned int num_indices;
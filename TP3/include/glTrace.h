@@ -0,0 +1,116 @@
+#ifndef GL_TRACE_H
+#define GL_TRACE_H
+
+// Include this instead of <GL/glew.h>. Built with GL_TRACE (cmake -DGL_TRACE=ON), every GL call made after it
+// is counted by name, with the draws, their primitives and the bytes sent to buffers and textures,
+// and endGLTraceFrame() can write one line per frame to a CSV file. Without GL_TRACE the calls are untouched
+#include <GL/glew.h>
+
+#ifdef GL_TRACE
+
+// Opens the per-frame trace file, false if it can't be opened (always false without GL_TRACE)
+bool startGLTrace(const char* path);
+// Ends the frame: writes its line to the trace file and adds it to the totals.
+// The calls made before the first one (loading) are frame 0, left out of the averages
+void endGLTraceFrame();
+// Prints the averages per frame and the functions called the most
+void printGLTraceSummary();
+
+// Called by the wrappers below, from the GL thread only
+void traceGLCall(const char* name);
+void traceGLDraw(GLenum mode, GLsizei count, GLsizei instances);
+// Follows the pixel unpack buffer, texture uploads from it were counted when the buffer was written
+void traceGLBindBuffer(GLenum target, GLuint buffer);
+void traceGLBufferUpload(GLsizeiptr bytes);
+void traceGLTextureUpload(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels);
+void traceGLCompressedUpload(GLsizei bytes, const void* data);
+
+// Every entry point GLEW loads goes through GLEW_GET_FUN, the name of its pointer is enough to count it
+#undef GLEW_GET_FUN
+#define GLEW_GET_FUN(x) (traceGLCall(#x), x)
+
+// The GL 1.1 functions are linked directly, a macro of the same name wraps them
+// (it doesn't expand again inside itself, so the real function is called)
+#define glBindTexture(...) (traceGLCall("glBindTexture"), glBindTexture(__VA_ARGS__))
+#define glBlendFunc(...) (traceGLCall("glBlendFunc"), glBlendFunc(__VA_ARGS__))
+#define glClear(...) (traceGLCall("glClear"), glClear(__VA_ARGS__))
+#define glClearColor(...) (traceGLCall("glClearColor"), glClearColor(__VA_ARGS__))
+#define glClearDepth(...) (traceGLCall("glClearDepth"), glClearDepth(__VA_ARGS__))
+#define glColorMask(...) (traceGLCall("glColorMask"), glColorMask(__VA_ARGS__))
+#define glCullFace(...) (traceGLCall("glCullFace"), glCullFace(__VA_ARGS__))
+#define glDeleteTextures(...) (traceGLCall("glDeleteTextures"), glDeleteTextures(__VA_ARGS__))
+#define glDepthFunc(...) (traceGLCall("glDepthFunc"), glDepthFunc(__VA_ARGS__))
+#define glDepthMask(...) (traceGLCall("glDepthMask"), glDepthMask(__VA_ARGS__))
+#define glDisable(...) (traceGLCall("glDisable"), glDisable(__VA_ARGS__))
+#define glDrawBuffer(...) (traceGLCall("glDrawBuffer"), glDrawBuffer(__VA_ARGS__))
+#define glEnable(...) (traceGLCall("glEnable"), glEnable(__VA_ARGS__))
+#define glFinish(...) (traceGLCall("glFinish"), glFinish(__VA_ARGS__))
+#define glGenTextures(...) (traceGLCall("glGenTextures"), glGenTextures(__VA_ARGS__))
+#define glGetError(...) (traceGLCall("glGetError"), glGetError(__VA_ARGS__))
+#define glGetFloatv(...) (traceGLCall("glGetFloatv"), glGetFloatv(__VA_ARGS__))
+#define glGetIntegerv(...) (traceGLCall("glGetIntegerv"), glGetIntegerv(__VA_ARGS__))
+#define glGetTexLevelParameteriv(...) (traceGLCall("glGetTexLevelParameteriv"), glGetTexLevelParameteriv(__VA_ARGS__))
+#define glGetTexParameteriv(...) (traceGLCall("glGetTexParameteriv"), glGetTexParameteriv(__VA_ARGS__))
+#define glPixelStorei(...) (traceGLCall("glPixelStorei"), glPixelStorei(__VA_ARGS__))
+#define glReadBuffer(...) (traceGLCall("glReadBuffer"), glReadBuffer(__VA_ARGS__))
+#define glReadPixels(...) (traceGLCall("glReadPixels"), glReadPixels(__VA_ARGS__))
+#define glTexParameterfv(...) (traceGLCall("glTexParameterfv"), glTexParameterfv(__VA_ARGS__))
+#define glTexParameteri(...) (traceGLCall("glTexParameteri"), glTexParameteri(__VA_ARGS__))
+#define glViewport(...) (traceGLCall("glViewport"), glViewport(__VA_ARGS__))
+
+// Draws
+#define glDrawArrays(mode, first, count) \
+    (traceGLCall("glDrawArrays"), traceGLDraw(mode, count, 1), glDrawArrays(mode, first, count))
+#define glDrawElements(mode, count, type, indices) \
+    (traceGLCall("glDrawElements"), traceGLDraw(mode, count, 1), glDrawElements(mode, count, type, indices))
+#undef glDrawArraysInstanced
+#define glDrawArraysInstanced(mode, first, count, instances) \
+    (traceGLDraw(mode, count, instances), GLEW_GET_FUN(__glewDrawArraysInstanced)(mode, first, count, instances))
+#undef glDrawElementsInstanced
+#define glDrawElementsInstanced(mode, count, type, indices, instances) \
+    (traceGLDraw(mode, count, instances), GLEW_GET_FUN(__glewDrawElementsInstanced)(mode, count, type, indices, instances))
+
+// Uploads
+#undef glBindBuffer
+#define glBindBuffer(target, buffer) \
+    (traceGLBindBuffer(target, buffer), GLEW_GET_FUN(__glewBindBuffer)(target, buffer))
+#undef glBufferData
+#define glBufferData(target, size, data, usage) \
+    (traceGLBufferUpload((data) != NULL ? (size) : 0), GLEW_GET_FUN(__glewBufferData)(target, size, data, usage))
+#undef glBufferSubData
+#define glBufferSubData(target, offset, size, data) \
+    (traceGLBufferUpload(size), GLEW_GET_FUN(__glewBufferSubData)(target, offset, size, data))
+#undef glMapBufferRange
+#define glMapBufferRange(target, offset, length, access) \
+    (traceGLBufferUpload(((access) & GL_MAP_WRITE_BIT) != 0 ? (length) : 0), GLEW_GET_FUN(__glewMapBufferRange)(target, offset, length, access))
+#define glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels) \
+    (traceGLCall("glTexImage2D"), traceGLTextureUpload(width, height, 1, format, type, pixels), \
+    glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels))
+#define glTexSubImage2D(target, level, x, y, width, height, format, type, pixels) \
+    (traceGLCall("glTexSubImage2D"), traceGLTextureUpload(width, height, 1, format, type, pixels), \
+    glTexSubImage2D(target, level, x, y, width, height, format, type, pixels))
+#undef glTexImage3D
+#define glTexImage3D(target, level, internalFormat, width, height, depth, border, format, type, pixels) \
+    (traceGLTextureUpload(width, height, depth, format, type, pixels), \
+    GLEW_GET_FUN(__glewTexImage3D)(target, level, internalFormat, width, height, depth, border, format, type, pixels))
+#undef glTexSubImage3D
+#define glTexSubImage3D(target, level, x, y, z, width, height, depth, format, type, pixels) \
+    (traceGLTextureUpload(width, height, depth, format, type, pixels), \
+    GLEW_GET_FUN(__glewTexSubImage3D)(target, level, x, y, z, width, height, depth, format, type, pixels))
+#undef glCompressedTexImage2D
+#define glCompressedTexImage2D(target, level, internalFormat, width, height, border, imageSize, data) \
+    (traceGLCompressedUpload(imageSize, data), \
+    GLEW_GET_FUN(__glewCompressedTexImage2D)(target, level, internalFormat, width, height, border, imageSize, data))
+#undef glCompressedTexImage3D
+#define glCompressedTexImage3D(target, level, internalFormat, width, height, depth, border, imageSize, data) \
+    (traceGLCompressedUpload(imageSize, data), \
+    GLEW_GET_FUN(__glewCompressedTexImage3D)(target, level, internalFormat, width, height, depth, border, imageSize, data))
+
+#else
+
+inline bool startGLTrace(const char*) { return false; }
+inline void endGLTraceFrame() {}
+inline void printGLTraceSummary() {}
+
+#endif
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "glTrace.h"
+
+// 8 bits RGB image, top row first
+struct RGBImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// binary PPM (P6), the format of the references
+bool read_ppm(const std::string &path, RGBImage &image);
+bool write_ppm(const std::string &path, const RGBImage &image);
+
+// averages blocks of factor x factor pixels, which also smooths out single pixel differences of the rasterizers
+RGBImage downsample(const RGBImage &image, int factor);
+
+// color and depth renderbuffers the golden frames are drawn into, in place of the window
+class OffscreenTarget
+{
+public:
+    OffscreenTarget(int width, int height);
+
+    bool complete();
+    void bind();
+    // reads the color back once the GPU is done with the frame
+    RGBImage read();
+    void destroy();
+
+private:
+    GLuint id_;
+    GLuint color_buffer_;
+    GLuint depth_buffer_;
+    int width_;
+    int height_;
+};
+
+// pixels further apart than the threshold (0 to 1) in YIQ space, where the differences are weighted
+// the way the eye perceives them, and the largest distance found
+struct ImageDifference
+{
+    long long different_pixels = 0;
+    double max_distance = 0.0;
+};
+ImageDifference compare_images(const RGBImage &a, const RGBImage &b, double threshold);
+
+// compares image with the reference, or overwrites the reference when update is set. Passes when at most
+// max_different of the pixels differ; a failing image is written next to the reference as .actual.ppm
+bool check_golden(const RGBImage &image, const std::string &reference, bool update, double threshold = 0.1,
+                  double max_different = 0.001);
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "glTrace.h"
+
+// time the GPU spent in one scope, over all the frames measured
+struct GPUScopeStats
+{
+    // names of the enclosing scopes and its own, separated by '/'
+    std::string path;
+    int depth = 0;
+    long long calls = 0;
+    double total_ms = 0.0;
+    double min_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+// named, nested GPU timers. A scope is a pair of GL_TIMESTAMP queries, as elapsed-time queries can't be nested,
+// read back frame_latency frames later so the CPU never waits on them. Each frame is a "frame" scope around its pushes
+class GPUProfiler
+{
+public:
+    GPUProfiler(int frame_latency = 3);
+
+    // turns the profiler on if the driver has a timestamp counter; every call does nothing until then
+    bool enable();
+    bool enabled() const { return enabled_; }
+
+    // reads the results of the frame whose queries are reused, then opens the "frame" scope
+    void begin_frame();
+    void end_frame();
+    // names are kept as pointers and must outlive the profiler (string literals)
+    void push(const char *name);
+    void pop();
+
+    // waits for the frames still in flight
+    void finish();
+    // statistics of every scope, as JSON if path ends with .json and CSV otherwise
+    bool write(const std::string &path) const;
+    // GPU time per frame of every scope, indented by depth
+    void print() const;
+    void destroy();
+
+    // scopes in the order they first appeared, parents before their children
+    const std::vector<GPUScopeStats> &scopes() const { return scopes_; }
+    long long frames() const { return frames_; }
+    // frames whose results weren't ready when their queries came round again
+    long long stalls() const { return stalls_; }
+
+private:
+    struct Scope
+    {
+        const char *name;
+        int parent;
+        GLuint start;
+        GLuint end;
+    };
+    struct Frame
+    {
+        std::vector<Scope> scopes;
+        std::vector<GLuint> queries;
+        size_t used_queries = 0;
+    };
+
+    bool enabled_ = false;
+    std::vector<Frame> ring_;
+    int current_ = 0;
+    // open scopes of the current frame, innermost last
+    std::vector<int> stack_;
+    std::vector<GPUScopeStats> scopes_;
+    std::unordered_map<std::string, size_t> scope_index_;
+    long long frames_ = 0;
+    long long stalls_ = 0;
+
+    GLuint next_query(Frame &frame);
+    void collect(Frame &frame);
+};
+
+// pushes a scope for the lifetime of the object
+class GPUScope
+{
+public:
+    GPUScope(GPUProfiler &profiler, const char *name) : profiler_(profiler) { profiler_.push(name); }
+    ~GPUScope() { profiler_.pop(); }
+
+private:
+    GPUProfiler &profiler_;
+};
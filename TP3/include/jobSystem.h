@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// jobs of a group still to finish, usable again once it is back to zero
+class JobCounter
+{
+public:
+    // the thread that finished the last job may still be touching the counter, it isn't done before letting go
+    bool done() const { return pending_.load() == 0 && finishing_.load() == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> pending_{0};
+    std::atomic<int> finishing_{0};
+};
+
+// workers with a deque of jobs each: a worker pops its own jobs from the back, the most recent and still in cache,
+// and steals the oldest job of another one when it runs out. Jobs queued by the other threads share one more deque
+class JobSystem
+{
+public:
+    // 0 workers means one per hardware thread, minus the thread creating the system
+    JobSystem(unsigned int workers = 0);
+    // runs the jobs still queued, then joins the workers
+    ~JobSystem();
+
+    // queues job, counted in counter (when there is one) until it returns
+    void run(std::function<void()> job, JobCounter *counter = nullptr);
+    // runs jobs on the calling thread until counter is back to zero, so a job can wait on the ones it queued
+    void wait(JobCounter &counter);
+
+    // calls body on ranges of at most grain indices covering [begin, end), on the workers and the calling thread,
+    // returning once they are all done. A range no longer than grain runs inline
+    void parallel_for(int begin, int end, int grain, const std::function<void(int, int)> &body);
+
+    unsigned int size() const { return (unsigned int)workers_.size(); }
+
+private:
+    struct Job
+    {
+        std::function<void()> work;
+        JobCounter *counter;
+    };
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::thread> workers_;
+    // one per worker, the last one for the other threads
+    std::vector<std::unique_ptr<Queue>> queues_;
+    // jobs in all the queues, the workers sleep while there are none
+    std::atomic<int> queued_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_;
+    std::atomic<bool> stopping_{false};
+
+    void push(Job job);
+    // takes a job for worker (-1 for the other threads), false if every queue is empty
+    bool take(int worker, Job &job);
+    bool run_one(int worker);
+    void finish(JobCounter *counter);
+    // index of the calling thread among the workers of this system, -1 if it isn't one of them
+    int current_worker() const;
+    void worker_loop(int worker);
+};
@@ -1,25 +1,54 @@
-#pragma once
-
-#include <vector>
-#include <glm/glm.hpp>
-
-#include "shape.h"
-#include "shaderClass.h"
-
-class Shape;
-
-class Node
-{
-public:
-    Node(const glm::mat4 &transform = glm::mat4(1.0f));
-    void add(Node *node);
-    void add(Shape *shape);
-    void draw(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection);
-    void key_handler(int key) const;
-    void transform(const glm::mat4 &transform) { transform_ = transform_ * transform; }
-
-private:
-    glm::mat4 transform_;
-    std::vector<Node *> children_;
-    std::vector<Shape *> children_shape_;
-};
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "shape.h"
+#include "shaderClass.h"
+#include "renderQueue.h"
+
+class Shape;
+class Node;
+
+// part of a tree recorded on its own, from the world transform of its node
+struct Subtree
+{
+    Node *node;
+    glm::mat4 world;
+    // only the shapes of node, its children being parts of their own
+    bool shapes_only;
+};
+
+class Node
+{
+public:
+    Node(const glm::mat4 &transform = glm::mat4(1.0f));
+    void add(Node *node);
+    void add(Shape *shape);
+    void draw(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection);
+    // records the draws of the subtree instead of issuing them
+    void submit(RenderQueue &queue, const glm::mat4 &model, const glm::mat4 &view);
+    // splits the tree into at least count disjoint parts (fewer if it has fewer nodes), breadth first,
+    // for threads to record at the same time; the parts together record the same draws as submit
+    void split(const glm::mat4 &model, size_t count, std::vector<Subtree> &parts);
+    // records the draws of one of the parts split
+    static void submit_part(const Subtree &part, RenderQueue &queue, const glm::mat4 &view);
+    void key_handler(int key) const;
+    void transform(const glm::mat4 &transform) { transform_ = transform_ * transform; }
+    void set_transform(const glm::mat4 &transform) { transform_ = transform; }
+    const glm::mat4 &get_transform() const { return transform_; }
+
+private:
+    glm::mat4 transform_;
+    std::vector<Node *> children_;
+    std::vector<Shape *> children_shape_;
+
+    // scratch arrays for the batched child transforms, kept to avoid allocating every frame
+    std::vector<glm::mat4> child_locals_;
+    std::vector<glm::mat4> child_worlds_;
+
+    void draw_world(glm::mat4 &world, glm::mat4 &view, glm::mat4 &projection);
+    void submit_world(RenderQueue &queue, const glm::mat4 &world, const glm::mat4 &view);
+    // world transforms of the child nodes into child_worlds_
+    void update_children(const glm::mat4 &world);
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glTrace.h"
+#include <glm/glm.hpp>
+#include "commandBuffer.h"
+
+// passes, drawn in this order
+enum RenderPass
+{
+    PASS_OPAQUE = 0,
+    PASS_TRANSPARENT = 1
+};
+
+// view depth mapped to the 24 bits of the key, anything farther shares the last value
+const float SORT_DEPTH_RANGE = 100.0f;
+
+// 64 bits sorted as one number, from the most to the least significant:
+// pass (2) | shader (10) | material (10) | mesh (16) | depth (24) | unused (2)
+// so draws sharing a program are grouped, then those sharing a mesh, then closest first
+uint64_t make_sort_key(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth);
+
+// one draw as recorded during the traversal, the model matrix is kept on the side
+struct DrawCommand
+{
+    uint64_t key;
+    GLuint program;
+    GLuint vao;
+    GLenum mode;
+    GLsizei count;
+    uint32_t transform;
+};
+
+// GL calls of one frame
+struct RenderStats
+{
+    int draws = 0;
+    int program_binds = 0;
+    int vao_binds = 0;
+    int uniform_uploads = 0;
+
+    int state_changes() const { return program_binds + vao_binds + uniform_uploads; }
+};
+
+// draws recorded by the scene graph, sorted then written as commands without the binds that change nothing
+class RenderQueue
+{
+public:
+    void clear();
+    // records a draw of the indexed mesh in vao, nothing is issued
+    void push(uint64_t key, GLuint program, GLuint vao, GLenum mode, GLsizei count, const glm::mat4 &model);
+    // radix sort on the keys, 8 bits at a time, skipping the bytes all the keys share
+    void sort();
+    // adds the draws to commands in key order, touches no GL state so any thread can do it
+    void record(CommandBuffer &commands);
+    // what the same draws cost when every shape binds everything itself
+    RenderStats unsorted_cost() const;
+
+    size_t size() const { return commands_.size(); }
+
+private:
+    std::vector<DrawCommand> commands_;
+    std::vector<glm::mat4> transforms_;
+    std::vector<uint32_t> order_;
+    std::vector<uint32_t> scratch_;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "glTrace.h"
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include "commandBuffer.h"
+
+// everything the GL side needs to draw one frame, built by the simulation and left alone once published
+struct FrameSnapshot
+{
+    CommandBuffer commands;
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    long long frame = 0;
+};
+
+// thread owning the GL context of a window, drawing the snapshots the main thread publishes.
+// There are two of them: the main thread fills one while the other is drawn, so a frame costs
+// the slowest of the two sides instead of both. Snapshots are drawn in order, none is skipped
+class RenderThread
+{
+public:
+    // takes the context of window from the calling thread, which must not call GL until stop
+    RenderThread(GLFWwindow *window, std::function<void(FrameSnapshot &)> render);
+    ~RenderThread();
+
+    // snapshot to fill next, waits while the render thread still draws it
+    FrameSnapshot &acquire();
+    // hands the acquired snapshot over to the render thread
+    void publish();
+    // draws what was published, joins the thread and gives the context back to the caller
+    void stop();
+
+    // time the main thread spent waiting for a free snapshot, and the render thread for a published one
+    double main_wait_ms() const { return main_wait_ms_; }
+    double render_wait_ms() const { return render_wait_ms_; }
+
+private:
+    enum class SlotState
+    {
+        FREE,
+        PUBLISHED,
+        DRAWING
+    };
+
+    GLFWwindow *window_;
+    std::function<void(FrameSnapshot &)> render_;
+    FrameSnapshot snapshots_[2];
+    SlotState states_[2] = {SlotState::FREE, SlotState::FREE};
+    int write_ = 0;
+    int read_ = 0;
+    bool stopping_ = false;
+    double main_wait_ms_ = 0.0;
+    double render_wait_ms_ = 0.0;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::thread thread_;
+
+    void loop();
+};
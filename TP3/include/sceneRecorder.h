@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "node.h"
+#include "renderQueue.h"
+#include "commandBuffer.h"
+#include "jobSystem.h"
+
+// records a scene graph on the job system: the tree is split into disjoint subtrees, each one recorded, sorted
+// and written as commands by a job of its own, then the buffers are merged in tree order for the context thread
+class SceneRecorder
+{
+public:
+    // parts_per_thread parts for each thread recording (the workers and the caller), so that a large
+    // subtree doesn't leave the other threads idle
+    SceneRecorder(JobSystem &jobs, size_t parts_per_thread = 4);
+
+    // records the tree under root into commands, replacing what it held
+    void record(Node &root, const glm::mat4 &model, const glm::mat4 &view, CommandBuffer &commands);
+
+    // what the draws of the last record cost when every shape binds everything itself
+    RenderStats unsorted_cost() const;
+    // parts the tree was split into by the last record
+    size_t parts() const { return parts_.size(); }
+
+private:
+    JobSystem &jobs_;
+    size_t parts_per_thread_;
+    std::vector<Subtree> parts_;
+    // one queue and one buffer per part, kept from frame to frame
+    std::vector<RenderQueue> queues_;
+    std::vector<CommandBuffer> buffers_;
+};
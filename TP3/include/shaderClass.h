@@ -1,7 +1,7 @@
 #ifndef SHADER_CLASS_H
 #define SHADER_CLASS_H
 
-#include <GL/glew.h>
+#include "glTrace.h"
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -2,6 +2,7 @@
 
 #include "shaderClass.h"
 #include "node.h"
+#include "renderQueue.h"
 
 #include <glm/glm.hpp>
 #include "glm/ext.hpp"
@@ -13,7 +14,12 @@ public:
     Shape(Shader *shader_program);
 
     virtual void draw(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection);
+    // records the draw in the queue instead of issuing it, every shape has a mesh of its own to record
+    virtual void submit(RenderQueue &queue, const glm::mat4 &model, const glm::mat4 &view) = 0;
 
 protected:
     GLuint shader_program_ID_;
+
+    // records an indexed draw of vao, keyed on the program, the mesh and the distance to the camera
+    void submit_mesh(RenderQueue &queue, GLuint vao, unsigned int num_indices, const glm::mat4 &model, const glm::mat4 &view);
 };
@@ -0,0 +1,326 @@
+#include "batchMath.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BATCH_USE_SSE
+#if defined(__GNUC__)
+#include <immintrin.h>
+// compiled for AVX2 + FMA on its own and only called when the CPU reports both
+#define BATCH_USE_AVX2
+#endif
+#endif
+
+struct BatchKernels
+{
+    void (*multiply_pairs)(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *out, size_t count);
+    void (*multiply_parent)(const glm::mat4 &parent, const glm::mat4 *b, glm::mat4 *out, size_t count);
+    void (*transform_points)(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count);
+    void (*transform_aabbs)(const glm::mat4 &m, const AABB *in, AABB *out, size_t count);
+    const char *name;
+};
+
+#ifndef BATCH_USE_SSE
+
+// ----- scalar (glm) -----
+
+static void multiply_pairs_scalar(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = a[i] * b[i];
+    }
+}
+
+static void multiply_parent_scalar(const glm::mat4 &parent, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = parent * b[i];
+    }
+}
+
+static void transform_points_scalar(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = glm::vec3(m * glm::vec4(in[i], 1.0f));
+    }
+}
+
+static void transform_aabbs_scalar(const glm::mat4 &m, const AABB *in, AABB *out, size_t count)
+{
+    // the extent of the new box is the old one through the absolute value of the rotation part (Arvo)
+    glm::mat3 absolute(glm::abs(glm::vec3(m[0])), glm::abs(glm::vec3(m[1])), glm::abs(glm::vec3(m[2])));
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 center = glm::vec3(m * glm::vec4((in[i].min + in[i].max) * 0.5f, 1.0f));
+        glm::vec3 extent = absolute * ((in[i].max - in[i].min) * 0.5f);
+        out[i].min = center - extent;
+        out[i].max = center + extent;
+    }
+}
+
+#else
+
+// ----- SSE -----
+
+// c0 * b[0] + c1 * b[1] + c2 * b[2] + c3 * b[3], one column of a product
+static inline __m128 combine_sse(__m128 c0, __m128 c1, __m128 c2, __m128 c3, const float *b)
+{
+    __m128 r = _mm_mul_ps(c0, _mm_set1_ps(b[0]));
+    r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(b[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(b[2])));
+    return _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(b[3])));
+}
+
+static inline void store3_sse(float *p, __m128 v)
+{
+    _mm_storel_pi(reinterpret_cast<__m64 *>(p), v);
+    _mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+}
+
+static void multiply_pairs_sse(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const float *pa = &a[i][0][0];
+        const float *pb = &b[i][0][0];
+        __m128 a0 = _mm_loadu_ps(pa);
+        __m128 a1 = _mm_loadu_ps(pa + 4);
+        __m128 a2 = _mm_loadu_ps(pa + 8);
+        __m128 a3 = _mm_loadu_ps(pa + 12);
+        __m128 r0 = combine_sse(a0, a1, a2, a3, pb);
+        __m128 r1 = combine_sse(a0, a1, a2, a3, pb + 4);
+        __m128 r2 = combine_sse(a0, a1, a2, a3, pb + 8);
+        __m128 r3 = combine_sse(a0, a1, a2, a3, pb + 12);
+        float *po = &out[i][0][0];
+        _mm_storeu_ps(po, r0);
+        _mm_storeu_ps(po + 4, r1);
+        _mm_storeu_ps(po + 8, r2);
+        _mm_storeu_ps(po + 12, r3);
+    }
+}
+
+static void multiply_parent_sse(const glm::mat4 &parent, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+    // the parent stays in registers for the whole batch
+    const float *pa = &parent[0][0];
+    __m128 a0 = _mm_loadu_ps(pa);
+    __m128 a1 = _mm_loadu_ps(pa + 4);
+    __m128 a2 = _mm_loadu_ps(pa + 8);
+    __m128 a3 = _mm_loadu_ps(pa + 12);
+    for (size_t i = 0; i < count; i++)
+    {
+        const float *pb = &b[i][0][0];
+        __m128 r0 = combine_sse(a0, a1, a2, a3, pb);
+        __m128 r1 = combine_sse(a0, a1, a2, a3, pb + 4);
+        __m128 r2 = combine_sse(a0, a1, a2, a3, pb + 8);
+        __m128 r3 = combine_sse(a0, a1, a2, a3, pb + 12);
+        float *po = &out[i][0][0];
+        _mm_storeu_ps(po, r0);
+        _mm_storeu_ps(po + 4, r1);
+        _mm_storeu_ps(po + 8, r2);
+        _mm_storeu_ps(po + 12, r3);
+    }
+}
+
+static void transform_points_sse(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count)
+{
+    __m128 c0 = _mm_loadu_ps(&m[0][0]);
+    __m128 c1 = _mm_loadu_ps(&m[1][0]);
+    __m128 c2 = _mm_loadu_ps(&m[2][0]);
+    __m128 c3 = _mm_loadu_ps(&m[3][0]);
+    for (size_t i = 0; i < count; i++)
+    {
+        __m128 r = _mm_add_ps(c3, _mm_mul_ps(c0, _mm_set1_ps(in[i].x)));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(in[i].y)));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(in[i].z)));
+        // 3 floats only, a 4th would overwrite the next point
+        store3_sse(&out[i].x, r);
+    }
+}
+
+static void transform_aabbs_sse(const glm::mat4 &m, const AABB *in, AABB *out, size_t count)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 c0 = _mm_loadu_ps(&m[0][0]);
+    __m128 c1 = _mm_loadu_ps(&m[1][0]);
+    __m128 c2 = _mm_loadu_ps(&m[2][0]);
+    __m128 c3 = _mm_loadu_ps(&m[3][0]);
+    __m128 a0 = _mm_andnot_ps(sign, c0);
+    __m128 a1 = _mm_andnot_ps(sign, c1);
+    __m128 a2 = _mm_andnot_ps(sign, c2);
+    for (size_t i = 0; i < count; i++)
+    {
+        __m128 lo = _mm_setr_ps(in[i].min.x, in[i].min.y, in[i].min.z, 0.0f);
+        __m128 hi = _mm_setr_ps(in[i].max.x, in[i].max.y, in[i].max.z, 0.0f);
+        float center[4];
+        float extent[4];
+        _mm_storeu_ps(center, _mm_mul_ps(_mm_add_ps(lo, hi), half));
+        _mm_storeu_ps(extent, _mm_mul_ps(_mm_sub_ps(hi, lo), half));
+
+        __m128 c = _mm_add_ps(c3, _mm_mul_ps(c0, _mm_set1_ps(center[0])));
+        c = _mm_add_ps(c, _mm_mul_ps(c1, _mm_set1_ps(center[1])));
+        c = _mm_add_ps(c, _mm_mul_ps(c2, _mm_set1_ps(center[2])));
+        __m128 e = _mm_mul_ps(a0, _mm_set1_ps(extent[0]));
+        e = _mm_add_ps(e, _mm_mul_ps(a1, _mm_set1_ps(extent[1])));
+        e = _mm_add_ps(e, _mm_mul_ps(a2, _mm_set1_ps(extent[2])));
+
+        store3_sse(&out[i].min.x, _mm_sub_ps(c, e));
+        store3_sse(&out[i].max.x, _mm_add_ps(c, e));
+    }
+}
+
+#endif
+
+#ifdef BATCH_USE_AVX2
+
+// ----- AVX2 + FMA, two columns (or two points) per register -----
+
+// each 128 bits half gets a0 * b[0] + ... for the column of b in that half
+__attribute__((target("avx2,fma"))) static inline __m256 combine_avx2(__m256 a0, __m256 a1, __m256 a2, __m256 a3, __m256 b)
+{
+    __m256 r = _mm256_mul_ps(a0, _mm256_shuffle_ps(b, b, 0x00));
+    r = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b, b, 0x55), r);
+    r = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b, b, 0xAA), r);
+    return _mm256_fmadd_ps(a3, _mm256_shuffle_ps(b, b, 0xFF), r);
+}
+
+__attribute__((target("avx2,fma"))) static void multiply_pairs_avx2(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const float *pa = &a[i][0][0];
+        const float *pb = &b[i][0][0];
+        __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(pa));
+        __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(pa + 4));
+        __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(pa + 8));
+        __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(pa + 12));
+        __m256 r01 = combine_avx2(a0, a1, a2, a3, _mm256_loadu_ps(pb));
+        __m256 r23 = combine_avx2(a0, a1, a2, a3, _mm256_loadu_ps(pb + 8));
+        _mm256_storeu_ps(&out[i][0][0], r01);
+        _mm256_storeu_ps(&out[i][2][0], r23);
+    }
+}
+
+__attribute__((target("avx2,fma"))) static void multiply_parent_avx2(const glm::mat4 &parent, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+    const float *pa = &parent[0][0];
+    __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(pa));
+    __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(pa + 4));
+    __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(pa + 8));
+    __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(pa + 12));
+    for (size_t i = 0; i < count; i++)
+    {
+        const float *pb = &b[i][0][0];
+        __m256 r01 = combine_avx2(a0, a1, a2, a3, _mm256_loadu_ps(pb));
+        __m256 r23 = combine_avx2(a0, a1, a2, a3, _mm256_loadu_ps(pb + 8));
+        _mm256_storeu_ps(&out[i][0][0], r01);
+        _mm256_storeu_ps(&out[i][2][0], r23);
+    }
+}
+
+__attribute__((target("avx2,fma"))) static void transform_points_avx2(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count)
+{
+    __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[0][0]));
+    __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[1][0]));
+    __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[2][0]));
+    __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[3][0]));
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m256 x = _mm256_set_ps(in[i + 1].x, in[i + 1].x, in[i + 1].x, in[i + 1].x, in[i].x, in[i].x, in[i].x, in[i].x);
+        __m256 y = _mm256_set_ps(in[i + 1].y, in[i + 1].y, in[i + 1].y, in[i + 1].y, in[i].y, in[i].y, in[i].y, in[i].y);
+        __m256 z = _mm256_set_ps(in[i + 1].z, in[i + 1].z, in[i + 1].z, in[i + 1].z, in[i].z, in[i].z, in[i].z, in[i].z);
+        __m256 r = _mm256_fmadd_ps(c0, x, c3);
+        r = _mm256_fmadd_ps(c1, y, r);
+        r = _mm256_fmadd_ps(c2, z, r);
+        store3_sse(&out[i].x, _mm256_castps256_ps128(r));
+        store3_sse(&out[i + 1].x, _mm256_extractf128_ps(r, 1));
+    }
+    if (i < count)
+    {
+        transform_points_sse(m, in + i, out + i, count - i);
+    }
+}
+
+__attribute__((target("avx2,fma"))) static void transform_aabbs_avx2(const glm::mat4 &m, const AABB *in, AABB *out, size_t count)
+{
+    // center in the low half, extent in the high half: both go through the same three multiply-adds
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 translation = _mm256_setr_ps(m[3][0], m[3][1], m[3][2], 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[0][0]));
+    __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[1][0]));
+    __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[2][0]));
+    // the extent half uses the absolute value of the columns
+    const __m256 absHigh = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, 0, -1, -1, -1, -1));
+    const __m256 mask = _mm256_and_ps(sign, absHigh);
+    c0 = _mm256_andnot_ps(mask, c0);
+    c1 = _mm256_andnot_ps(mask, c1);
+    c2 = _mm256_andnot_ps(mask, c2);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 center = (in[i].min + in[i].max);
+        glm::vec3 extent = (in[i].max - in[i].min);
+        __m256 x = _mm256_mul_ps(_mm256_set_ps(extent.x, extent.x, extent.x, extent.x, center.x, center.x, center.x, center.x), half);
+        __m256 y = _mm256_mul_ps(_mm256_set_ps(extent.y, extent.y, extent.y, extent.y, center.y, center.y, center.y, center.y), half);
+        __m256 z = _mm256_mul_ps(_mm256_set_ps(extent.z, extent.z, extent.z, extent.z, center.z, center.z, center.z, center.z), half);
+        __m256 r = _mm256_fmadd_ps(c0, x, translation);
+        r = _mm256_fmadd_ps(c1, y, r);
+        r = _mm256_fmadd_ps(c2, z, r);
+        __m128 c = _mm256_castps256_ps128(r);
+        __m128 e = _mm256_extractf128_ps(r, 1);
+        store3_sse(&out[i].min.x, _mm_sub_ps(c, e));
+        store3_sse(&out[i].max.x, _mm_add_ps(c, e));
+    }
+}
+
+#endif
+
+static BatchKernels select_kernels()
+{
+#ifdef BATCH_USE_AVX2
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return {multiply_pairs_avx2, multiply_parent_avx2, transform_points_avx2, transform_aabbs_avx2, "AVX2"};
+    }
+#endif
+#ifdef BATCH_USE_SSE
+    return {multiply_pairs_sse, multiply_parent_sse, transform_points_sse, transform_aabbs_sse, "SSE2"};
+#else
+    return {multiply_pairs_scalar, multiply_parent_scalar, transform_points_scalar, transform_aabbs_scalar, "scalar"};
+#endif
+}
+
+static const BatchKernels &kernels()
+{
+    static const BatchKernels selected = select_kernels();
+    return selected;
+}
+
+void multiply_matrices(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+    kernels().multiply_pairs(a, b, out, count);
+}
+
+void multiply_matrices(const glm::mat4 &parent, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+    kernels().multiply_parent(parent, b, out, count);
+}
+
+void transform_points(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count)
+{
+    kernels().transform_points(m, in, out, count);
+}
+
+void transform_aabbs(const glm::mat4 &m, const AABB *in, AABB *out, size_t count)
+{
+    kernels().transform_aabbs(m, in, out, count);
+}
+
+const char *batch_math_instruction_set()
+{
+    return kernels().name;
+}
@@ -0,0 +1,229 @@
+#include "benchmark.h"
+#include "batchMath.h"
+#include "node.h"
+#include "sphere.h"
+#include "cylinder.h"
+#include "renderQueue.h"
+#include "commandBuffer.h"
+#include "sceneRecorder.h"
+#include "jobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// best of a few runs, in milliseconds
+static double best_time(const std::function<void()> &run)
+{
+    double best = 1e30;
+    for (int i = 0; i < 5; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+static float random_float()
+{
+    return (float)std::rand() / RAND_MAX * 2.0f - 1.0f;
+}
+
+static glm::mat4 random_transform()
+{
+    glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(random_float(), random_float(), random_float()));
+    m = glm::rotate(m, random_float() * 3.14f, glm::normalize(glm::vec3(random_float(), random_float(), random_float()) + glm::vec3(0.0f, 0.0f, 2.0f)));
+    return glm::scale(m, glm::vec3(1.0f + 0.5f * random_float()));
+}
+
+static void print_row(const char *name, size_t count, double glm_ms, double batch_ms, float error)
+{
+    std::cout << std::left << std::setw(18) << name << std::right << std::setw(9) << count
+              << std::fixed << std::setprecision(3) << std::setw(12) << glm_ms << " ms" << std::setw(12) << batch_ms << " ms"
+              << std::setprecision(2) << std::setw(8) << glm_ms / batch_ms << "x"
+              << std::scientific << std::setprecision(1) << std::setw(10) << error << std::defaultfloat << std::endl;
+}
+
+void benchmark_math()
+{
+    std::cout << "batch math with " << batch_math_instruction_set() << std::endl;
+    std::cout << std::left << std::setw(18) << "operation" << std::right << std::setw(9) << "count"
+              << std::setw(15) << "glm" << std::setw(15) << "batch" << std::setw(9) << "speedup" << std::setw(10) << "max error" << std::endl;
+
+    std::srand(1);
+    for (size_t count = 1000; count <= 1000000; count *= 10)
+    {
+        std::vector<glm::mat4> a(count), b(count), expected(count), out(count);
+        std::vector<glm::vec3> points(count), expected_points(count), out_points(count);
+        std::vector<AABB> boxes(count), expected_boxes(count), out_boxes(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            a[i] = random_transform();
+            b[i] = random_transform();
+            points[i] = glm::vec3(random_float(), random_float(), random_float());
+            boxes[i].min = points[i] - glm::vec3(0.1f);
+            boxes[i].max = points[i] + glm::vec3(0.2f, 0.3f, 0.4f);
+        }
+        glm::mat4 parent = random_transform();
+
+        float error = 0.0f;
+        auto matrix_error = [&]()
+        {
+            error = 0.0f;
+            for (size_t i = 0; i < count; i++)
+                for (int c = 0; c < 4; c++)
+                    error = std::max(error, glm::length(expected[i][c] - out[i][c]));
+        };
+
+        double glm_ms = best_time([&]()
+        {
+            for (size_t i = 0; i < count; i++)
+                expected[i] = a[i] * b[i];
+        });
+        double batch_ms = best_time([&]() { multiply_matrices(a.data(), b.data(), out.data(), count); });
+        matrix_error();
+        print_row("mat4 * mat4", count, glm_ms, batch_ms, error);
+
+        glm_ms = best_time([&]()
+        {
+            for (size_t i = 0; i < count; i++)
+                expected[i] = parent * b[i];
+        });
+        batch_ms = best_time([&]() { multiply_matrices(parent, b.data(), out.data(), count); });
+        matrix_error();
+        print_row("parent * mat4", count, glm_ms, batch_ms, error);
+
+        glm_ms = best_time([&]()
+        {
+            for (size_t i = 0; i < count; i++)
+                expected_points[i] = glm::vec3(parent * glm::vec4(points[i], 1.0f));
+        });
+        batch_ms = best_time([&]() { transform_points(parent, points.data(), out_points.data(), count); });
+        error = 0.0f;
+        for (size_t i = 0; i < count; i++)
+            error = std::max(error, glm::length(expected_points[i] - out_points[i]));
+        print_row("points", count, glm_ms, batch_ms, error);
+
+        glm_ms = best_time([&]()
+        {
+            // every corner through the matrix, the straightforward way
+            for (size_t i = 0; i < count; i++)
+            {
+                glm::vec3 lo(1e30f), hi(-1e30f);
+                for (int corner = 0; corner < 8; corner++)
+                {
+                    glm::vec3 p((corner & 1) ? boxes[i].max.x : boxes[i].min.x, (corner & 2) ? boxes[i].max.y : boxes[i].min.y, (corner & 4) ? boxes[i].max.z : boxes[i].min.z);
+                    p = glm::vec3(parent * glm::vec4(p, 1.0f));
+                    lo = glm::min(lo, p);
+                    hi = glm::max(hi, p);
+                }
+                expected_boxes[i].min = lo;
+                expected_boxes[i].max = hi;
+            }
+        });
+        batch_ms = best_time([&]() { transform_aabbs(parent, boxes.data(), out_boxes.data(), count); });
+        error = 0.0f;
+        for (size_t i = 0; i < count; i++)
+            error = std::max(error, std::max(glm::length(expected_boxes[i].min - out_boxes[i].min), glm::length(expected_boxes[i].max - out_boxes[i].max)));
+        print_row("aabbs", count, glm_ms, batch_ms, error);
+    }
+}
+
+void benchmark_recording(Shader &shader)
+{
+    // 8 children per node over 6 levels, each node with one of a few coarse meshes so that drawing stays cheap
+    const int fan_out = 8;
+    const int levels = 6;
+    std::srand(1);
+    std::vector<std::unique_ptr<Sphere>> spheres;
+    std::vector<std::unique_ptr<Cylinder>> cylinders;
+    std::vector<Shape *> meshes;
+    for (int i = 0; i < 4; i++)
+    {
+        spheres.emplace_back(new Sphere(&shader, 0.05f, 4));
+        cylinders.emplace_back(new Cylinder(&shader, 0.2f, 0.02f, 4));
+        meshes.push_back(spheres.back().get());
+        meshes.push_back(cylinders.back().get());
+    }
+    std::vector<std::unique_ptr<Node>> nodes;
+    nodes.emplace_back(new Node());
+    size_t level_begin = 0;
+    for (int level = 1; level < levels; level++)
+    {
+        size_t level_end = nodes.size();
+        for (size_t parent = level_begin; parent < level_end; parent++)
+        {
+            for (int child = 0; child < fan_out; child++)
+            {
+                nodes.emplace_back(new Node(glm::scale(random_transform(), glm::vec3(0.8f))));
+                nodes[parent]->add(nodes.back().get());
+            }
+        }
+        level_begin = level_end;
+    }
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        nodes[i]->add(meshes[i % meshes.size()]);
+    }
+    Node &root = *nodes[0];
+
+    glm::mat4 model(1.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 8.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+
+    std::cout << "recording " << nodes.size() << " shapes into command buffers, best of 5 runs" << std::endl;
+    RenderQueue queue;
+    CommandBuffer commands;
+    double serial_ms = best_time([&]()
+    {
+        queue.clear();
+        root.submit(queue, model, view);
+        queue.sort();
+        commands.clear();
+        queue.record(commands);
+    });
+    std::cout << std::left << std::setw(18) << "one thread" << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << serial_ms << " ms" << std::defaultfloat << std::endl;
+
+    unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << std::left << std::setw(18) << "workers (+ caller)" << std::right << std::setw(15) << "time" << std::setw(9) << "speedup"
+              << std::setw(7) << "parts" << std::setw(10) << "commands" << std::endl;
+    for (unsigned int workers = 1; workers <= std::max(4u, hardware); workers++)
+    {
+        JobSystem jobs(workers);
+        SceneRecorder recorder(jobs);
+        double ms = best_time([&]() { recorder.record(root, model, view, commands); });
+        std::cout << std::left << std::setw(18) << workers << std::right << std::fixed << std::setprecision(3) << std::setw(12) << ms << " ms"
+                  << std::setprecision(2) << std::setw(8) << serial_ms / ms << "x" << std::defaultfloat
+                  << std::setw(7) << recorder.parts() << std::setw(10) << commands.size() << std::endl;
+    }
+
+    // submission on a small viewport, so that the time goes into the calls rather than the pixels
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glViewport(0, 0, 64, 64);
+    double immediate_ms = best_time([&]()
+    {
+        shader.Activate();
+        root.draw(model, view, projection);
+        glFinish();
+    });
+    double replay_ms = best_time([&]()
+    {
+        commands.replay(view, projection);
+        glFinish();
+    });
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    std::cout << "submission with glFinish: " << std::fixed << std::setprecision(3) << immediate_ms << " ms traversing the tree, "
+              << replay_ms << " ms replaying the commands" << std::defaultfloat << std::endl;
+}
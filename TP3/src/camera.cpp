@@ -5,36 +5,41 @@ Camera::Camera(int width, int height, glm::vec3 position, float FOV, float nearP
     Camera::width = width;
     Camera::height = height;
     Camera::Position = position;
+    Camera::PreviousPosition = position;
     Camera::FOV = FOV;
     Camera::nearPlane = nearPlane;
     Camera::farPlane = farPlane;
 }
 
-void Camera::Inputs(GLFWwindow *window)
+void Camera::Inputs(GLFWwindow *window, float dt)
 {
+    PreviousPosition = Position;
+    PreviousOrientation = Orientation;
+
+    float step = speed * dt;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
     {
-        Position += speed * Orientation;
+        Position += step * Orientation;
     }
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
     {
-        Position += speed * -glm::normalize(glm::cross(Orientation, Up));
+        Position += step * -glm::normalize(glm::cross(Orientation, Up));
     }
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
     {
-        Position += speed * -Orientation;
+        Position += step * -Orientation;
     }
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
     {
-        Position += speed * glm::normalize(glm::cross(Orientation, Up));
+        Position += step * glm::normalize(glm::cross(Orientation, Up));
     }
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
     {
-        Position += speed * Up;
+        Position += step * Up;
     }
     if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
     {
-        Position += speed * -Up;
+        Position += step * -Up;
     }
     if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
     {
@@ -68,4 +73,89 @@ void Camera::Inputs(GLFWwindow *window)
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
         firstClick = true;
     }
+}
+
+const glm::mat4 &Camera::getViewMatrix(float alpha)
+{
+    glm::vec3 position = glm::mix(PreviousPosition, Position, alpha);
+    glm::vec3 orientation = glm::normalize(glm::mix(PreviousOrientation, Orientation, alpha));
+
+    if (!viewValid || position != viewPosition || orientation != viewOrientation || Up != viewUp)
+    {
+        view = glm::lookAt(position, position + orientation, Up);
+        viewPosition = position;
+        viewOrientation = orientation;
+        viewUp = Up;
+        viewValid = true;
+        viewProjectionValid = false;
+    }
+    return view;
+}
+
+const glm::mat4 &Camera::getProjectionMatrix()
+{
+    if (!projectionValid || FOV != projectionFOV || nearPlane != projectionNear || farPlane != projectionFar ||
+        width != projectionWidth || height != projectionHeight)
+    {
+        projection = glm::perspective(glm::radians(FOV), (float)width / height, nearPlane, farPlane);
+        projectionFOV = FOV;
+        projectionNear = nearPlane;
+        projectionFar = farPlane;
+        projectionWidth = width;
+        projectionHeight = height;
+        projectionValid = true;
+        viewProjectionValid = false;
+    }
+    return projection;
+}
+
+const glm::mat4 &Camera::getViewProjectionMatrix(float alpha)
+{
+    updateViewProjection(alpha);
+    return viewProjection;
+}
+
+const glm::mat4 &Camera::getInverseViewProjectionMatrix(float alpha)
+{
+    updateViewProjection(alpha);
+    // only computed when asked for, most frames never need it
+    if (!inverseValid)
+    {
+        inverseViewProjection = glm::inverse(viewProjection);
+        inverseValid = true;
+    }
+    return inverseViewProjection;
+}
+
+const glm::vec4 *Camera::getFrustumPlanes(float alpha)
+{
+    updateViewProjection(alpha);
+    return frustumPlanes;
+}
+
+void Camera::updateViewProjection(float alpha)
+{
+    getViewMatrix(alpha);
+    getProjectionMatrix();
+    if (viewProjectionValid)
+    {
+        return;
+    }
+
+    viewProjection = projection * view;
+    viewProjectionValid = true;
+    inverseValid = false;
+
+    // planes straight from the rows of the matrix (Gribb & Hartmann)
+    glm::mat4 rows = glm::transpose(viewProjection);
+    frustumPlanes[0] = rows[3] + rows[0];
+    frustumPlanes[1] = rows[3] - rows[0];
+    frustumPlanes[2] = rows[3] + rows[1];
+    frustumPlanes[3] = rows[3] - rows[1];
+    frustumPlanes[4] = rows[3] + rows[2];
+    frustumPlanes[5] = rows[3] - rows[2];
+    for (glm::vec4 &plane : frustumPlanes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "clock.h"
+
+SystemClock::SystemClock() : start(std::chrono::steady_clock::now())
+{
+}
+
+double SystemClock::Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+FixedTimestep::FixedTimestep(Clock &clock, double step, int maxSteps) : clock(clock), step(step), maxSteps(maxSteps)
+{
+    last = clock.Now();
+}
+
+int FixedTimestep::Advance()
+{
+    double now = clock.Now();
+    accumulator += now - last;
+    last = now;
+
+    // After a long stall (window dragged, breakpoint) the late steps are dropped
+    // instead of being simulated all at once, which would make the next frame even slower
+    if (accumulator > maxSteps * step)
+    {
+        accumulator = maxSteps * step;
+    }
+
+    // A clock advanced by exactly one step can land a rounding error short of it, which would give
+    // 0 steps then 2 instead of 1 and 1, so a step within the error counts as whole
+    int steps = (int)(accumulator / step + 1e-6);
+    accumulator -= steps * step;
+    if (accumulator < 0.0)
+    {
+        accumulator = 0.0;
+    }
+    return steps;
+}
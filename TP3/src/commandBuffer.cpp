@@ -0,0 +1,141 @@
+#include "commandBuffer.h"
+#include "renderQueue.h"
+#include "cpuProfiler.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+// names of the uniform slots in the shaders
+static const char *const uniform_names[UNIFORM_COUNT] = {"modelMatrix", "viewMatrix", "projectionMatrix"};
+
+void CommandBuffer::clear()
+{
+    commands_.clear();
+    matrices_.clear();
+    program_ = 0;
+    mesh_ = 0;
+}
+
+void CommandBuffer::bind_program(uint32_t program)
+{
+    if (program == program_)
+    {
+        return;
+    }
+    program_ = program;
+    commands_.push_back({CommandType::BIND_PROGRAM, 0, 0, program});
+}
+
+void CommandBuffer::bind_mesh(uint32_t mesh)
+{
+    if (mesh == mesh_)
+    {
+        return;
+    }
+    mesh_ = mesh;
+    commands_.push_back({CommandType::BIND_MESH, 0, 0, mesh});
+}
+
+void CommandBuffer::set_matrix(UniformSlot slot, const glm::mat4 &matrix)
+{
+    commands_.push_back({CommandType::SET_MATRIX, (uint8_t)slot, 0, (uint32_t)matrices_.size()});
+    matrices_.push_back(matrix);
+}
+
+void CommandBuffer::draw(uint32_t mode, uint32_t count)
+{
+    commands_.push_back({CommandType::DRAW, 0, mode, count});
+}
+
+void CommandBuffer::append(const CommandBuffer &other)
+{
+    // the binds other starts with may be the ones these commands end with
+    size_t first = 0;
+    for (; first < other.commands_.size(); first++)
+    {
+        const Command &command = other.commands_[first];
+        bool same_program = command.type == CommandType::BIND_PROGRAM && command.value == program_;
+        bool same_mesh = command.type == CommandType::BIND_MESH && command.value == mesh_;
+        if (!same_program && !same_mesh)
+        {
+            break;
+        }
+    }
+
+    uint32_t matrix_offset = (uint32_t)matrices_.size();
+    commands_.reserve(commands_.size() + other.commands_.size() - first);
+    for (size_t i = first; i < other.commands_.size(); i++)
+    {
+        Command command = other.commands_[i];
+        if (command.type == CommandType::SET_MATRIX)
+        {
+            command.value += matrix_offset;
+        }
+        commands_.push_back(command);
+    }
+    matrices_.insert(matrices_.end(), other.matrices_.begin(), other.matrices_.end());
+
+    if (other.program_ != 0)
+    {
+        program_ = other.program_;
+    }
+    if (other.mesh_ != 0)
+    {
+        mesh_ = other.mesh_;
+    }
+}
+
+const int32_t *CommandBuffer::locations(uint32_t program)
+{
+    // a handful of programs, a linear search beats hashing
+    for (const ProgramLocations &known : locations_)
+    {
+        if (known.program == program)
+        {
+            return known.locations;
+        }
+    }
+    ProgramLocations added;
+    added.program = program;
+    for (int slot = 0; slot < UNIFORM_COUNT; slot++)
+    {
+        added.locations[slot] = glGetUniformLocation(program, uniform_names[slot]);
+    }
+    locations_.push_back(added);
+    return locations_.back().locations;
+}
+
+RenderStats CommandBuffer::replay(const glm::mat4 &view, const glm::mat4 &projection)
+{
+    PROFILE_ZONE("CommandBuffer::replay");
+    RenderStats stats;
+    static const int32_t none[UNIFORM_COUNT] = {-1, -1, -1};
+    const int32_t *slots = none;
+
+    for (const Command &command : commands_)
+    {
+        switch (command.type)
+        {
+        case CommandType::BIND_PROGRAM:
+            glUseProgram(command.value);
+            slots = locations(command.value);
+            glUniformMatrix4fv(slots[UNIFORM_VIEW], 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(slots[UNIFORM_PROJECTION], 1, GL_FALSE, glm::value_ptr(projection));
+            stats.program_binds++;
+            stats.uniform_uploads += 2;
+            break;
+        case CommandType::BIND_MESH:
+            glBindVertexArray(command.value);
+            stats.vao_binds++;
+            break;
+        case CommandType::SET_MATRIX:
+            glUniformMatrix4fv(slots[command.slot], 1, GL_FALSE, glm::value_ptr(matrices_[command.value]));
+            stats.uniform_uploads++;
+            break;
+        case CommandType::DRAW:
+            glDrawElements(command.mode, command.value, GL_UNSIGNED_INT, nullptr);
+            stats.draws++;
+            break;
+        }
+    }
+    return stats;
+}
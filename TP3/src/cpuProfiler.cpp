@@ -0,0 +1,132 @@
+#include "cpuProfiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+struct ProfileEvent
+{
+    const char *name;
+    int64_t start;
+    int64_t end;
+};
+
+// only the owning thread appends. It publishes the count once the event is written,
+// which lets the file be written from another thread without a lock
+struct ProfileChunk
+{
+    static const size_t CAPACITY = 4096;
+    ProfileEvent events[CAPACITY];
+    std::atomic<size_t> count{0};
+    std::atomic<ProfileChunk *> next{nullptr};
+};
+
+// buffer of one thread, never freed since the file can be written at any time
+struct ProfileThread
+{
+    uint32_t id;
+    ProfileChunk *first;
+    ProfileChunk *last;
+    ProfileThread *next;
+};
+
+static std::atomic<bool> started{false};
+static std::chrono::steady_clock::time_point start_time;
+static std::atomic<ProfileThread *> threads{nullptr};
+static std::atomic<uint32_t> thread_count{0};
+static thread_local ProfileThread *local_thread = nullptr;
+
+void start_cpu_profile()
+{
+    start_time = std::chrono::steady_clock::now();
+    started.store(true, std::memory_order_release);
+}
+
+bool cpu_profile_started()
+{
+    return started.load(std::memory_order_acquire);
+}
+
+int64_t cpu_profile_time()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void record_cpu_zone(const char *name, int64_t start, int64_t end)
+{
+    if (local_thread == nullptr)
+    {
+        // first zone of the thread, its buffer joins the list through a compare and swap
+        local_thread = new ProfileThread();
+        local_thread->id = ++thread_count;
+        local_thread->first = new ProfileChunk();
+        local_thread->last = local_thread->first;
+        local_thread->next = threads.load(std::memory_order_relaxed);
+        while (!threads.compare_exchange_weak(local_thread->next, local_thread, std::memory_order_release,
+                                              std::memory_order_relaxed))
+        {
+        }
+    }
+
+    ProfileChunk *chunk = local_thread->last;
+    size_t count = chunk->count.load(std::memory_order_relaxed);
+    if (count == ProfileChunk::CAPACITY)
+    {
+        ProfileChunk *full = chunk;
+        chunk = new ProfileChunk();
+        full->next.store(chunk, std::memory_order_release);
+        local_thread->last = chunk;
+        count = 0;
+    }
+    chunk->events[count] = {name, start, end};
+    chunk->count.store(count + 1, std::memory_order_release);
+}
+
+// zone names are string literals, only quotes and backslashes would break the JSON
+static void write_escaped(std::ofstream &file, const char *text)
+{
+    for (const char *c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            file << '\\';
+        }
+        file << *c;
+    }
+}
+
+bool write_cpu_profile(const std::string &path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "failed writing " << path << std::endl;
+        return false;
+    }
+
+    // complete events ("X"), with timestamps and durations in microseconds
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    const char *separator = "\n";
+    size_t events = 0;
+    for (ProfileThread *thread = threads.load(std::memory_order_acquire); thread != nullptr; thread = thread->next)
+    {
+        for (ProfileChunk *chunk = thread->first; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire))
+        {
+            size_t count = chunk->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; i++)
+            {
+                const ProfileEvent &event = chunk->events[i];
+                file << separator << "{\"name\":\"";
+                write_escaped(file, event.name);
+                file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id << ",\"ts\":" << event.start / 1000.0
+                     << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+                separator = ",\n";
+                events++;
+            }
+        }
+    }
+    file << "\n]}\n";
+    std::cout << events << " CPU zones written to " << path << std::endl;
+    return true;
+}
@@ -6,10 +6,12 @@
 
 #include "VAO.h"
 #include "VBO.h"
+#include "cpuProfiler.h"
 
 Cylinder::Cylinder(Shader *shader_program, float height, float radius, int slices)
     : Shape(shader_program)
 {
+    PROFILE_ZONE("Cylinder::Cylinder");
     // generate vertices
     std::vector<glm::vec3> vertices;
     for (int i = 0; i < slices; i++)
@@ -123,3 +125,8 @@ void Cylinder::draw(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection)
 
     glDrawElements(GL_TRIANGLE_STRIP, num_indices, GL_UNSIGNED_INT, nullptr);
 }
+
+void Cylinder::submit(RenderQueue &queue, const glm::mat4 &model, const glm::mat4 &view)
+{
+    submit_mesh(queue, vao.ID, num_indices, model, view);
+}
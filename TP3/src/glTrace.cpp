@@ -0,0 +1,233 @@
+#include "glTrace.h"
+
+#ifdef GL_TRACE
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What one frame cost, the functions keyed by the address of their name
+struct GLTraceFrame
+{
+    long long calls = 0;
+    long long draws = 0;
+    long long primitives = 0;
+    long long bufferBytes = 0;
+    long long textureBytes = 0;
+    std::unordered_map<const char*, long long> functions;
+};
+
+static GLTraceFrame frame;
+static GLTraceFrame total;
+static long long frameIndex = 0;
+static bool unpackBufferBound = false;
+static std::ofstream traceFile;
+
+// The GLEW pointers are named __glewBufferData, the functions glBufferData
+static std::string functionName(const char* name)
+{
+    if (strncmp(name, "__glew", 6) == 0)
+    {
+        return std::string("gl") + (name + 6);
+    }
+    return name;
+}
+
+// Sums the counts of the same function, whose name can be at several addresses (one per source file)
+static std::map<std::string, long long> functionCounts(const GLTraceFrame& counts)
+{
+    std::map<std::string, long long> byName;
+    for (const auto& function : counts.functions)
+    {
+        byName[functionName(function.first)] += function.second;
+    }
+    return byName;
+}
+
+// Primitives drawn from count vertices
+static long long primitiveCount(GLenum mode, long long count)
+{
+    switch (mode)
+    {
+    case GL_TRIANGLES:
+        return count / 3;
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:
+        return std::max(0LL, count - 2);
+    case GL_LINES:
+        return count / 2;
+    case GL_LINE_STRIP:
+        return std::max(0LL, count - 1);
+    case GL_LINE_LOOP:
+        return count;
+    default:
+        return count;
+    }
+}
+
+// Size of a pixel in memory, 0 for the combinations not listed
+static long long pixelBytes(GLenum format, GLenum type)
+{
+    long long components;
+    switch (format)
+    {
+    case GL_RED:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+        components = 1;
+        break;
+    case GL_RG:
+    case GL_RG_INTEGER:
+        components = 2;
+        break;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+        components = 3;
+        break;
+    case GL_RGBA:
+    case GL_BGRA:
+    case GL_RGBA_INTEGER:
+        components = 4;
+        break;
+    case GL_DEPTH_STENCIL:
+        // Packed in one value of the type
+        return type == GL_FLOAT_32_UNSIGNED_INT_24_8_REV ? 8 : 4;
+    default:
+        return 0;
+    }
+
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE:
+    case GL_BYTE:
+        return components;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+        return components * 2;
+    case GL_UNSIGNED_INT:
+    case GL_INT:
+    case GL_FLOAT:
+        return components * 4;
+    default:
+        return 0;
+    }
+}
+
+void traceGLCall(const char* name)
+{
+    frame.calls++;
+    frame.functions[name]++;
+}
+
+void traceGLDraw(GLenum mode, GLsizei count, GLsizei instances)
+{
+    frame.draws++;
+    frame.primitives += primitiveCount(mode, count) * instances;
+}
+
+void traceGLBindBuffer(GLenum target, GLuint buffer)
+{
+    if (target == GL_PIXEL_UNPACK_BUFFER)
+    {
+        unpackBufferBound = buffer != 0;
+    }
+}
+
+void traceGLBufferUpload(GLsizeiptr bytes)
+{
+    frame.bufferBytes += bytes;
+}
+
+void traceGLTextureUpload(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+{
+    if (pixels != nullptr && !unpackBufferBound)
+    {
+        frame.textureBytes += (long long)width * height * depth * pixelBytes(format, type);
+    }
+}
+
+void traceGLCompressedUpload(GLsizei bytes, const void* data)
+{
+    if (data != nullptr && !unpackBufferBound)
+    {
+        frame.textureBytes += bytes;
+    }
+}
+
+bool startGLTrace(const char* path)
+{
+    traceFile.open(path);
+    if (!traceFile)
+    {
+        return false;
+    }
+    // The functions of a frame are listed as name:calls separated by spaces
+    traceFile << "frame,calls,draws,primitives,buffer_bytes,texture_bytes,functions" << std::endl;
+    return true;
+}
+
+void endGLTraceFrame()
+{
+    if (traceFile.is_open())
+    {
+        traceFile << frameIndex << "," << frame.calls << "," << frame.draws << "," << frame.primitives << ","
+            << frame.bufferBytes << "," << frame.textureBytes << ",";
+        const char* separator = "";
+        for (const auto& function : functionCounts(frame))
+        {
+            traceFile << separator << function.first << ":" << function.second;
+            separator = " ";
+        }
+        traceFile << "\n";
+    }
+
+    if (frameIndex > 0)
+    {
+        total.calls += frame.calls;
+        total.draws += frame.draws;
+        total.primitives += frame.primitives;
+        total.bufferBytes += frame.bufferBytes;
+        total.textureBytes += frame.textureBytes;
+        for (const auto& function : frame.functions)
+        {
+            total.functions[function.first] += function.second;
+        }
+    }
+    frame = GLTraceFrame();
+    frameIndex++;
+}
+
+void printGLTraceSummary()
+{
+    long long frames = std::max(1LL, frameIndex - 1);
+    std::cout << "GL calls per frame over " << frameIndex - 1 << " frames: " << (double)total.calls / frames << " calls, "
+        << (double)total.draws / frames << " draws, " << (double)total.primitives / frames << " primitives, "
+        << (double)total.bufferBytes / frames / 1024 << " KiB to buffers, " << (double)total.textureBytes / frames / 1024 << " KiB to textures" << std::endl;
+
+    std::map<std::string, long long> byName = functionCounts(total);
+    std::vector<std::pair<long long, std::string>> busiest;
+    for (const auto& function : byName)
+    {
+        busiest.push_back(std::make_pair(function.second, function.first));
+    }
+    std::sort(busiest.rbegin(), busiest.rend());
+    std::cout << "most called:";
+    for (size_t i = 0; i < busiest.size() && i < 8; i++)
+    {
+        std::cout << " " << busiest[i].second << " " << (double)busiest[i].first / frames;
+    }
+    std::cout << std::endl;
+    if (traceFile.is_open())
+    {
+        traceFile.close();
+    }
+}
+
+#endif
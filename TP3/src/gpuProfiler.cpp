@@ -0,0 +1,206 @@
+#include "gpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+GPUProfiler::GPUProfiler(int frame_latency)
+{
+    ring_.resize(std::max(1, frame_latency));
+}
+
+bool GPUProfiler::enable()
+{
+    // a driver may accept the queries without a counter behind them
+    GLint bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+    enabled_ = bits > 0;
+    if (!enabled_)
+    {
+        std::cout << "no GPU timestamp counter, GPU profiling disabled" << std::endl;
+    }
+    return enabled_;
+}
+
+GLuint GPUProfiler::next_query(Frame &frame)
+{
+    if (frame.used_queries == frame.queries.size())
+    {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    return frame.queries[frame.used_queries++];
+}
+
+void GPUProfiler::collect(Frame &frame)
+{
+    if (frame.scopes.empty())
+    {
+        return;
+    }
+
+    // the end of the frame scope is the last query written
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(frame.scopes[0].end, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+        stalls_++;
+    }
+
+    std::vector<std::string> paths(frame.scopes.size());
+    for (size_t i = 0; i < frame.scopes.size(); i++)
+    {
+        const Scope &scope = frame.scopes[i];
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(scope.start, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(scope.end, GL_QUERY_RESULT, &end);
+        double ms = end > start ? (end - start) / 1e6 : 0.0;
+
+        // a parent is always recorded before its children
+        paths[i] = scope.parent >= 0 ? paths[scope.parent] + "/" + scope.name : scope.name;
+        auto found = scope_index_.find(paths[i]);
+        if (found == scope_index_.end())
+        {
+            GPUScopeStats stats;
+            stats.path = paths[i];
+            stats.depth = (int)std::count(paths[i].begin(), paths[i].end(), '/');
+            stats.min_ms = ms;
+            stats.max_ms = ms;
+            found = scope_index_.emplace(paths[i], scopes_.size()).first;
+            scopes_.push_back(stats);
+        }
+        GPUScopeStats &stats = scopes_[found->second];
+        stats.calls++;
+        stats.total_ms += ms;
+        stats.min_ms = std::min(stats.min_ms, ms);
+        stats.max_ms = std::max(stats.max_ms, ms);
+    }
+    frames_++;
+    frame.scopes.clear();
+    frame.used_queries = 0;
+}
+
+void GPUProfiler::begin_frame()
+{
+    if (!enabled_)
+    {
+        return;
+    }
+    current_ = (current_ + 1) % ring_.size();
+    collect(ring_[current_]);
+    stack_.clear();
+    push("frame");
+}
+
+void GPUProfiler::end_frame()
+{
+    if (!enabled_)
+    {
+        return;
+    }
+    pop();
+}
+
+void GPUProfiler::push(const char *name)
+{
+    if (!enabled_)
+    {
+        return;
+    }
+    Frame &frame = ring_[current_];
+    Scope scope;
+    scope.name = name;
+    scope.parent = stack_.empty() ? -1 : stack_.back();
+    scope.start = next_query(frame);
+    scope.end = next_query(frame);
+    glQueryCounter(scope.start, GL_TIMESTAMP);
+    stack_.push_back((int)frame.scopes.size());
+    frame.scopes.push_back(scope);
+}
+
+void GPUProfiler::pop()
+{
+    if (!enabled_ || stack_.empty())
+    {
+        return;
+    }
+    glQueryCounter(ring_[current_].scopes[stack_.back()].end, GL_TIMESTAMP);
+    stack_.pop_back();
+}
+
+void GPUProfiler::finish()
+{
+    if (!enabled_)
+    {
+        return;
+    }
+    // oldest first, including the frame being recorded if it was closed
+    for (size_t i = 1; i <= ring_.size(); i++)
+    {
+        collect(ring_[(current_ + i) % ring_.size()]);
+    }
+}
+
+bool GPUProfiler::write(const std::string &path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "failed writing " << path << std::endl;
+        return false;
+    }
+    long long per_frame = std::max(1LL, frames_);
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (json)
+    {
+        file << "{\n    \"frames\": " << frames_ << ",\n    \"stalls\": " << stalls_ << ",\n    \"scopes\": [";
+        for (size_t i = 0; i < scopes_.size(); i++)
+        {
+            const GPUScopeStats &scope = scopes_[i];
+            // scope names are plain identifiers, nothing to escape
+            file << (i > 0 ? ",\n" : "\n") << "        { \"scope\": \"" << scope.path << "\", \"depth\": " << scope.depth
+                 << ", \"calls\": " << scope.calls << ", \"ms_per_frame\": " << scope.total_ms / per_frame
+                 << ", \"avg_ms\": " << scope.total_ms / scope.calls << ", \"min_ms\": " << scope.min_ms
+                 << ", \"max_ms\": " << scope.max_ms << " }";
+        }
+        file << "\n    ]\n}\n";
+    }
+    else
+    {
+        file << "scope,depth,calls,ms_per_frame,avg_ms,min_ms,max_ms\n";
+        for (const GPUScopeStats &scope : scopes_)
+        {
+            file << scope.path << "," << scope.depth << "," << scope.calls << "," << scope.total_ms / per_frame << ","
+                 << scope.total_ms / scope.calls << "," << scope.min_ms << "," << scope.max_ms << "\n";
+        }
+    }
+    return true;
+}
+
+void GPUProfiler::print() const
+{
+    long long per_frame = std::max(1LL, frames_);
+    std::cout << "GPU time per frame over " << frames_ << " frames (" << stalls_ << " waits for results):" << std::endl;
+    for (const GPUScopeStats &scope : scopes_)
+    {
+        size_t name_start = scope.path.rfind('/');
+        std::cout << std::string(2 * (scope.depth + 1), ' ')
+                  << scope.path.substr(name_start == std::string::npos ? 0 : name_start + 1) << " "
+                  << scope.total_ms / per_frame << " ms" << std::endl;
+    }
+}
+
+void GPUProfiler::destroy()
+{
+    for (Frame &frame : ring_)
+    {
+        if (!frame.queries.empty())
+        {
+            glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+        }
+        frame.queries.clear();
+        frame.scopes.clear();
+        frame.used_queries = 0;
+    }
+}
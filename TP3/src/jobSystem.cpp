@@ -0,0 +1,190 @@
+#include "jobSystem.h"
+
+#include <algorithm>
+
+// system and index of the worker running on this thread, if any
+static thread_local const JobSystem *current_system = nullptr;
+static thread_local int current_index = -1;
+
+JobSystem::JobSystem(unsigned int workers)
+{
+    if (workers == 0)
+    {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        workers = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    for (unsigned int i = 0; i <= workers; i++)
+    {
+        queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (unsigned int i = 0; i < workers; i++)
+    {
+        workers_.emplace_back(&JobSystem::worker_loop, this, (int)i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    stopping_ = true;
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    wake_up_.notify_all();
+
+    for (std::thread &worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+int JobSystem::current_worker() const
+{
+    return current_system == this ? current_index : -1;
+}
+
+void JobSystem::push(Job job)
+{
+    int worker = current_worker();
+    Queue &queue = *queues_[worker >= 0 ? worker : workers_.size()];
+    // counted before it is visible, a worker woken up for it never finds one job less than there is
+    queued_++;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    {
+        // the sleepers test queued_ under this lock, taking it means the notification can't fall in between
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    wake_up_.notify_one();
+}
+
+bool JobSystem::take(int worker, Job &job)
+{
+    // own jobs first, newest first
+    if (worker >= 0)
+    {
+        Queue &own = *queues_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty())
+        {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            queued_--;
+            return true;
+        }
+    }
+
+    // then the shared queue, then the oldest job of the other workers, starting with the next one
+    size_t count = queues_.size();
+    size_t start = worker >= 0 ? worker + 1 : workers_.size();
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t index = (start + i) % count;
+        if ((int)index == worker)
+        {
+            continue;
+        }
+        Queue &other = *queues_[index];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.jobs.empty())
+        {
+            job = std::move(other.jobs.front());
+            other.jobs.pop_front();
+            queued_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobSystem::run_one(int worker)
+{
+    Job job;
+    if (!take(worker, job))
+    {
+        return false;
+    }
+    job.work();
+    finish(job.counter);
+    return true;
+}
+
+void JobSystem::finish(JobCounter *counter)
+{
+    if (counter == nullptr)
+    {
+        return;
+    }
+    counter->finishing_++;
+    counter->pending_--;
+    counter->finishing_--;
+}
+
+void JobSystem::run(std::function<void()> job, JobCounter *counter)
+{
+    if (counter != nullptr)
+    {
+        counter->pending_++;
+    }
+    push(Job{std::move(job), counter});
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    int worker = current_worker();
+    while (!counter.done())
+    {
+        // the jobs left may all be running already, with nothing to help with
+        if (!run_one(worker))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::parallel_for(int begin, int end, int grain, const std::function<void(int, int)> &body)
+{
+    grain = std::max(1, grain);
+    if (end - begin <= grain)
+    {
+        if (end > begin)
+        {
+            body(begin, end);
+        }
+        return;
+    }
+
+    JobCounter counter;
+    int first = begin;
+    for (; end - first > grain; first += grain)
+    {
+        int last = first + grain;
+        run([&body, first, last]() { body(first, last); }, &counter);
+    }
+    // the last range runs here, the caller would only wait otherwise
+    body(first, end);
+    wait(counter);
+}
+
+void JobSystem::worker_loop(int worker)
+{
+    current_system = this;
+    current_index = worker;
+    while (true)
+    {
+        if (run_one(worker))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_up_.wait(lock, [this]() { return stopping_ || queued_.load() > 0; });
+        // the queues are drained before stopping
+        if (stopping_ && queued_.load() <= 0)
+        {
+            return;
+        }
+    }
+}
@@ -1,7 +1,9 @@
 #include <iostream>
-#include <GL/glew.h>
+#include "glTrace.h"
 #include <GLFW/glfw3.h>
 #include <math.h>
+#include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -16,6 +18,15 @@
 #include "node.h"
 #include "cylinder.h"
 #include "sphere.h"
+#include "clock.h"
+#include "benchmark.h"
+#include "renderQueue.h"
+#include "gpuProfiler.h"
+#include "cpuProfiler.h"
+#include "golden.h"
+#include "renderThread.h"
+#include "jobSystem.h"
+#include "sceneRecorder.h"
 
 // screen size
 const unsigned int width = 1000;
@@ -26,17 +37,150 @@ const float FOV = 45.0f;
 const float nearPlane = 0.1f;
 const float farPlane = 100.0f;
 
-// constants for the animation
-float rightUpperAngle = 0.0f;
-float rightLowerAngle = 0.0f;
-float leftUpperAngle = 0.0f;
-float leftLowerAngle = 0.0f;
+// constants for the animation, in degrees (or units) per second
+const float upperSpeed = 60.0f;
+const float lowerSpeed = 90.0f;
+const float walkSpeed = 6.0f;
+
+// frame of the walk cycle compared with the golden image
+const int golden_frames = 30;
+
+// state of the walk cycle, everything the skeleton pose is built from
+struct Pose
+{
+    float rightUpperAngle = 0.0f;
+    float rightLowerAngle = 0.0f;
+    float leftUpperAngle = 0.0f;
+    float leftLowerAngle = 0.0f;
+    float walked = 0.0f;
+};
+
 bool starting = true;
 bool rightDone = false;
 bool leftDone = false;
 
-int main()
+// a node rotated by one of the pose angles on top of its rest transform
+struct Joint
+{
+    Node *node;
+    glm::mat4 rest;
+    float Pose::*angle;
+    glm::vec3 axis;
+};
+
+// advances the walk cycle by dt seconds
+void animate(Pose &pose, float dt)
+{
+    float upper = upperSpeed * dt;
+    float lower = lowerSpeed * dt;
+
+    if (starting)
+    {
+        pose.rightUpperAngle += upper;
+        pose.leftLowerAngle += lower;
+        if (pose.rightUpperAngle >= 30.0f)
+        {
+            starting = false;
+            rightDone = true;
+        }
+    }
+    else if (rightDone)
+    {
+        pose.rightUpperAngle -= upper;
+        pose.leftLowerAngle -= lower;
+        pose.leftUpperAngle += upper;
+        pose.rightLowerAngle += lower;
+        if (pose.rightUpperAngle <= 0.0f)
+        {
+            rightDone = false;
+            leftDone = true;
+        }
+    }
+    else if (leftDone)
+    {
+        pose.rightUpperAngle += upper;
+        pose.leftLowerAngle += lower;
+        pose.leftUpperAngle -= upper;
+        pose.rightLowerAngle -= lower;
+        if (pose.rightUpperAngle >= 30.0f)
+        {
+            leftDone = false;
+            rightDone = true;
+        }
+    }
+
+    pose.walked += walkSpeed * dt;
+}
+
+// blends two poses, alpha = 1 giving the second one
+Pose mix(const Pose &a, const Pose &b, float alpha)
 {
+    Pose pose;
+    pose.rightUpperAngle = glm::mix(a.rightUpperAngle, b.rightUpperAngle, alpha);
+    pose.rightLowerAngle = glm::mix(a.rightLowerAngle, b.rightLowerAngle, alpha);
+    pose.leftUpperAngle = glm::mix(a.leftUpperAngle, b.leftUpperAngle, alpha);
+    pose.leftLowerAngle = glm::mix(a.leftLowerAngle, b.leftLowerAngle, alpha);
+    pose.walked = glm::mix(a.walked, b.walked, alpha);
+    return pose;
+}
+
+// whether option is one of the command line arguments
+bool has_option(int argc, char *argv[], const char *option)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == option)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// argument following option, nullptr if it isn't given
+const char *option_value(int argc, char *argv[], const char *option)
+{
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::string(argv[i]) == option)
+        {
+            return argv[i + 1];
+        }
+    }
+    return nullptr;
+}
+
+// run with --deterministic to simulate exactly one step per frame whatever the frame rate,
+// with --immediate to draw straight from the scene graph instead of through the recorded command buffers,
+// with --render-thread to draw the recorded frames on a thread of their own while the next one is simulated,
+// with --gl-trace file.csv to write the GL calls of each frame to a file (built with -DGL_TRACE=ON),
+// with --gpu-profile file.csv (or .json) to time the frame and the scene on the GPU,
+// with --cpu-trace file.json to record the CPU zones from the start, for chrome://tracing,
+// with --golden image.ppm to walk deterministically offscreen and compare the frame with the image (--golden-update rewrites it),
+// with --bench-math to time the batch math kernels and exit,
+// with --bench-record to time the recording of a large tree from 1 to N workers, and its submission, and exit
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && std::string(argv[1]) == "--bench-math")
+    {
+        benchmark_math();
+        return 0;
+    }
+    const char *cpu_trace_path = option_value(argc, argv, "--cpu-trace");
+    if (cpu_trace_path != nullptr)
+    {
+        start_cpu_profile();
+    }
+    const char *golden_path = option_value(argc, argv, "--golden");
+    bool golden_update = has_option(argc, argv, "--golden-update");
+    bool deterministic = golden_path != nullptr || has_option(argc, argv, "--deterministic");
+    bool immediate = has_option(argc, argv, "--immediate");
+    bool threaded = has_option(argc, argv, "--render-thread");
+    const char *trace_path = option_value(argc, argv, "--gl-trace");
+    if (trace_path != nullptr && !startGLTrace(trace_path))
+    {
+        std::cout << "no GL trace written to " << trace_path << " (needs a GL_TRACE build)" << std::endl;
+    }
 
     // Init GLFW
     glfwInit();
@@ -45,6 +189,10 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (golden_path != nullptr)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
 
     // create window
     GLFWwindow *window = glfwCreateWindow(width, height, "TP3 - Julien TAP", NULL, NULL);
@@ -69,6 +217,15 @@ int main()
     // create shaders
     Shader shaderProgram("./shaders/default.vert.txt", "./shaders/default.frag.txt");
 
+    if (argc > 1 && std::string(argv[1]) == "--bench-record")
+    {
+        benchmark_recording(shaderProgram);
+        shaderProgram.Delete();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
+
     //  set some options
     glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -207,97 +364,249 @@ int main()
     rightLowerLegNode->add(rightAnkleNode);
     leftLowerLegNode->add(leftAnkleNode);
 
-    while (!glfwWindowShouldClose(window))
+    // joints moved by the animation, the rest transforms are the ones built above
+    glm::mat4 rootRest = root->get_transform();
+    std::vector<Joint> joints = {
+        {rightShoulderNode, rightShoulderNode->get_transform(), &Pose::rightUpperAngle, glm::vec3(0.0f, 0.0f, -1.0f)},
+        {rightElbowNode, rightElbowNode->get_transform(), &Pose::rightUpperAngle, glm::vec3(1.0f, 0.0f, 0.0f)},
+        {leftShoulderNode, leftShoulderNode->get_transform(), &Pose::leftUpperAngle, glm::vec3(0.0f, 0.0f, -1.0f)},
+        {leftElbowNode, leftElbowNode->get_transform(), &Pose::leftUpperAngle, glm::vec3(1.0f, 0.0f, 0.0f)},
+        {rightHipNode, rightHipNode->get_transform(), &Pose::rightLowerAngle, glm::vec3(0.0f, 0.0f, -1.0f)},
+        {rightKneeNode, rightKneeNode->get_transform(), &Pose::rightLowerAngle, glm::vec3(-1.0f, 0.0f, 0.0f)},
+        {leftHipNode, leftHipNode->get_transform(), &Pose::leftLowerAngle, glm::vec3(0.0f, 0.0f, -1.0f)},
+        {leftKneeNode, leftKneeNode->get_transform(), &Pose::leftLowerAngle, glm::vec3(-1.0f, 0.0f, 0.0f)},
+    };
+    Pose pose;
+    Pose previousPose;
+
+    // the simulation runs at a fixed 60 steps per second, the rendering at whatever rate it can
+    SystemClock systemClock;
+    ManualClock manualClock;
+    Clock *clock = &systemClock;
+    if (deterministic)
     {
+        clock = &manualClock;
+    }
+    FixedTimestep timestep(*clock);
+
+    // draws of the frame, recorded by the workers, and the GL calls they took over all the frames
+    JobSystem jobs;
+    SceneRecorder recorder(jobs);
+    FrameSnapshot snapshot;
+    RenderStats issued;
+    RenderStats unsorted;
+    long long frames = 0;
+
+    // GPU timers of the scene, once there is a context
+    const char *gpu_profile_path = option_value(argc, argv, "--gpu-profile");
+    GPUProfiler gpu_profiler;
+    if (gpu_profile_path != nullptr)
+    {
+        gpu_profiler.enable();
+    }
+
+    // the golden frames go to a target of their own, the size of the window whatever the screen allows
+    OffscreenTarget *golden_target = nullptr;
+    bool golden_passed = true;
+    if (golden_path != nullptr)
+    {
+        golden_target = new OffscreenTarget(width, height);
+        if (!golden_target->complete())
+        {
+            // no frame is drawn, the shutdown below still runs and the exit code reports the failure
+            std::cout << "offscreen target not supported, no golden image check" << std::endl;
+            golden_passed = false;
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+        else
+        {
+            golden_target->bind();
+        }
+    }
 
+    // end of a frame on the GL side: the golden check, then the swap
+    auto present = [&](long long frame) {
+        if (golden_target != nullptr && frame + 1 == golden_frames)
+        {
+            golden_passed = check_golden(downsample(golden_target->read(), 4), golden_path, golden_update);
+        }
+        PROFILE_ZONE("swap");
+        glfwSwapBuffers(window);
+        endGLTraceFrame();
+    };
+
+    // replays a recorded frame, on the render thread if there is one
+    auto render = [&](FrameSnapshot &shown) {
+        PROFILE_ZONE("render");
+        gpu_profiler.begin_frame();
         glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // activate shader
-        shaderProgram.Activate();
+        gpu_profiler.push("scene");
+        RenderStats drawn = shown.commands.replay(shown.view, shown.projection);
+        issued.draws += drawn.draws;
+        issued.program_binds += drawn.program_binds;
+        issued.vao_binds += drawn.vao_binds;
+        issued.uniform_uploads += drawn.uniform_uploads;
+        gpu_profiler.pop();
+        gpu_profiler.end_frame();
+
+        present(shown.frame);
+    };
+
+    // from here on the context belongs to the render thread, this one only simulates and records
+    RenderThread *render_thread = nullptr;
+    if (threaded && immediate)
+    {
+        std::cout << "--immediate draws during the traversal, no render thread" << std::endl;
+    }
+    else if (threaded)
+    {
+        render_thread = new RenderThread(window, render);
+    }
+    SystemClock loop_clock;
+
+    while (!glfwWindowShouldClose(window))
+    {
+        PROFILE_ZONE("frame");
+        {
+            PROFILE_ZONE("simulation");
+            if (deterministic)
+            {
+                manualClock.Advance(timestep.Step());
+            }
+
+            for (int steps = timestep.Advance(); steps > 0; steps--)
+            {
+                // check camera inputs
+                camera.Inputs(window, timestep.Step());
+
+                // animation (while F key is pressed, always for the golden image)
+                previousPose = pose;
+                if (golden_path != nullptr || glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
+                {
+                    animate(pose, timestep.Step());
+                }
+            }
+        }
+        float alpha = timestep.Alpha();
 
-        // check camera inputs
-        camera.Inputs(window);
+        // poses the skeleton between the two last steps
+        {
+            PROFILE_ZONE("pose");
+            Pose shown = mix(previousPose, pose, alpha);
+            for (const Joint &joint : joints)
+            {
+                joint.node->set_transform(joint.rest * glm::rotate(glm::mat4(1.0f), glm::radians(shown.*joint.angle), joint.axis));
+            }
+            root->set_transform(rootRest * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, shown.walked, 0.0f)));
+        }
 
         // Retrieve view and projection matrices
-        glm::mat4 viewMatrix = camera.getViewMatrix();
+        glm::mat4 viewMatrix = camera.getViewMatrix(alpha);
         glm::mat4 projectionMatrix = camera.getProjectionMatrix();
 
         glm::mat4 modelMatrix = glm::mat4(1.0f);
 
-        // draw the root node
-        root->draw(modelMatrix, viewMatrix, projectionMatrix);
+        if (immediate)
+        {
+            gpu_profiler.begin_frame();
+            glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            gpu_profiler.push("scene");
+            // activate shader
+            shaderProgram.Activate();
 
-        // animation (while F key is pressed)
-        if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
+            // draw the root node
+            root->draw(modelMatrix, viewMatrix, projectionMatrix);
+            gpu_profiler.pop();
+            gpu_profiler.end_frame();
+
+            present(frames);
+        }
+        else
         {
-            if (starting)
+            // record the draws of the whole tree, subtrees in parallel, into a snapshot the GL side won't touch until it is published
+            FrameSnapshot &next = render_thread != nullptr ? render_thread->acquire() : snapshot;
             {
-                rightUpperAngle += 1.0f;
-                leftLowerAngle += 1.5f;
-                rightShoulderNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
-                rightElbowNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
-                leftHipNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.5f), glm::vec3(0.0f, 0.0f, -1.0f)));
-                leftKneeNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.5f), glm::vec3(-1.0f, 0.0f, 0.0f)));
-                if (rightUpperAngle >= 30.0f)
-                {
-                    starting = false;
-                    rightDone = true;
-                }
+                PROFILE_ZONE("record");
+                recorder.record(*root, modelMatrix, viewMatrix, next.commands);
             }
-            else if (rightDone)
+            next.view = viewMatrix;
+            next.projection = projectionMatrix;
+            next.frame = frames;
+            RenderStats naive = recorder.unsorted_cost();
+            unsorted.program_binds += naive.program_binds;
+            unsorted.vao_binds += naive.vao_binds;
+            unsorted.uniform_uploads += naive.uniform_uploads;
+
+            if (render_thread != nullptr)
             {
-                rightUpperAngle -= 1.0f;
-                leftLowerAngle -= 1.5f;
-                leftUpperAngle += 1.0f;
-                rightLowerAngle += 1.5f;
-                rightShoulderNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(-1.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
-                rightElbowNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(-1.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
-                leftHipNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(-1.5f), glm::vec3(0.0f, 0.0f, -1.0f)));
-                leftKneeNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(-1.5f), glm::vec3(-1.0f, 0.0f, 0.0f)));
-                leftShoulderNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
-                leftElbowNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
-                rightHipNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.5f), glm::vec3(0.0f, 0.0f, -1.0f)));
-                rightKneeNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.5f), glm::vec3(-1.0f, 0.0f, 0.0f)));
-                if (rightUpperAngle <= 0.0f)
-                {
-                    rightDone = false;
-                    leftDone = true;
-                }
+                render_thread->publish();
             }
-            else if (leftDone)
+            else
             {
-                rightUpperAngle += 1.0f;
-                leftLowerAngle += 1.5f;
-                leftUpperAngle -= 1.0f;
-                rightLowerAngle -= 1.5f;
-                rightShoulderNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
-                rightElbowNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
-                leftHipNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.5f), glm::vec3(0.0f, 0.0f, -1.0f)));
-                leftKneeNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(1.5f), glm::vec3(-1.0f, 0.0f, 0.0f)));
-                leftShoulderNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(-1.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
-                leftElbowNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(-1.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
-                rightHipNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(-1.5f), glm::vec3(0.0f, 0.0f, -1.0f)));
-                rightKneeNode->transform(glm::rotate(glm::mat4(1.0f), glm::radians(-1.5f), glm::vec3(-1.0f, 0.0f, 0.0f)));
-                if (rightUpperAngle >= 30.0f)
-                {
-                    leftDone = false;
-                    rightDone = true;
-                }
+                render(next);
             }
-
-            root->transform(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.1f, 0.0f)));
         }
+        frames++;
 
-        glfwSwapBuffers(window);
+        // the golden frame is the last one recorded, the render thread still draws it before stopping
+        if (golden_target != nullptr && frames == golden_frames)
+        {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
         glfwPollEvents();
     }
 
+    double loop_seconds = loop_clock.Now();
+    if (render_thread != nullptr)
+    {
+        render_thread->stop();
+        std::cout << "render thread: " << (frames > 0 ? loop_seconds * 1000.0 / frames : 0.0) << " ms per frame, the main thread waited "
+                  << (frames > 0 ? render_thread->main_wait_ms() / frames : 0.0) << " ms per frame for a free snapshot, the render thread "
+                  << (frames > 0 ? render_thread->render_wait_ms() / frames : 0.0) << " ms for a published one" << std::endl;
+        delete render_thread;
+    }
+    else
+    {
+        std::cout << "single thread: " << (frames > 0 ? loop_seconds * 1000.0 / frames : 0.0) << " ms per frame" << std::endl;
+    }
+
+    if (!immediate && frames > 0)
+    {
+        std::cout << issued.draws / frames << " draws per frame, state changes per frame: "
+                  << (double)unsorted.state_changes() / frames << " drawing shape by shape ("
+                  << unsorted.program_binds / frames << " programs, " << unsorted.vao_binds / frames << " VAOs, "
+                  << unsorted.uniform_uploads / frames << " uniforms), " << (double)issued.state_changes() / frames
+                  << " through the command buffers (" << issued.program_binds / frames << " programs, "
+                  << issued.vao_binds / frames << " VAOs, " << issued.uniform_uploads / frames << " uniforms)" << std::endl;
+    }
+
+    printGLTraceSummary();
+    if (cpu_profile_started())
+    {
+        write_cpu_profile(cpu_trace_path);
+    }
+    if (gpu_profiler.enabled())
+    {
+        gpu_profiler.finish();
+        gpu_profiler.print();
+        gpu_profiler.write(gpu_profile_path);
+    }
+    gpu_profiler.destroy();
+    if (golden_target != nullptr)
+    {
+        golden_target->destroy();
+        delete golden_target;
+    }
+
     // delete shaders
     shaderProgram.Delete();
 
     // delete window and terminate
     glfwDestroyWindow(window);
     glfwTerminate();
-    return 0;
+    return golden_passed ? 0 : 1;
 }
\ No newline at end of file
@@ -1,41 +1,118 @@
-#include "node.h"
-#include "shape.h"
-#include <iostream>
-
-Node::Node(const glm::mat4 &transform) : transform_(transform)
-{
-    children_ = std::vector<Node *>();
-}
-
-void Node::add(Node *node)
-{
-    children_.push_back(node);
-}
-
-void Node::add(Shape *shape)
-{
-    children_shape_.push_back(shape);
-}
-
-void Node::draw(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection)
-{
-    glm::mat4 updatedModel = model * transform_;
-
-    for (auto child : children_)
-    {
-        child->draw(updatedModel, view, projection);
-    }
-
-    for (auto child : children_shape_)
-    {
-        child->draw(updatedModel, view, projection);
-    }
-}
-
-void Node::key_handler(int key) const
-{
-    for (const auto &child : children_)
-    {
-        child->key_handler(key);
-    }
-}
+#include "node.h"
+#include "shape.h"
+#include "batchMath.h"
+#include "cpuProfiler.h"
+#include <iostream>
+
+Node::Node(const glm::mat4 &transform) : transform_(transform)
+{
+    children_ = std::vector<Node *>();
+}
+
+void Node::add(Node *node)
+{
+    children_.push_back(node);
+}
+
+void Node::add(Shape *shape)
+{
+    children_shape_.push_back(shape);
+}
+
+void Node::draw(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection)
+{
+    PROFILE_ZONE("Node::draw");
+    glm::mat4 updatedModel = model * transform_;
+    draw_world(updatedModel, view, projection);
+}
+
+void Node::submit(RenderQueue &queue, const glm::mat4 &model, const glm::mat4 &view)
+{
+    PROFILE_ZONE("Node::submit");
+    submit_world(queue, model * transform_, view);
+}
+
+void Node::split(const glm::mat4 &model, size_t count, std::vector<Subtree> &parts)
+{
+    parts.clear();
+    parts.push_back({this, model * transform_, false});
+
+    // a node split keeps its shapes, each child becomes a part
+    for (size_t next = 0; next < parts.size() && parts.size() < count; next++)
+    {
+        Node *node = parts[next].node;
+        if (node->children_.empty())
+        {
+            continue;
+        }
+        parts[next].shapes_only = true;
+        node->update_children(parts[next].world);
+        for (size_t i = 0; i < node->children_.size(); i++)
+        {
+            parts.push_back({node->children_[i], node->child_worlds_[i], false});
+        }
+    }
+}
+
+void Node::submit_part(const Subtree &part, RenderQueue &queue, const glm::mat4 &view)
+{
+    if (!part.shapes_only)
+    {
+        part.node->submit_world(queue, part.world, view);
+        return;
+    }
+    for (auto child : part.node->children_shape_)
+    {
+        child->submit(queue, part.world, view);
+    }
+}
+
+void Node::update_children(const glm::mat4 &world)
+{
+    // world transforms of all the children in one batch
+    child_locals_.resize(children_.size());
+    child_worlds_.resize(children_.size());
+    for (size_t i = 0; i < children_.size(); i++)
+    {
+        child_locals_[i] = children_[i]->transform_;
+    }
+    multiply_matrices(world, child_locals_.data(), child_worlds_.data(), children_.size());
+}
+
+void Node::draw_world(glm::mat4 &world, glm::mat4 &view, glm::mat4 &projection)
+{
+    update_children(world);
+
+    for (size_t i = 0; i < children_.size(); i++)
+    {
+        children_[i]->draw_world(child_worlds_[i], view, projection);
+    }
+
+    for (auto child : children_shape_)
+    {
+        child->draw(world, view, projection);
+    }
+}
+
+void Node::submit_world(RenderQueue &queue, const glm::mat4 &world, const glm::mat4 &view)
+{
+    update_children(world);
+
+    for (size_t i = 0; i < children_.size(); i++)
+    {
+        children_[i]->submit_world(queue, child_worlds_[i], view);
+    }
+
+    for (auto child : children_shape_)
+    {
+        child->submit(queue, world, view);
+    }
+}
+
+void Node::key_handler(int key) const
+{
+    for (const auto &child : children_)
+    {
+        child->key_handler(key);
+    }
+}
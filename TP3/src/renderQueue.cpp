@@ -0,0 +1,103 @@
+#include "renderQueue.h"
+#include "cpuProfiler.h"
+
+#include <algorithm>
+
+uint64_t make_sort_key(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth)
+{
+    // closest first for the early depth test
+    float normalized = std::min(std::max(depth / SORT_DEPTH_RANGE, 0.0f), 1.0f);
+    uint64_t depth_bits = (uint64_t)(normalized * 0xFFFFFF);
+
+    return ((uint64_t)(pass & 0x3) << 62) | ((uint64_t)(shader & 0x3FF) << 52) | ((uint64_t)(material & 0x3FF) << 42) |
+           ((uint64_t)(mesh & 0xFFFF) << 26) | (depth_bits << 2);
+}
+
+void RenderQueue::clear()
+{
+    commands_.clear();
+    transforms_.clear();
+    // the order refers to the commands cleared, record sorts again whatever the count
+    order_.clear();
+}
+
+void RenderQueue::push(uint64_t key, GLuint program, GLuint vao, GLenum mode, GLsizei count, const glm::mat4 &model)
+{
+    DrawCommand command;
+    command.key = key;
+    command.program = program;
+    command.vao = vao;
+    command.mode = mode;
+    command.count = count;
+    command.transform = (uint32_t)transforms_.size();
+    commands_.push_back(command);
+    transforms_.push_back(model);
+}
+
+void RenderQueue::sort()
+{
+    PROFILE_ZONE("RenderQueue::sort");
+    size_t count = commands_.size();
+    order_.resize(count);
+    scratch_.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        order_[i] = (uint32_t)i;
+    }
+
+    // least significant byte first, each pass stable, so the order ends up sorted on the whole key
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t histogram[256] = {};
+        for (uint32_t index : order_)
+        {
+            histogram[(commands_[index].key >> shift) & 0xFF]++;
+        }
+        if (count == 0 || histogram[(commands_[order_[0]].key >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        size_t offsets[256];
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            offsets[digit] = offset;
+            offset += histogram[digit];
+        }
+        for (uint32_t index : order_)
+        {
+            scratch_[offsets[(commands_[index].key >> shift) & 0xFF]++] = index;
+        }
+        order_.swap(scratch_);
+    }
+}
+
+void RenderQueue::record(CommandBuffer &commands)
+{
+    PROFILE_ZONE("RenderQueue::record");
+    // push leaves the order out of date, and clear empties it
+    if (order_.size() != commands_.size())
+    {
+        sort();
+    }
+    for (uint32_t index : order_)
+    {
+        const DrawCommand &command = commands_[index];
+        commands.bind_program(command.program);
+        commands.bind_mesh(command.vao);
+        commands.set_matrix(UNIFORM_MODEL, transforms_[command.transform]);
+        commands.draw(command.mode, command.count);
+    }
+}
+
+RenderStats RenderQueue::unsorted_cost() const
+{
+    // Shape::draw binds the program and the VAO and uploads the three matrices for every draw
+    RenderStats stats;
+    stats.draws = (int)commands_.size();
+    stats.program_binds = stats.draws;
+    stats.vao_binds = stats.draws;
+    stats.uniform_uploads = 3 * stats.draws;
+    return stats;
+}
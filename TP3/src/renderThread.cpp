@@ -0,0 +1,88 @@
+#include "renderThread.h"
+#include "cpuProfiler.h"
+
+#include <chrono>
+
+// milliseconds since start
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+RenderThread::RenderThread(GLFWwindow *window, std::function<void(FrameSnapshot &)> render)
+    : window_(window), render_(std::move(render))
+{
+    // a context is current on one thread at a time
+    glfwMakeContextCurrent(nullptr);
+    thread_ = std::thread(&RenderThread::loop, this);
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+}
+
+FrameSnapshot &RenderThread::acquire()
+{
+    PROFILE_ZONE("wait for snapshot");
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this]() { return states_[write_] == SlotState::FREE; });
+    main_wait_ms_ += elapsed_ms(start);
+    return snapshots_[write_];
+}
+
+void RenderThread::publish()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        states_[write_] = SlotState::PUBLISHED;
+        write_ = 1 - write_;
+    }
+    changed_.notify_all();
+}
+
+void RenderThread::stop()
+{
+    if (!thread_.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+    glfwMakeContextCurrent(window_);
+}
+
+void RenderThread::loop()
+{
+    glfwMakeContextCurrent(window_);
+    while (true)
+    {
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [this]() { return stopping_ || states_[read_] == SlotState::PUBLISHED; });
+            // the snapshots published before stop are still drawn
+            if (states_[read_] != SlotState::PUBLISHED)
+            {
+                break;
+            }
+            states_[read_] = SlotState::DRAWING;
+            render_wait_ms_ += elapsed_ms(start);
+        }
+
+        render_(snapshots_[read_]);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            states_[read_] = SlotState::FREE;
+            read_ = 1 - read_;
+        }
+        changed_.notify_all();
+    }
+    glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,52 @@
+#include "sceneRecorder.h"
+#include "cpuProfiler.h"
+
+SceneRecorder::SceneRecorder(JobSystem &jobs, size_t parts_per_thread) : jobs_(jobs), parts_per_thread_(parts_per_thread)
+{
+}
+
+void SceneRecorder::record(Node &root, const glm::mat4 &model, const glm::mat4 &view, CommandBuffer &commands)
+{
+    PROFILE_ZONE("SceneRecorder::record");
+    root.split(model, parts_per_thread_ * (jobs_.size() + 1), parts_);
+    if (queues_.size() < parts_.size())
+    {
+        queues_.resize(parts_.size());
+        buffers_.resize(parts_.size());
+    }
+
+    // no GL call until the replay, so the parts can be recorded on any thread
+    jobs_.parallel_for(0, (int)parts_.size(), 1, [&](int first, int last)
+    {
+        PROFILE_ZONE("record part");
+        for (int i = first; i < last; i++)
+        {
+            queues_[i].clear();
+            Node::submit_part(parts_[i], queues_[i], view);
+            queues_[i].sort();
+            buffers_[i].clear();
+            queues_[i].record(buffers_[i]);
+        }
+    });
+
+    PROFILE_ZONE("merge");
+    commands.clear();
+    for (size_t i = 0; i < parts_.size(); i++)
+    {
+        commands.append(buffers_[i]);
+    }
+}
+
+RenderStats SceneRecorder::unsorted_cost() const
+{
+    RenderStats stats;
+    for (size_t i = 0; i < parts_.size(); i++)
+    {
+        RenderStats part = queues_[i].unsorted_cost();
+        stats.draws += part.draws;
+        stats.program_binds += part.program_binds;
+        stats.vao_binds += part.vao_binds;
+        stats.uniform_uploads += part.uniform_uploads;
+    }
+    return stats;
+}
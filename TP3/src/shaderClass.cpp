@@ -1,4 +1,5 @@
 #include "shaderClass.h"
+#include "cpuProfiler.h"
 #include <stdexcept> // Include for std::runtime_error
 
 string get_file_contents(const char *filename)
@@ -19,6 +20,7 @@ string get_file_contents(const char *filename)
 
 Shader::Shader(const char *vertexFile, const char *fragmentFile)
 {
+    PROFILE_ZONE("Shader::Shader");
     string vertexCode = get_file_contents(vertexFile);
     string fragmentCode = get_file_contents(fragmentFile);
 
@@ -17,4 +17,12 @@ void Shape::draw(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection)
 
     loc = glGetUniformLocation(this->shader_program_ID_, "projectionMatrix");
     glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(projection));
+}
+
+void Shape::submit_mesh(RenderQueue &queue, GLuint vao, unsigned int num_indices, const glm::mat4 &model, const glm::mat4 &view)
+{
+    // depth of the origin of the shape, enough to order these small shapes
+    float depth = -(view * model[3]).z;
+    uint64_t key = make_sort_key(PASS_OPAQUE, shader_program_ID_, 0, vao, depth);
+    queue.push(key, shader_program_ID_, vao, GL_TRIANGLE_STRIP, num_indices, model);
 }
\ No newline at end of file
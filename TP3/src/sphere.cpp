@@ -6,10 +6,12 @@
 
 #include "VAO.h"
 #include "VBO.h"
+#include "cpuProfiler.h"
 
 Sphere::Sphere(Shader *shader_program, float radius, int faces)
     : Shape(shader_program)
 {
+    PROFILE_ZONE("Sphere::Sphere");
     // generate vertices
     std::vector<glm::vec3> vertices;
     for (int i = 0; i <= faces; i++)
@@ -104,3 +106,8 @@ void Sphere::draw(glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection)
 
     glDrawElements(GL_TRIANGLE_STRIP, num_indices, GL_UNSIGNED_INT, nullptr);
 }
+
+void Sphere::submit(RenderQueue &queue, const glm::mat4 &model, const glm::mat4 &view)
+{
+    submit_mesh(queue, vao.ID, num_indices, model, view);
+}
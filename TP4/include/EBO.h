@@ -1,7 +1,7 @@
 #ifndef EBO_CLASS_H
 #define EBO_CLASS_H 
 
-#include <GL/glew.h>
+#include "glTrace.h"
 
 class EBO
 {
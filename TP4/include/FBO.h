@@ -0,0 +1,28 @@
+#ifndef FBO_CLASS_H
+#define FBO_CLASS_H
+
+#include "glTrace.h"
+
+// Offscreen target with a color texture and a depth texture of the given format,
+// for depth formats the default framebuffer can't give (GL_DEPTH_COMPONENT32F)
+class FBO
+{
+    public:
+        GLuint ID;
+        GLuint colorTexture;
+        GLuint depthTexture;
+        int width;
+        int height;
+
+        FBO(int width, int height, GLenum depthFormat);
+
+        // Returns false if the driver can't render to this combination of formats
+        bool Complete();
+        void Bind();
+        void Unbind();
+        // Copies the color to the default framebuffer, or to the one given (the golden image target)
+        void BlitToScreen(GLuint framebuffer = 0);
+        void Delete();
+};
+
+#endif
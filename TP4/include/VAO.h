@@ -1,7 +1,7 @@
 #ifndef VAO_CLASS_H
 #define VAO_CLASS_H
 
-#include<GL/glew.h>
+#include"glTrace.h"
 #include"VBO.h"
 
 class VAO
@@ -0,0 +1,20 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Loads the same image count times with Texture and then with TextureLoader, prints both wall times
+// (and the time to load a .gtex container as many times when one is given)
+void benchmarkTextureLoading(const char* image, int count, const char* container = nullptr);
+
+// Bins 1 to 10k random lights in the cluster grid, on one thread and on the pool, prints the times
+// and how many lights the clusters end up with (CPU only, needs no GL context)
+void benchmarkClusteredLights();
+
+// Times the job system from 1 worker to max(4, hardware threads): empty jobs, transform updates and culling of 1M spheres,
+// light binning and mip generation, with the speedup over 1 worker (CPU only)
+void benchmarkJobSystem();
+
+// Runs rounds of nested jobs, parallel loops, dependency chains, futures and jobs queued by several outside threads
+// on job systems of random sizes, checking every result; returns false if any is wrong
+bool stressJobSystem(int rounds);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+#include "jobSystem.h"
+
+// Block compressed formats, every block covers 4x4 pixels
+enum class BlockFormat
+{
+	BC1, // RGB, 8 bytes per block (S3TC DXT1)
+	BC3, // RGBA, 16 bytes per block (S3TC DXT5)
+	BC5, // RG, 16 bytes per block (RGTC2), for normal maps
+	BC7, // RGBA, 16 bytes per block (BPTC), encoded with mode 6 only
+};
+
+enum class CompressionPreset
+{
+	Fast,    // principal axis endpoints
+	Quality, // principal axis endpoints refined by least squares
+};
+
+// Returns the GL internal format to hand to glCompressedTexImage2D
+GLenum blockInternalFormat(BlockFormat format);
+// Returns the size of a compressed width x height image
+size_t compressedSize(int width, int height, BlockFormat format);
+
+// Compresses a tightly packed RGBA8 image, rows of blocks are split across the workers when a job system is given
+std::vector<unsigned char> compressImage(const unsigned char* rgba, int width, int height, BlockFormat format, CompressionPreset preset, JobSystem* jobs = nullptr);
+// Decodes blocks written by compressImage back to RGBA8
+void decompressImage(const unsigned char* blocks, int width, int height, BlockFormat format, unsigned char* rgba);
+// Peak signal to noise ratio in dB over the channels the format stores
+double computePSNR(const unsigned char* reference, const unsigned char* decoded, int width, int height, BlockFormat format);
+
+#endif
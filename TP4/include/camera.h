@@ -2,7 +2,7 @@
 #ifndef CAMERA_CLASS_H
 #define CAMERA_CLASS_H
 
-#include <GL/glew.h>
+#include "glTrace.h"
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -21,6 +21,10 @@ public:
     glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
     glm::mat4 cameraMatrix = glm::mat4(1.0f);
 
+    // Stores the vectors as they were before the last Inputs step, the rendering blends between both
+    glm::vec3 PreviousPosition;
+    glm::vec3 PreviousOrientation = glm::vec3(0.0f, 0.0f, -1.0f);
+
     // Prevents the camera from jumping around when first clicking left click
     bool firstClick = true;
 
@@ -28,18 +32,52 @@ public:
     int width;
     int height;
 
-    // Adjust the speed of the camera and it's sensitivity when looking around
-    float speed = 0.05f;
+    // Uses a reversed infinite projection: depth 1 on the near plane and 0 at infinity, for a float depth
+    // buffer with glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE) and GL_GREATER. The far plane is ignored
+    bool reverseZ = false;
+
+    // Adjust the speed of the camera (in units per second) and it's sensitivity when looking around
+    float speed = 6.0f;
     float sensitivity = 100.0f;
 
     // Camera constructor to set up initial values
     Camera(int width, int height, glm::vec3 position, float FOVdeg, float nearPlane, float farPlane);
 
-    // Updates the camera matrix to the Vertex Shader
-    void updateMatrix(float FOVdeg, float nearPlane, float farPlane);
+    // Updates the camera matrix to the Vertex Shader, alpha blending between the two last steps (1 is the latest).
+    // Only the matrices whose inputs changed since the last call are rebuilt
+    void updateMatrix(float FOVdeg, float nearPlane, float farPlane, float alpha = 1.0f);
+    // Matrices as of the last updateMatrix
+    const glm::mat4& viewMatrix() const { return view; }
+    const glm::mat4& projectionMatrix() const { return projection; }
+    // Inverse of cameraMatrix, computed the first time it is asked for after a change
+    const glm::mat4& inverseMatrix();
+    // Left, right, bottom, top, near and far planes of the view (xyz normal pointing inside, w distance)
+    const glm::vec4* frustumPlanes() const { return planes; }
+    // Whether a sphere is at least partly inside the view as of the last updateMatrix
+    bool SphereVisible(glm::vec3 center, float radius) const;
     // Exports the camera matrix to a shader
     void Matrix(Shader &shader, const char *uniform);
-    // Handles camera inputs
-    void Inputs(GLFWwindow *window);
+    // Handles camera inputs for one simulation step of dt seconds
+    void Inputs(GLFWwindow *window, float dt);
+
+private:
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 inverse = glm::mat4(1.0f);
+    glm::vec4 planes[6];
+
+    // Stores what the cached matrices were built from
+    glm::vec3 viewPosition;
+    glm::vec3 viewOrientation;
+    glm::vec3 viewUp;
+    float projectionFOV = 0.0f;
+    float projectionNear = 0.0f;
+    float projectionFar = 0.0f;
+    int projectionWidth = 0;
+    int projectionHeight = 0;
+    bool projectionReverseZ = false;
+    bool viewValid = false;
+    bool projectionValid = false;
+    bool inverseValid = false;
 };
 #endif
@@ -0,0 +1,80 @@
+#ifndef CLUSTERS_CLASS_H
+#define CLUSTERS_CLASS_H
+
+#include "glTrace.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "lights.h"
+#include "shaderClass.h"
+#include "jobSystem.h"
+
+// Cells of the view frustum: tiles of the screen, and slices of depth growing exponentially with the distance
+const int CLUSTERS_X = 16;
+const int CLUSTERS_Y = 9;
+const int CLUSTERS_Z = 24;
+const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+// Lights the clustered path handles, stored in a buffer texture rather than a uniform block
+const int MAX_CLUSTERED_LIGHTS = 16384;
+
+// Assigns the lights to the clusters they touch, on the CPU
+class ClusterGrid
+{
+public:
+	// Slices go from nearPlane to farPlane (the far plane of the grid, even with an infinite projection)
+	ClusterGrid(float nearPlane, float farPlane, JobSystem* jobs = nullptr);
+
+	// Rebuilds the view space bounds of the clusters if the projection changed
+	void SetProjection(const glm::mat4& projection);
+	// Bins the lights (in world space) seen through the view matrix, one task per depth slice
+	void Bin(const std::vector<Light>& lights, const glm::mat4& view);
+
+	// Where the lights of each cluster start in Indices and how many there are
+	std::vector<uint32_t> ranges;
+	// Light indices of every cluster, one after the other
+	std::vector<uint32_t> indices;
+
+	float nearPlane;
+	float farPlane;
+
+private:
+	JobSystem* jobs;
+	glm::mat4 projection = glm::mat4(0.0f);
+
+	// Bounds of the clusters in view space, one array per coordinate to test four clusters at once
+	std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+	// Lights of each cluster while binning
+	std::vector<std::vector<uint32_t>> clusterLights;
+
+	// Lights moved to view space: center and radius
+	std::vector<glm::vec4> viewLights;
+};
+
+// Buffer textures handing the binned lights to the fragment shader
+class ClusterBuffers
+{
+public:
+	ClusterBuffers();
+
+	// Uploads the light data and the results of the binning
+	void Upload(const std::vector<Light>& lights, const ClusterGrid& grid);
+	// Binds the buffer textures from firstUnit on and sets the uniforms the CLUSTERED shader needs
+	void Bind(Shader& shader, GLuint firstUnit, const ClusterGrid& grid, int screenWidth, int screenHeight, const glm::mat4& view);
+	void Delete();
+
+private:
+	GLuint buffers[3];
+	GLuint textures[3];
+	size_t capacities[3] = { 0, 0, 0 };
+
+	// Program the locations below were looked up in, its samplers already point at samplerUnit on
+	GLuint locationsProgram = 0;
+	GLuint samplerUnit = 0;
+	GLint viewLocation = -1;
+	GLint screenSizeLocation = -1;
+	GLint clusterDepthsLocation = -1;
+
+	void Fill(int buffer, const void* data, size_t size);
+};
+#endif
@@ -0,0 +1,40 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+// Times the enclosing block on the CPU, under name (a string literal), when the profile is started
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_NAME(profileZone, __LINE__)(name)
+#define PROFILE_ZONE_NAME(prefix, line) PROFILE_ZONE_JOIN(prefix, line)
+#define PROFILE_ZONE_JOIN(prefix, line) prefix##line
+
+// Starts recording the zones of every thread, the timestamps count from here
+void startCPUProfile();
+bool cpuProfileStarted();
+// Writes the zones recorded so far in the Chrome trace event format (chrome://tracing, Perfetto).
+// The threads may still be recording, what they add meanwhile is left out
+bool writeCPUProfile(const std::string& path);
+
+// Nanoseconds since the profile started
+int64_t cpuProfileTime();
+// Adds a zone to the buffer of the calling thread
+void recordCPUZone(const char* name, int64_t start, int64_t end);
+
+class ProfileZone
+{
+public:
+	ProfileZone(const char* name) : name(name), start(cpuProfileStarted() ? cpuProfileTime() : -1) {}
+	~ProfileZone()
+	{
+		if (start >= 0)
+		{
+			recordCPUZone(name, start, cpuProfileTime());
+		}
+	}
+
+private:
+	const char* name;
+	int64_t start;
+};
+#endif
@@ -0,0 +1,93 @@
+#ifndef FRAME_CAPTURE_CLASS_H
+#define FRAME_CAPTURE_CLASS_H
+
+#include "glTrace.h"
+#include "golden.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Uncompressed PNG (stored deflate blocks): no zlib needed and nothing to wait for but the disk
+bool writePNG(const std::string& path, const RGBImage& image);
+
+// Checks pattern is safe as the format of the file names: at most one integer conversion (%d, %04d, %u, %x...)
+// for the frame number, without length modifier or *, and no other directive than %%
+bool validCapturePattern(const std::string& pattern);
+
+// Records the rendered frames to numbered image files without stalling the pipeline.
+// Each frame is read into one of a ring of pixel-pack buffers behind a fence, mapped a few frames later
+// once the fence has passed, and handed to a writer thread that encodes and writes the file.
+// A frame is dropped, never waited for, when every buffer is still in flight or the writer is too far behind
+class FrameCapture
+{
+public:
+	// pattern is a printf format taking the frame number (capture/frame%04d.png). Its extension picks the format:
+	// .png, .ppm, or .raw (RGBA rows bottom first, as read, for ffmpeg -f rawvideo -pix_fmt rgba -vf vflip)
+	FrameCapture(const std::string& pattern, int width, int height, int numPBOs = 3, int maxQueued = 8);
+
+	// Queues the read of the framebuffer bound for drawing (the window, or the offscreen target) and collects
+	// the reads that finished, to call after the last draw of the frame and before the swap
+	void Capture();
+	// Waits for the reads in flight and for the writer to empty its queue
+	void Finish();
+	// Stops the writer and deletes the buffers
+	void Delete();
+	// Prints the counters and the time Capture took on the GL thread
+	void Print() const;
+
+	long long frames = 0;
+	long long captured = 0;
+	// Frames skipped because the buffer they needed was still being filled
+	long long droppedInFlight = 0;
+	// Frames read back but thrown away because the writer queue was full
+	long long droppedQueueFull = 0;
+	std::atomic<long long> written{ 0 };
+	std::atomic<long long> failed{ 0 };
+	double captureMs = 0.0;
+
+private:
+	enum class Format { PNG, PPM, Raw };
+
+	struct Slot
+	{
+		GLuint PBO = 0;
+		GLsync fence = nullptr;
+		long long frame = 0;
+	};
+	struct Frame
+	{
+		long long number;
+		std::vector<unsigned char> pixels;
+	};
+
+	std::string pattern;
+	Format format;
+	int width;
+	int height;
+	size_t maxQueued;
+	std::vector<Slot> ring;
+	// Oldest read still in flight, and the slot the next read goes to
+	size_t oldest = 0;
+	size_t next = 0;
+	size_t inFlight = 0;
+
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::condition_variable drained;
+	std::deque<Frame> queue;
+	// Buffers of written frames, reused for the next ones
+	std::vector<std::vector<unsigned char>> spare;
+	bool writing = false;
+	bool stopping = false;
+
+	// Maps the oldest read and queues its pixels, wait blocks on the fence and on a full queue
+	bool Collect(bool wait);
+	void WriterLoop();
+	void Write(const Frame& frame);
+};
+#endif
@@ -0,0 +1,30 @@
+#ifndef G_BUFFER_CLASS_H
+#define G_BUFFER_CLASS_H
+
+#include "glTrace.h"
+
+// Surfaces of the deferred path: albedo, normal and depth of the closest fragment of every pixel.
+// A normal of length 0 marks an unlit (emissive) surface
+class GBuffer
+{
+    public:
+        GLuint ID;
+        GLuint albedoTexture;
+        GLuint normalTexture;
+        GLuint depthTexture;
+        int width;
+        int height;
+
+        GBuffer(int width, int height, GLenum depthFormat);
+
+        // Returns false if the driver can't render to this combination of formats
+        bool Complete();
+        // Binds the framebuffer with both color attachments enabled
+        void Bind();
+        void Unbind();
+        // Binds albedo, normal and depth to three units from firstUnit on, for the lighting passes
+        void BindTextures(GLuint firstUnit);
+        void Delete();
+};
+
+#endif
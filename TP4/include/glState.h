@@ -0,0 +1,69 @@
+#ifndef GL_STATE_CLASS_H
+#define GL_STATE_CLASS_H
+
+#include "glTrace.h"
+
+// Calls that went through the state cache: sent to the driver, or dropped because they changed nothing
+struct GLStateCounters
+{
+	long long issued = 0;
+	long long elided = 0;
+};
+
+// Shadow of the GL state the wrappers change: the program, the vertex array, the buffer bindings,
+// the textures of each unit and the enable bits, so binding what is already bound never reaches the driver.
+// Every bind and delete of these objects in TP4 goes through it; code calling GL directly has to Invalidate it
+class GLState
+{
+public:
+	// The state of the context (there is only one)
+	static GLState& Current();
+
+	void UseProgram(GLuint program);
+	void BindVertexArray(GLuint vertexArray);
+	void BindBuffer(GLenum target, GLuint buffer);
+	// Also changes the generic binding of the target
+	void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void ActiveTexture(GLenum unit);
+	// Binds to the active unit
+	void BindTexture(GLenum target, GLuint texture);
+	void Enable(GLenum capability);
+	void Disable(GLenum capability);
+
+	// Deleting unbinds the objects, and their names can come back for new ones, so the cache forgets them
+	void DeleteProgram(GLuint program);
+	void DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+	void DeleteBuffers(GLsizei count, const GLuint* buffers);
+	void DeleteTextures(GLsizei count, const GLuint* textures);
+
+	// Forgets everything: the next calls all reach the driver
+	void Invalidate();
+
+	// Calls of the current frame, and of all the finished frames added up
+	GLStateCounters frame;
+	GLStateCounters total;
+	long long frames = 0;
+	// Adds the frame to the total and starts the next one
+	void NextFrame();
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFFu;
+	static const int UNITS = 16;
+	static const int TEXTURE_TARGETS = 4;
+	static const int BUFFER_TARGETS = 6;
+	static const int CAPABILITIES = 4;
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint buffers[BUFFER_TARGETS];
+	GLuint activeUnit;
+	GLuint textures[UNITS][TEXTURE_TARGETS];
+	// 0 disabled, 1 enabled, -1 unknown
+	int enabled[CAPABILITIES];
+
+	GLState();
+	// Records the new value and returns true if the call has to be made
+	bool Changed(GLuint& cached, GLuint value);
+	void SetEnabled(GLenum capability, bool enable);
+};
+#endif
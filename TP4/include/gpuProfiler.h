@@ -0,0 +1,90 @@
+#ifndef GPU_PROFILER_CLASS_H
+#define GPU_PROFILER_CLASS_H
+
+#include "glTrace.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Time the GPU spent in one scope, over all the frames measured
+struct GPUScopeStats
+{
+	// Names of the enclosing scopes and its own, separated by '/'
+	std::string path;
+	int depth = 0;
+	long long calls = 0;
+	double totalMs = 0.0;
+	double minMs = 0.0;
+	double maxMs = 0.0;
+};
+
+// Named, nested GPU timers. Each scope is a pair of GL_TIMESTAMP queries (elapsed-time queries can't be nested),
+// read back frameLatency frames later so the CPU doesn't wait for the GPU to catch up.
+// Every frame is a "frame" scope holding the ones pushed during it
+class GPUProfiler
+{
+public:
+	GPUProfiler(int frameLatency = 3);
+
+	// Turns the profiler on if the driver has a timestamp counter, every call does nothing until then
+	bool Enable();
+	bool Enabled() const { return enabled; }
+
+	// Reads the results of the frame whose queries are reused and opens the "frame" scope
+	void BeginFrame();
+	void EndFrame();
+	// Names are kept as pointers, they must outlive the profiler (string literals)
+	void Push(const char* name);
+	void Pop();
+
+	// Waits for the frames still in flight
+	void Finish();
+	// Writes the statistics of every scope, as JSON if path ends with .json, CSV otherwise
+	bool Write(const std::string& path) const;
+	// Prints the GPU time per frame of every scope
+	void Print() const;
+	void Delete();
+
+	// Scopes in the order they first appeared, parents before their children
+	std::vector<GPUScopeStats> scopes;
+	long long frames = 0;
+	// Frames whose results weren't ready when their queries were needed again
+	long long stalls = 0;
+
+private:
+	struct Scope
+	{
+		const char* name;
+		int parent;
+		GLuint start;
+		GLuint end;
+	};
+	struct Frame
+	{
+		std::vector<Scope> scopes;
+		std::vector<GLuint> queries;
+		size_t usedQueries = 0;
+	};
+
+	bool enabled = false;
+	std::vector<Frame> ring;
+	int current = 0;
+	// Open scopes of the current frame, innermost last
+	std::vector<int> stack;
+	std::unordered_map<std::string, size_t> scopeIndex;
+
+	GLuint NextQuery(Frame& frame);
+	void Collect(Frame& frame);
+};
+
+// Pushes a scope for the lifetime of the object
+class GPUScope
+{
+public:
+	GPUScope(GPUProfiler& profiler, const char* name) : profiler(profiler) { profiler.Push(name); }
+	~GPUScope() { profiler.Pop(); }
+
+private:
+	GPUProfiler& profiler;
+};
+#endif
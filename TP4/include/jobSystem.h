@@ -0,0 +1,105 @@
+#ifndef JOB_SYSTEM_CLASS_H
+#define JOB_SYSTEM_CLASS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Jobs of a group still to finish. Waiting on it runs other jobs meanwhile, so jobs can wait on the jobs they start.
+// It can be used again once it reaches zero
+class JobCounter
+{
+public:
+	// Also waits for the thread that finished the last job to let go of the counter, so it can be destroyed
+	bool Done() const { return pending.load() == 0 && finishing.load() == 0; }
+
+private:
+	friend class JobSystem;
+	std::atomic<int> pending{ 0 };
+	std::atomic<int> finishing{ 0 };
+	// Jobs queued with RunAfter, started when pending drops to zero
+	std::mutex mutex;
+	std::vector<std::pair<std::function<void()>, JobCounter*>> dependents;
+};
+
+// Workers with a deque of jobs each. A worker takes the jobs it queued itself from the back, the most recent
+// and still in cache, and when it has none steals the oldest job of another worker. Jobs queued from outside
+// the workers (the GL thread) go to a queue of their own that every worker takes from
+class JobSystem
+{
+public:
+	// 0 workers means one per hardware thread, minus the GL thread
+	JobSystem(unsigned int numWorkers = 0);
+	// Runs the queued jobs and joins the workers
+	~JobSystem();
+
+	// Queues job, adding it to counter (when given) until it returns
+	void Run(std::function<void()> job, JobCounter* counter = nullptr);
+	// Queues job once dependency reaches zero, right away if it already has. Every job of dependency must have been
+	// queued before, or job may start when only the first ones are done
+	void RunAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter = nullptr);
+	// Runs jobs on the calling thread until counter reaches zero
+	void Wait(JobCounter& counter);
+
+	// Calls body over [first, last) ranges of at most grain indices covering [begin, end), on the workers and the
+	// calling thread, and returns when all are done. Short ranges run inline
+	void ParallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body);
+
+	// Queues a task and returns a future holding its result, for work polled rather than waited on.
+	// Waiting on the future blocks the thread without running jobs, unlike Wait
+	template <typename F>
+	auto Submit(F task) -> std::future<decltype(task())>
+	{
+		using Result = decltype(task());
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+		std::future<Result> result = packaged->get_future();
+		Run([packaged]() { (*packaged)(); });
+		return result;
+	}
+
+	// Returns the number of worker threads
+	unsigned int Size() const { return (unsigned int)workers.size(); }
+
+	// Jobs run, and how many of them were taken from another worker's deque
+	std::atomic<long long> executed{ 0 };
+	std::atomic<long long> steals{ 0 };
+
+private:
+	struct Job
+	{
+		std::function<void()> work;
+		JobCounter* counter;
+	};
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	std::vector<std::thread> workers;
+	// One per worker, then the one of the outside threads
+	std::vector<std::unique_ptr<Queue>> queues;
+	// Jobs in all the queues, the workers sleep when there are none
+	std::atomic<int> queued{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	std::atomic<bool> stopping{ false };
+
+	void Push(Job job);
+	// Takes a job for the thread of worker (-1 outside the workers), false if every queue is empty
+	bool Take(int worker, Job& job);
+	bool RunOne(int worker);
+	void Finish(JobCounter* counter);
+	// Position of the calling thread among the workers of this system, -1 if it isn't one
+	int CurrentWorker() const;
+	void WorkerLoop(int worker);
+};
+#endif
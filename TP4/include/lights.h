@@ -0,0 +1,53 @@
+#ifndef LIGHTS_CLASS_H
+#define LIGHTS_CLASS_H
+
+#include "glTrace.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "shaderClass.h"
+
+// Size of the light array in the shaders and of the light list each object gets
+const int MAX_LIGHTS = 256;
+const int MAX_OBJECT_LIGHTS = 32;
+
+// Point light, or spot light when cosCutoff is above -1. Same layout as the std140 struct
+// of the shaders (three vec4), so an array of them is uploaded as is
+struct Light
+{
+	glm::vec3 position;
+	// Distance at which the light fades out completely
+	float radius;
+	glm::vec3 color;
+	float intensity;
+	// Spot lights only
+	glm::vec3 direction;
+	float cosCutoff;
+};
+
+// Uniform buffer holding the lights of the scene for the "Lights" block of the shaders
+class LightBuffer
+{
+public:
+	GLuint ID;
+	GLuint bindingPoint;
+
+	LightBuffer(GLuint bindingPoint = 0);
+
+	// Uploads the first MAX_LIGHTS lights
+	void Upload(const std::vector<Light>& lights);
+	// Connects the "Lights" block of a shader to the buffer
+	void Link(Shader& shader);
+	void Delete();
+};
+
+// Whether the light can reach a point of the sphere
+bool lightTouchesSphere(const Light& light, glm::vec3 center, float radius);
+
+// Fills indices with the lights (taken among candidates) that touch the sphere, the closest ones relative
+// to their radius first when there are more than maxLights. Returns how many were written
+int cullLights(const std::vector<Light>& lights, const std::vector<int>& candidates, glm::vec3 center, float radius, int* indices, int maxLights);
+
+// Random colored lights in the box, a quarter of them spot lights pointing down
+std::vector<Light> randomLights(int count, glm::vec3 boxMin, glm::vec3 boxMax, float minRadius, float maxRadius, unsigned int seed = 1);
+#endif
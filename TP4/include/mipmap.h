@@ -0,0 +1,24 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <vector>
+
+#include "textureContainer.h"
+#include "jobSystem.h"
+
+enum class MipFilter
+{
+	Box,    // 2x2 average
+	Kaiser, // 6 taps Kaiser windowed sinc, sharper but can ring on hard edges
+};
+
+// Builds the whole mip chain of a tightly packed 8-bit image down to 1x1, levels[0] being a copy of the source.
+// When srgb is set the RGB channels of 3 and 4 channel images are averaged in linear space (alpha and 1 or 2 channel data always are linear).
+// Rows are split across the job system when one is given, which is safe from inside a job.
+// maxLevels stops the chain early (the source counting as one), 0 going down to 1x1.
+std::vector<TextureContainerImage> generateMipChain(const unsigned char* pixels, int width, int height, int channels, MipFilter filter, bool srgb, JobSystem* jobs = nullptr, int maxLevels = 0);
+
+// Name of the instruction set the filters run with on this CPU
+const char* mipmapInstructionSet();
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Object of the scene drawn with the sphere mesh, translated to its position
+struct SceneObject
+{
+	glm::vec3 position;
+	float radius;
+};
+
+// perSide x perSide spheres on the XZ plane, centered on x and going away from the camera,
+// a single one is at the origin
+std::vector<SceneObject> sphereGrid(int perSide, float spacing, float radius);
+
+#endif
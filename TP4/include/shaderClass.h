@@ -1,7 +1,7 @@
 #ifndef SHADER_CLASS_H
 #define SHADER_CLASS_H
 
-#include <GL/glew.h>
+#include "glTrace.h"
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -16,7 +16,8 @@ class Shader
 {
     public:
         GLuint ID;
-        Shader(const char* vertexFile, const char* fragmentFile);
+        // defines is inserted after the #version line of both stages, to build variants of one source
+        Shader(const char* vertexFile, const char* fragmentFile, const char* defines = "");
         
         void Activate();
         void Delete();
@@ -0,0 +1,77 @@
+#ifndef SHADOWS_CLASS_H
+#define SHADOWS_CLASS_H
+
+#include "glTrace.h"
+#include <glm/glm.hpp>
+#include <functional>
+#include <vector>
+
+#include "shaderClass.h"
+
+// Draws the shadow casters, setting each model matrix at the given location of the shadow shader
+typedef std::function<void(GLint modelLocation)> DrawCasters;
+
+// Filtering of the shadow lookups: a single tap, the 2x2 comparison of the hardware, or a kernel of taps on top of it
+enum class ShadowPCF
+{
+	None = 0,
+	Hardware = 1,
+	Kernel = 2
+};
+
+// Distance from a point light to the closest caster in every direction, over the far plane of the light
+class CubeShadowMap
+{
+public:
+	GLuint texture;
+	int size;
+	// Number of times the six faces were rendered
+	int renders = 0;
+
+	CubeShadowMap(int size);
+
+	// Renders the faces with the shadow shader (CUBE variant) unless the light and the casters are the same as the last time.
+	// Returns true if it rendered
+	bool Update(Shader& shader, glm::vec3 lightPosition, float farPlane, unsigned int casterVersion, const DrawCasters& draw);
+	void SetFiltering(ShadowPCF pcf);
+	void Bind(GLuint unit);
+	void Delete();
+
+private:
+	GLuint framebuffer;
+	bool valid = false;
+	glm::vec3 cachedPosition;
+	float cachedFar = 0.0f;
+	unsigned int cachedVersion = 0;
+};
+
+// Shadow maps of a directional light for slices of the view of increasing length, in the layers of a texture array
+class CascadedShadowMap
+{
+public:
+	GLuint texture;
+	int size;
+	int cascades;
+	// World to shadow map matrices (xyz in [-1, 1]) and the view distances where the cascades end
+	std::vector<glm::mat4> matrices;
+	std::vector<float> splits;
+	// Number of cascades rendered so far
+	int renders = 0;
+
+	CascadedShadowMap(int size, int cascades = 4);
+
+	// Fits the cascades to the view between nearPlane and shadowDistance, then renders the ones whose matrix changed
+	// (or all of them when the casters changed). The cascades are snapped to whole texels so they only change
+	// when the camera moves by a texel. Returns the number of cascades rendered
+	int Update(Shader& shader, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float shadowDistance,
+		glm::vec3 lightDirection, unsigned int casterVersion, const DrawCasters& draw);
+	void SetFiltering(ShadowPCF pcf);
+	void Bind(GLuint unit);
+	void Delete();
+
+private:
+	GLuint framebuffer;
+	std::vector<bool> valid;
+	unsigned int cachedVersion = 0;
+};
+#endif
@@ -1,10 +1,11 @@
 #ifndef TEXTURE_CLASS_H
 #define TEXTURE_CLASS_H
 
-#include <GL/glew.h>
+#include "glTrace.h"
 #include "stb_image.h"
 
 #include"shaderClass.h"
+#include "textureContainer.h"
 
 class Texture
 {
@@ -12,6 +13,10 @@ public:
 	GLuint ID;
 	GLenum type;
 	Texture(const char* image, GLenum texType, GLenum slot, GLenum format, GLenum pixelType);
+	// Creates a texture holding a small placeholder pattern until real pixels are uploaded
+	Texture(GLenum texType, GLenum slot);
+	// Maps a .gtex container written by texconv and uploads its mip levels as they are
+	Texture(const char* container, GLenum texType, GLenum slot);
 
 	// Assigns a texture unit to a texture
 	void texUnit(Shader& shader, const char* uniform, GLuint unit);
@@ -22,4 +27,14 @@ public:
 	// Deletes a texture
 	void Delete();
 };
-#endif
\ No newline at end of file
+
+// Uploads the levels of a .gtex container to the bound texture, the file's firstLevel becoming level 0.
+// Returns the bytes uploaded, 0 if the container couldn't be read
+size_t uploadTextureContainer(const char* container, GLenum texType, uint32_t firstLevel = 0);
+// Uploads a mip chain to the bound texture the same way, returns the bytes uploaded
+size_t uploadMipChain(GLenum texType, const std::vector<TextureContainerImage>& levels, GLenum format, uint32_t firstLevel = 0);
+// Returns the sized internal format storing exactly the channels of a pixel format
+GLenum internalFormatFor(GLenum format);
+// Returns the number of channels stb_image should decode for a pixel format
+int channelsForFormat(GLenum format);
+#endif
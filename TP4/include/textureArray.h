@@ -0,0 +1,48 @@
+#ifndef TEXTURE_ARRAY_CLASS_H
+#define TEXTURE_ARRAY_CLASS_H
+
+#include "glTrace.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "shaderClass.h"
+#include "jobSystem.h"
+
+// Where a packed image ended up: the array layer, and the UV rectangle it covers in that layer
+struct TextureRegion
+{
+	int layer;
+	glm::vec2 offset;
+	glm::vec2 scale;
+};
+
+class TextureArray
+{
+public:
+	GLuint ID;
+	GLenum type = GL_TEXTURE_2D_ARRAY;
+	// Side of every layer in pixels
+	int size;
+	int layers;
+	// One region per source image, in the order they were given
+	std::vector<TextureRegion> regions;
+
+	// Packs the images as rectangles in square layers of at least layerSize pixels, so every object using one of
+	// them can be drawn with the same texture bound. The mips are filtered on the job system when one is given
+	TextureArray(const std::vector<const char*>& images, int layerSize, GLenum slot, JobSystem* jobs = nullptr);
+
+	// Assigns a texture unit to the texture array
+	void texUnit(Shader& shader, const char* uniform, GLuint unit);
+	// Binds the texture array
+	void Bind();
+	// Unbinds the texture array
+	void Unbind();
+	// Deletes the texture array
+	void Delete();
+};
+
+// Rewrites the texture coordinates of interleaved vertices so they sample region instead of a whole texture,
+// must be applied once on the original coordinates (which have to stay in [0, 1], atlases can't repeat)
+void remapUVs(GLfloat* vertices, size_t vertexCount, int stride, int uvOffset, const TextureRegion& region);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef TEXTURE_CACHE_CLASS_H
+#define TEXTURE_CACHE_CLASS_H
+
+#include "glTrace.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "textureContainer.h"
+
+struct TextureCacheStats
+{
+	size_t budgetBytes;
+	// Bytes of the levels currently uploaded, and what they would take with every level resident
+	size_t residentBytes;
+	size_t fullBytes;
+	size_t peakBytes;
+	unsigned int textures;
+	unsigned int residentTextures;
+	// Textures running without their top levels
+	unsigned int reducedTextures;
+	unsigned int evictions;
+	unsigned int mipDrops;
+	unsigned int reloads;
+};
+
+class TextureCache
+{
+public:
+	// Keeps the textures under budgetBytes of video memory
+	TextureCache(size_t budgetBytes);
+
+	// Registers a .gtex container or an image, nothing is uploaded before its first Bind
+	int Add(const char* path, GLenum texType, GLenum format);
+	// Binds a texture as it is, reloading it at the resolution it had if it was evicted
+	void Bind(int handle);
+	// Starts a new frame, textures bound during the current frame are never evicted. Gives its top level back to
+	// the most recently bound reduced texture when the budget has room for it
+	void NextFrame();
+	// Changes the budget and evicts right away if needed
+	void SetBudget(size_t budgetBytes);
+
+	TextureCacheStats Stats() const;
+	// Deletes every texture
+	void Delete();
+
+private:
+	struct Entry
+	{
+		std::string path;
+		GLenum type;
+		GLenum format;
+		GLuint ID = 0;
+		// First level of the source uploaded, greater than 0 once top mips were dropped
+		uint32_t firstLevel = 0;
+		uint32_t levelCount = 0;
+		size_t bytes = 0;
+		size_t fullBytes = 0;
+		uint64_t lastUse = 0;
+		// Mip chain of an image source, decoded once and kept so dropping or restoring levels only uploads again
+		std::vector<TextureContainerImage> mips;
+	};
+
+	std::vector<Entry> entries;
+	size_t budget;
+	size_t resident = 0;
+	size_t peak = 0;
+	uint64_t frame = 1;
+	unsigned int evictions = 0;
+	unsigned int mipDrops = 0;
+	unsigned int reloads = 0;
+
+	// Uploads the source from firstLevel down, replacing the previous texture object
+	void Load(Entry& entry, uint32_t firstLevel);
+	// Moves every level but the top one to a new texture object on the GPU, false if the driver can't copy images
+	bool DropTopLevel(Entry& entry);
+	// Bytes entry would take with one more level on top
+	size_t RestoredBytes(const Entry& entry) const;
+	// Frees the least recently bound textures until the budget is met
+	void Enforce();
+};
+#endif
@@ -0,0 +1,69 @@
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Precompiled texture file (.gtex) written by texconv: a header, a level table,
+// then every mip level already in the layout glTexImage2D expects (rows bottom-up,
+// tightly packed, each level aligned on 16 bytes)
+const char TEXTURE_CONTAINER_MAGIC[4] = { 'G', 'T', 'E', 'X' };
+const uint32_t TEXTURE_CONTAINER_VERSION = 1;
+
+struct TextureContainerHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	// Internal format, format and type handed to glTexImage2D,
+	// format is 0 when the levels are compressed blocks for glCompressedTexImage2D
+	uint32_t internalFormat;
+	uint32_t format;
+	uint32_t pixelType;
+	uint32_t channels;
+	uint32_t reserved;
+};
+
+struct TextureContainerLevel
+{
+	uint64_t offset;
+	uint64_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct TextureContainerImage
+{
+	std::vector<unsigned char> pixels;
+	uint32_t width;
+	uint32_t height;
+};
+
+// Writes a container, levels[0] being the full resolution image
+bool writeTextureContainer(const char* path, TextureContainerHeader header, const std::vector<TextureContainerImage>& levels);
+// Checks a mapped container and points header and levels into it, returns false if it is malformed
+bool parseTextureContainer(const unsigned char* data, size_t size, const TextureContainerHeader*& header, const TextureContainerLevel*& levels);
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+
+	// Maps the file, returns false if it can't be opened
+	bool Open(const char* path);
+	// Unmaps the file
+	void Close();
+
+private:
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+#endif
@@ -0,0 +1,56 @@
+#ifndef TEXTURE_LOADER_CLASS_H
+#define TEXTURE_LOADER_CLASS_H
+
+#include "glTrace.h"
+#include <string>
+#include <vector>
+#include <future>
+
+#include "texture.h"
+#include "jobSystem.h"
+#include "textureContainer.h"
+
+class TextureLoader
+{
+public:
+	// Decodes on the workers of jobs, which must outlive the loader, and creates the ring of pixel-buffer objects used for uploads
+	TextureLoader(JobSystem& jobs, unsigned int numPBOs = 4);
+
+	// Returns a texture bound to a placeholder right away, decodes the image and builds its mips on a worker
+	Texture Load(const char* image, GLenum texType, GLenum slot, GLenum format, GLenum pixelType);
+	// Uploads the images decoded so far, must be called on the GL thread (once per frame)
+	unsigned int Update(unsigned int maxUploads = 0);
+	// Blocks until every queued texture is resident
+	void Finish();
+
+	// Number of textures still decoding or waiting for their upload
+	size_t Pending() const { return requests.size(); }
+	// Deletes the pixel-buffer objects
+	void Delete();
+
+private:
+	// Whole mip chain built on the worker, empty if the image couldn't be decoded
+	struct DecodedImage
+	{
+		std::vector<TextureContainerImage> levels;
+		std::string error;
+	};
+
+	struct Request
+	{
+		GLuint ID;
+		GLenum type;
+		GLenum format;
+		GLenum pixelType;
+		std::string path;
+		std::future<DecodedImage> image;
+	};
+
+	JobSystem& jobs;
+	std::vector<Request> requests;
+	std::vector<GLuint> PBOs;
+	unsigned int nextPBO = 0;
+
+	void Upload(Request& request, DecodedImage& image);
+};
+#endif
@@ -1,23 +1,24 @@
 #include "EBO.h"
+#include "glState.h"
 
 EBO::EBO(GLuint* indices, GLsizeiptr size)
 {
     glGenBuffers(1,&ID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,ID);
+    GLState::Current().BindBuffer(GL_ELEMENT_ARRAY_BUFFER,ID);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER,size,indices,GL_STATIC_DRAW);
 }
 
 void EBO::Bind()
 {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,ID);
+    GLState::Current().BindBuffer(GL_ELEMENT_ARRAY_BUFFER,ID);
 }
 
 void EBO::Unbind()
 {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
+    GLState::Current().BindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
 }
 
 void EBO::Delete()
 {
-    glDeleteBuffers(1,&ID);
+    GLState::Current().DeleteBuffers(1,&ID);
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "FBO.h"
+#include "glState.h"
+
+FBO::FBO(int width, int height, GLenum depthFormat)
+{
+    FBO::width = width;
+    FBO::height = height;
+
+    glGenTextures(1,&colorTexture);
+    GLState::Current().BindTexture(GL_TEXTURE_2D,colorTexture);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA8,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,NULL);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+
+    glGenTextures(1,&depthTexture);
+    GLState::Current().BindTexture(GL_TEXTURE_2D,depthTexture);
+    glTexImage2D(GL_TEXTURE_2D,0,depthFormat,width,height,0,GL_DEPTH_COMPONENT,GL_FLOAT,NULL);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+    GLState::Current().BindTexture(GL_TEXTURE_2D,0);
+
+    glGenFramebuffers(1,&ID);
+    glBindFramebuffer(GL_FRAMEBUFFER,ID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,colorTexture,0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_DEPTH_ATTACHMENT,GL_TEXTURE_2D,depthTexture,0);
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+}
+
+bool FBO::Complete()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER,ID);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+    return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void FBO::Bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER,ID);
+}
+
+void FBO::Unbind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+}
+
+void FBO::BlitToScreen(GLuint framebuffer)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER,ID);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER,framebuffer);
+    glBlitFramebuffer(0,0,width,height,0,0,width,height,GL_COLOR_BUFFER_BIT,GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+}
+
+void FBO::Delete()
+{
+    glDeleteFramebuffers(1,&ID);
+    GLState::Current().DeleteTextures(1,&colorTexture);
+    GLState::Current().DeleteTextures(1,&depthTexture);
+}
@@ -1,4 +1,5 @@
 #include "VAO.h"
+#include "glState.h"
 
 VAO::VAO()
 {
@@ -15,15 +16,15 @@ void VAO::LinkAttrib(VBO VBO, GLuint layout, GLuint numComp, GLenum type, GLsize
 
 void VAO::Bind()
 {
-    glBindVertexArray(ID);
+    GLState::Current().BindVertexArray(ID);
 }
 
 void VAO::Unbind()
 {
-    glBindVertexArray(0);
+    GLState::Current().BindVertexArray(0);
 }
 
 void VAO::Delete()
 {
-    glDeleteVertexArrays(1,&ID);
+    GLState::Current().DeleteVertexArrays(1,&ID);
 }
\ No newline at end of file
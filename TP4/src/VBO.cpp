@@ -1,23 +1,24 @@
 #include "VBO.h"
+#include "glState.h"
 
 VBO::VBO(GLfloat* verticies, GLsizeiptr size)
 {
     glGenBuffers(1,&ID);
-    glBindBuffer(GL_ARRAY_BUFFER,ID);
+    GLState::Current().BindBuffer(GL_ARRAY_BUFFER,ID);
     glBufferData(GL_ARRAY_BUFFER,size,verticies,GL_STATIC_DRAW);
 }
 
 void VBO::Bind()
 {
-    glBindBuffer(GL_ARRAY_BUFFER,ID);
+    GLState::Current().BindBuffer(GL_ARRAY_BUFFER,ID);
 }
 
 void VBO::Unbind()
 {
-    glBindBuffer(GL_ARRAY_BUFFER,0);
+    GLState::Current().BindBuffer(GL_ARRAY_BUFFER,0);
 }
 
 void VBO::Delete()
 {
-    glDeleteBuffers(1,&ID);
+    GLState::Current().DeleteBuffers(1,&ID);
 }
\ No newline at end of file
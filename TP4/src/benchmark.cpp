@@ -0,0 +1,394 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "texture.h"
+#include "textureLoader.h"
+#include "clusters.h"
+#include "camera.h"
+#include "jobSystem.h"
+#include "mipmap.h"
+
+// Returns the milliseconds elapsed since start
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmarkTextureLoading(const char* image, int count, const char* container)
+{
+	std::vector<Texture> textures;
+	textures.reserve(count);
+
+	// Synchronous path: decode and upload on the GL thread one after the other
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++)
+	{
+		textures.emplace_back(image, GL_TEXTURE_2D, GL_TEXTURE0, GL_RGB, GL_UNSIGNED_BYTE);
+	}
+	glFinish();
+	double syncMs = elapsedMs(start);
+
+	for (Texture& texture : textures)
+	{
+		texture.Delete();
+	}
+	textures.clear();
+
+	// Asynchronous path: decode on the workers, upload through the PBO ring
+	start = std::chrono::steady_clock::now();
+	JobSystem jobs;
+	TextureLoader loader(jobs);
+	for (int i = 0; i < count; i++)
+	{
+		textures.push_back(loader.Load(image, GL_TEXTURE_2D, GL_TEXTURE0, GL_RGB, GL_UNSIGNED_BYTE));
+	}
+	loader.Finish();
+	glFinish();
+	double asyncMs = elapsedMs(start);
+
+	for (Texture& texture : textures)
+	{
+		texture.Delete();
+	}
+	loader.Delete();
+
+	std::cout << "textures loaded: " << count << std::endl;
+	std::cout << "sync:  " << syncMs << " ms" << std::endl;
+	std::cout << "async: " << asyncMs << " ms (" << std::thread::hardware_concurrency() << " hardware threads)" << std::endl;
+	std::cout << "speedup: " << syncMs / asyncMs << "x" << std::endl;
+
+	if (container == nullptr)
+	{
+		return;
+	}
+
+	// Precompiled path: mapped mip levels uploaded as they are
+	textures.clear();
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++)
+	{
+		textures.emplace_back(container, GL_TEXTURE_2D, GL_TEXTURE0);
+	}
+	glFinish();
+	double containerMs = elapsedMs(start);
+
+	for (Texture& texture : textures)
+	{
+		texture.Delete();
+	}
+
+	std::cout << "container: " << containerMs << " ms" << std::endl;
+}
+
+void benchmarkClusteredLights()
+{
+	// The camera of the TP looking down -z, lights spread over the 100 units the grid covers
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f, 0.0f, 4.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+
+	JobSystem jobs;
+	ClusterGrid serial(0.1f, 100.0f);
+	ClusterGrid parallel(0.1f, 100.0f, &jobs);
+	serial.SetProjection(projection);
+	parallel.SetProjection(projection);
+
+	std::cout << "binning in " << CLUSTERS_X << "x" << CLUSTERS_Y << "x" << CLUSTERS_Z << " clusters, " << jobs.Size() << " workers" << std::endl;
+	for (int count = 1; count <= 10000; count *= 10)
+	{
+		std::vector<Light> lights = randomLights(count, glm::vec3(-20.0f, -10.0f, -90.0f), glm::vec3(20.0f, 10.0f, 4.0f), 1.0f, 4.0f);
+
+		// Best of a few runs
+		double serialMs = 1e30;
+		double parallelMs = 1e30;
+		for (int run = 0; run < 5; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			serial.Bin(lights, view);
+			serialMs = std::min(serialMs, elapsedMs(start));
+
+			start = std::chrono::steady_clock::now();
+			parallel.Bin(lights, view);
+			parallelMs = std::min(parallelMs, elapsedMs(start));
+		}
+
+		uint32_t most = 0;
+		int used = 0;
+		for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+		{
+			most = std::max(most, parallel.ranges[2 * cluster + 1]);
+			used += parallel.ranges[2 * cluster + 1] > 0;
+		}
+		std::cout << count << " lights: " << serialMs << " ms on 1 thread, " << parallelMs << " ms on the workers, "
+			<< parallel.indices.size() << " indices, " << used << " clusters lit, at most " << most << " lights in a cluster" << std::endl;
+	}
+}
+
+// Best time of runs calls of work, in ms
+static double bestOfRuns(int runs, const std::function<void()>& work)
+{
+	double best = 1e30;
+	for (int run = 0; run < runs; run++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		work();
+		best = std::min(best, elapsedMs(start));
+	}
+	return best;
+}
+
+void benchmarkJobSystem()
+{
+	const int emptyJobs = 100000;
+	const int sphereCount = 1 << 20;
+	const int grain = 4096;
+
+	// The same inputs for every worker count
+	Camera camera(800, 800, glm::vec3(0.0f, 0.0f, 5.0f), 45.0f, 0.1f, 100.0f);
+	camera.updateMatrix(45.0f, 0.1f, 100.0f);
+	std::vector<glm::vec3> positions(sphereCount);
+	for (int i = 0; i < sphereCount; i++)
+	{
+		// A grid of 1024 x 1024 spheres in front of the camera, most of them out of the view
+		positions[i] = glm::vec3((i % 1024) * 0.5f - 256.0f, 0.0f, -(i / 1024) * 0.5f);
+	}
+	std::vector<glm::mat4> models(sphereCount);
+	std::vector<unsigned char> visible(sphereCount);
+	std::vector<Light> lights = randomLights(10000, glm::vec3(-20.0f, -10.0f, -90.0f), glm::vec3(20.0f, 10.0f, 4.0f), 1.0f, 4.0f);
+	const int imageSize = 1024;
+	std::vector<unsigned char> image((size_t)imageSize * imageSize * 4);
+	for (size_t i = 0; i < image.size(); i++)
+	{
+		image[i] = (unsigned char)(i * 2654435761u >> 24);
+	}
+
+	unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+	unsigned int maxWorkers = std::max(4u, hardware);
+	std::cout << "job system, " << hardware << " hardware threads, best of 5 runs in ms (speedup over 1 worker);"
+		<< " the waiting thread runs jobs too" << std::endl;
+	std::cout << "workers | " << emptyJobs / 1000 << "k empty jobs | 1M transforms | 1M spheres culled | 10k lights binned | "
+		<< imageSize << "x" << imageSize << " mips | steals" << std::endl;
+
+	double baseline[5] = {};
+	for (unsigned int workers = 1; workers <= maxWorkers; workers++)
+	{
+		JobSystem jobs(workers);
+		ClusterGrid grid(0.1f, 100.0f, &jobs);
+		grid.SetProjection(camera.projectionMatrix());
+
+		double ms[5];
+		ms[0] = bestOfRuns(5, [&]()
+		{
+			JobCounter counter;
+			for (int i = 0; i < emptyJobs; i++)
+			{
+				jobs.Run([]() {}, &counter);
+			}
+			jobs.Wait(counter);
+		});
+		ms[1] = bestOfRuns(5, [&]()
+		{
+			jobs.ParallelFor(0, sphereCount, grain, [&](int first, int last)
+			{
+				for (int i = first; i < last; i++)
+				{
+					models[i] = glm::rotate(glm::translate(glm::mat4(1.0f), positions[i]), i * 0.001f, glm::vec3(0.0f, 1.0f, 0.0f));
+				}
+			});
+		});
+		ms[2] = bestOfRuns(5, [&]()
+		{
+			jobs.ParallelFor(0, sphereCount, grain, [&](int first, int last)
+			{
+				for (int i = first; i < last; i++)
+				{
+					visible[i] = camera.SphereVisible(positions[i], 0.25f);
+				}
+			});
+		});
+		ms[3] = bestOfRuns(5, [&]() { grid.Bin(lights, camera.viewMatrix()); });
+		ms[4] = bestOfRuns(5, [&]() { generateMipChain(image.data(), imageSize, imageSize, 4, MipFilter::Box, true, &jobs); });
+
+		std::cout << workers;
+		for (int i = 0; i < 5; i++)
+		{
+			if (workers == 1)
+			{
+				baseline[i] = ms[i];
+			}
+			std::cout << " | " << ms[i] << " (" << baseline[i] / ms[i] << "x)";
+		}
+		std::cout << " | " << jobs.steals << std::endl;
+	}
+}
+
+// Jobs a node of the stress tree starts, from its seed, and the seed of each child
+static int stressChildren(uint32_t seed, int depth)
+{
+	return depth >= 6 ? 0 : (int)(seed % 4);
+}
+static uint32_t stressChildSeed(uint32_t seed, int child)
+{
+	return (seed ^ (uint32_t)(child + 1) * 0x9E3779B9u) * 2654435761u + 12345u;
+}
+
+// Nodes of the tree, counted without the job system
+static long long stressTreeSize(uint32_t seed, int depth)
+{
+	long long size = 1;
+	for (int child = 0; child < stressChildren(seed, depth); child++)
+	{
+		size += stressTreeSize(stressChildSeed(seed, child), depth + 1);
+	}
+	return size;
+}
+
+bool stressJobSystem(int rounds)
+{
+	std::mt19937 random(1234);
+	long long failures = 0;
+	auto check = [&failures](bool passed, const char* what, int round)
+	{
+		if (!passed)
+		{
+			failures++;
+			std::cout << "round " << round << ": " << what << " failed" << std::endl;
+		}
+	};
+
+	for (int round = 0; round < rounds; round++)
+	{
+		JobSystem jobs(1 + random() % 8);
+
+		// A tree of jobs, each waiting on the children it starts
+		std::atomic<long long> visited{ 0 };
+		std::function<void(uint32_t, int)> visit = [&](uint32_t seed, int depth)
+		{
+			visited++;
+			JobCounter children;
+			for (int child = 0; child < stressChildren(seed, depth); child++)
+			{
+				uint32_t childSeed = stressChildSeed(seed, child);
+				jobs.Run([&visit, childSeed, depth]() { visit(childSeed, depth + 1); }, &children);
+			}
+			jobs.Wait(children);
+		};
+		uint32_t rootSeed = random() | 3;
+		visit(rootSeed, 0);
+		check(visited == stressTreeSize(rootSeed, 0), "nested jobs", round);
+
+		// Every index of a random range exactly once, with a random grain
+		int count = 1 + random() % 20000;
+		int begin = random() % 100;
+		int grain = 1 + random() % 500;
+		std::vector<std::atomic<int>> hits(begin + count);
+		jobs.ParallelFor(begin, begin + count, grain, [&hits](int first, int last)
+		{
+			for (int i = first; i < last; i++)
+			{
+				hits[i]++;
+			}
+		});
+		bool covered = true;
+		for (int i = 0; i < begin + count; i++)
+		{
+			covered = covered && hits[i].load() == (i >= begin ? 1 : 0);
+		}
+		check(covered, "parallel for", round);
+
+		// Stages of jobs, each stage starting only once the previous one is done
+		const int stages = 6;
+		JobCounter stageCounters[stages];
+		JobCounter all;
+		std::atomic<int> stageDone[stages];
+		int stageSize[stages];
+		std::atomic<int> earlyStarts{ 0 };
+		for (int stage = 0; stage < stages; stage++)
+		{
+			stageDone[stage] = 0;
+			stageSize[stage] = 1 + random() % 64;
+			for (int job = 0; job < stageSize[stage]; job++)
+			{
+				auto work = [&, stage]()
+				{
+					if (stage > 0 && stageDone[stage - 1].load() != stageSize[stage - 1])
+					{
+						earlyStarts++;
+					}
+					stageDone[stage]++;
+				};
+				if (stage == 0)
+				{
+					jobs.Run(work, &stageCounters[stage]);
+				}
+				else
+				{
+					jobs.RunAfter(stageCounters[stage - 1], work, &stageCounters[stage]);
+				}
+			}
+		}
+		jobs.Wait(stageCounters[stages - 1]);
+		check(earlyStarts == 0 && stageDone[stages - 1] == stageSize[stages - 1], "dependencies", round);
+		for (int stage = 0; stage < stages; stage++)
+		{
+			jobs.Wait(stageCounters[stage]);
+		}
+
+		// Futures, some of them from inside jobs
+		std::vector<std::future<long long>> futures;
+		for (int i = 0; i < 64; i++)
+		{
+			futures.push_back(jobs.Submit([&jobs, i]()
+			{
+				std::atomic<long long> sum{ 0 };
+				jobs.ParallelFor(0, 1000, 64, [&sum, i](int first, int last)
+				{
+					for (int k = first; k < last; k++)
+					{
+						sum += k * i;
+					}
+				});
+				return sum.load();
+			}));
+		}
+		long long total = 0;
+		for (std::future<long long>& future : futures)
+		{
+			total += future.get();
+		}
+		check(total == 499500LL * (63 * 64 / 2), "futures", round);
+
+		// Several outside threads queuing and waiting at the same time
+		std::atomic<int> outsideJobs{ 0 };
+		std::vector<std::thread> outside;
+		for (int thread = 0; thread < 4; thread++)
+		{
+			outside.emplace_back([&jobs, &outsideJobs]()
+			{
+				JobCounter counter;
+				for (int i = 0; i < 1000; i++)
+				{
+					jobs.Run([&outsideJobs]() { outsideJobs++; }, &counter);
+				}
+				jobs.Wait(counter);
+			});
+		}
+		for (std::thread& thread : outside)
+		{
+			thread.join();
+		}
+		check(outsideJobs == 4000, "outside threads", round);
+	}
+
+	std::cout << rounds << " rounds of the job system stress test: " << (failures == 0 ? "passed" : "FAILED") << std::endl;
+	return failures == 0;
+}
@@ -0,0 +1,786 @@
+#include "blockCompression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BC_USE_SSE2
+#endif
+
+// Pixels of a block stored channel by channel, px[channel][pixel]
+typedef float BlockPixels[4][16];
+
+// BC7 4-bit index interpolation weights, out of 64
+static const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+GLenum blockInternalFormat(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+	case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+	return 0;
+}
+
+// Bytes taken by one 4x4 block
+static size_t blockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t compressedSize(int width, int height, BlockFormat format)
+{
+	size_t blocksX = std::max(1, (width + 3) / 4);
+	size_t blocksY = std::max(1, (height + 3) / 4);
+	return blocksX * blocksY * blockBytes(format);
+}
+
+// Returns the squared error of each pixel to its closest palette entry and stores that entry's index
+static float nearestIndices(const float (*px)[16], int channels, const float (*palette)[4], int paletteSize, unsigned char indices[16])
+{
+	float error = 0.0f;
+#ifdef BC_USE_SSE2
+	// Four pixels at a time against every palette entry
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (int p = 0; p < paletteSize; p++)
+		{
+			__m128 distance = _mm_setzero_ps();
+			for (int c = 0; c < channels; c++)
+			{
+				__m128 d = _mm_sub_ps(_mm_loadu_ps(&px[c][i]), _mm_set1_ps(palette[p][c]));
+				distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+			}
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+			best = _mm_min_ps(distance, best);
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+		}
+
+		alignas(16) int32_t laneIndex[4];
+		alignas(16) float laneError[4];
+		_mm_store_si128((__m128i*)laneIndex, bestIndex);
+		_mm_store_ps(laneError, best);
+		for (int k = 0; k < 4; k++)
+		{
+			indices[i + k] = (unsigned char)laneIndex[k];
+			error += laneError[k];
+		}
+	}
+#else
+	for (int i = 0; i < 16; i++)
+	{
+		float best = FLT_MAX;
+		for (int p = 0; p < paletteSize; p++)
+		{
+			float distance = 0.0f;
+			for (int c = 0; c < channels; c++)
+			{
+				float d = px[c][i] - palette[p][c];
+				distance += d * d;
+			}
+			if (distance < best)
+			{
+				best = distance;
+				indices[i] = (unsigned char)p;
+			}
+		}
+		error += best;
+	}
+#endif
+	return error;
+}
+
+// Finds the endpoints of the segment fitting the pixels best, along their principal axis
+static void principalEndpoints(const BlockPixels& px, int channels, int iterations, float e0[4], float e1[4])
+{
+	float mean[4] = {};
+	float low[4], high[4];
+	for (int c = 0; c < channels; c++)
+	{
+		low[c] = high[c] = px[c][0];
+		for (int i = 0; i < 16; i++)
+		{
+			mean[c] += px[c][i] / 16.0f;
+			low[c] = std::min(low[c], px[c][i]);
+			high[c] = std::max(high[c], px[c][i]);
+		}
+	}
+
+	float covariance[4][4] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		for (int a = 0; a < channels; a++)
+		{
+			for (int b = 0; b < channels; b++)
+			{
+				covariance[a][b] += (px[a][i] - mean[a]) * (px[b][i] - mean[b]);
+			}
+		}
+	}
+
+	// Power iteration, starting from the bounding box diagonal
+	float axis[4] = {};
+	for (int c = 0; c < channels; c++)
+	{
+		axis[c] = high[c] - low[c];
+	}
+	for (int it = 0; it < iterations; it++)
+	{
+		float next[4] = {};
+		float largest = 0.0f;
+		for (int a = 0; a < channels; a++)
+		{
+			for (int b = 0; b < channels; b++)
+			{
+				next[a] += covariance[a][b] * axis[b];
+			}
+			largest = std::max(largest, std::fabs(next[a]));
+		}
+		if (largest < 1e-6f)
+		{
+			break;
+		}
+		for (int c = 0; c < channels; c++)
+		{
+			axis[c] = next[c] / largest;
+		}
+	}
+
+	float length = 0.0f;
+	for (int c = 0; c < channels; c++)
+	{
+		length += axis[c] * axis[c];
+	}
+	if (length < 1e-12f)
+	{
+		// Flat block, both endpoints on the mean
+		for (int c = 0; c < channels; c++)
+		{
+			e0[c] = e1[c] = mean[c];
+		}
+		return;
+	}
+	length = std::sqrt(length);
+
+	// Projects the pixels on the axis to find the segment extremities
+	float tMin = FLT_MAX, tMax = -FLT_MAX;
+	for (int i = 0; i < 16; i++)
+	{
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++)
+		{
+			t += (px[c][i] - mean[c]) * axis[c] / length;
+		}
+		tMin = std::min(tMin, t);
+		tMax = std::max(tMax, t);
+	}
+	for (int c = 0; c < channels; c++)
+	{
+		e0[c] = std::min(255.0f, std::max(0.0f, mean[c] + tMin * axis[c] / length));
+		e1[c] = std::min(255.0f, std::max(0.0f, mean[c] + tMax * axis[c] / length));
+	}
+}
+
+// Solves for the endpoints minimizing the error with fixed indices, weights[index] being the share of e1
+static bool leastSquaresEndpoints(const BlockPixels& px, int channels, const unsigned char indices[16], const float* weights, float e0[4], float e1[4])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		float b = weights[indices[i]];
+		float a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int c = 0; c < channels; c++)
+		{
+			ax[c] += a * px[c][i];
+			bx[c] += b * px[c][i];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f)
+	{
+		return false;
+	}
+	for (int c = 0; c < channels; c++)
+	{
+		e0[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / determinant));
+		e1[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / determinant));
+	}
+	return true;
+}
+
+// ----- BC1 -----
+
+static uint16_t packRGB565(const float color[4])
+{
+	int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+	int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+	int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t value, int color[3])
+{
+	int r = (value >> 11) & 31;
+	int g = (value >> 5) & 63;
+	int b = value & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// Encodes a BC1 block from two endpoints, returns its squared error
+static float encodeBC1Endpoints(const BlockPixels& px, const float e0[4], const float e1[4], unsigned char out[8], unsigned char indices[16])
+{
+	uint16_t color0 = packRGB565(e0);
+	uint16_t color1 = packRGB565(e1);
+	// color0 > color1 selects the four colors mode
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	int c0[3], c1[3];
+	unpackRGB565(color0, c0);
+	unpackRGB565(color1, c1);
+
+	float palette[4][4] = {};
+	for (int c = 0; c < 3; c++)
+	{
+		palette[0][c] = (float)c0[c];
+		palette[1][c] = (float)c1[c];
+		palette[2][c] = (float)((2 * c0[c] + c1[c]) / 3);
+		palette[3][c] = (float)((c0[c] + 2 * c1[c]) / 3);
+	}
+
+	float error = nearestIndices(px, 3, palette, color0 == color1 ? 1 : 4, indices);
+
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		bits |= (uint32_t)indices[i] << (2 * i);
+	}
+	out[0] = color0 & 0xFF;
+	out[1] = color0 >> 8;
+	out[2] = color1 & 0xFF;
+	out[3] = color1 >> 8;
+	memcpy(out + 4, &bits, 4);
+	return error;
+}
+
+static void encodeBC1(const BlockPixels& px, CompressionPreset preset, unsigned char out[8])
+{
+	// Share of color1 in each of the four palette entries
+	static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	float e0[4], e1[4];
+	unsigned char indices[16];
+	principalEndpoints(px, 3, preset == CompressionPreset::Quality ? 8 : 3, e0, e1);
+	float error = encodeBC1Endpoints(px, e0, e1, out, indices);
+
+	int refinements = preset == CompressionPreset::Quality ? 2 : 0;
+	for (int r = 0; r < refinements; r++)
+	{
+		// Starts from the endpoints actually stored, in their stored order
+		int c0[3], c1[3];
+		unpackRGB565((uint16_t)(out[0] | (out[1] << 8)), c0);
+		unpackRGB565((uint16_t)(out[2] | (out[3] << 8)), c1);
+		for (int c = 0; c < 3; c++)
+		{
+			e0[c] = (float)c0[c];
+			e1[c] = (float)c1[c];
+		}
+		if (!leastSquaresEndpoints(px, 3, indices, weights, e0, e1))
+		{
+			break;
+		}
+
+		unsigned char candidate[8];
+		unsigned char candidateIndices[16];
+		float candidateError = encodeBC1Endpoints(px, e0, e1, candidate, candidateIndices);
+		if (candidateError >= error)
+		{
+			break;
+		}
+		error = candidateError;
+		memcpy(out, candidate, 8);
+		memcpy(indices, candidateIndices, 16);
+	}
+}
+
+// ----- BC4, single channel, used for the BC3 alpha and the BC5 channels -----
+
+// Builds the palette the decoder derives from the two endpoints
+static void paletteBC4(int a0, int a1, float palette[8][4])
+{
+	palette[0][0] = (float)a0;
+	palette[1][0] = (float)a1;
+	if (a0 > a1)
+	{
+		for (int k = 0; k < 6; k++)
+		{
+			palette[2 + k][0] = (float)(((6 - k) * a0 + (1 + k) * a1) / 7);
+		}
+	}
+	else
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			palette[2 + k][0] = (float)(((4 - k) * a0 + (1 + k) * a1) / 5);
+		}
+		palette[6][0] = 0.0f;
+		palette[7][0] = 255.0f;
+	}
+}
+
+// Encodes a BC4 block from two endpoints, returns its squared error
+static float encodeBC4Endpoints(const float values[16], int a0, int a1, unsigned char out[8])
+{
+	float palette[8][4] = {};
+	paletteBC4(a0, a1, palette);
+
+	unsigned char indices[16];
+	float error = nearestIndices((const float (*)[16])values, 1, palette, 8, indices);
+
+	uint64_t bits = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		bits |= (uint64_t)indices[i] << (3 * i);
+	}
+	out[0] = (unsigned char)a0;
+	out[1] = (unsigned char)a1;
+	for (int b = 0; b < 6; b++)
+	{
+		out[2 + b] = (unsigned char)(bits >> (8 * b));
+	}
+	return error;
+}
+
+static void encodeBC4(const float values[16], CompressionPreset preset, unsigned char out[8])
+{
+	float low = 255.0f, high = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		low = std::min(low, values[i]);
+		high = std::max(high, values[i]);
+	}
+
+	// Eight interpolated values between the extremes
+	float error = encodeBC4Endpoints(values, (int)(high + 0.5f), (int)(low + 0.5f), out);
+	if (preset != CompressionPreset::Quality || error == 0.0f)
+	{
+		return;
+	}
+
+	// Six values between the inner extremes, pure 0 and 255 come for free
+	float innerLow = 255.0f, innerHigh = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		if (values[i] > 0.0f && values[i] < 255.0f)
+		{
+			innerLow = std::min(innerLow, values[i]);
+			innerHigh = std::max(innerHigh, values[i]);
+		}
+	}
+	if (innerLow > innerHigh)
+	{
+		innerLow = innerHigh = 0.0f;
+	}
+
+	unsigned char candidate[8];
+	float candidateError = encodeBC4Endpoints(values, (int)(innerLow + 0.5f), (int)(innerHigh + 0.5f), candidate);
+	if (candidateError < error)
+	{
+		memcpy(out, candidate, 8);
+	}
+}
+
+// ----- BC7 mode 6: one subset, RGBA endpoints 7.7.7.7 + p-bit, 4-bit indices -----
+
+// Quantizes an endpoint to 7 bits per channel plus the shared p-bit giving the lowest error
+static void quantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& pBit)
+{
+	float bestError = FLT_MAX;
+	for (int p = 0; p < 2; p++)
+	{
+		int candidate[4];
+		float error = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			candidate[c] = std::min(127, std::max(0, (int)std::lround((endpoint[c] - p) / 2.0f)));
+			float d = (float)((candidate[c] << 1) | p) - endpoint[c];
+			error += d * d;
+		}
+		if (error < bestError)
+		{
+			bestError = error;
+			pBit = p;
+			memcpy(quantized, candidate, sizeof(candidate));
+		}
+	}
+}
+
+// Writes value on bits LSB first, the way BC7 blocks are laid out
+static void writeBits(unsigned char out[16], int& position, uint32_t value, int bits)
+{
+	for (int b = 0; b < bits; b++, position++)
+	{
+		if ((value >> b) & 1)
+		{
+			out[position >> 3] |= (unsigned char)(1 << (position & 7));
+		}
+	}
+}
+
+static uint32_t readBits(const unsigned char in[16], int& position, int bits)
+{
+	uint32_t value = 0;
+	for (int b = 0; b < bits; b++, position++)
+	{
+		value |= (uint32_t)((in[position >> 3] >> (position & 7)) & 1) << b;
+	}
+	return value;
+}
+
+// Encodes a BC7 mode 6 block from two endpoints, returns its squared error
+static float encodeBC7Endpoints(const BlockPixels& px, const float e0[4], const float e1[4], unsigned char out[16], unsigned char indices[16], float stored0[4], float stored1[4])
+{
+	int q0[4], q1[4];
+	int p0, p1;
+	quantizeBC7Endpoint(e0, q0, p0);
+	quantizeBC7Endpoint(e1, q1, p1);
+
+	int r0[4], r1[4];
+	for (int c = 0; c < 4; c++)
+	{
+		r0[c] = (q0[c] << 1) | p0;
+		r1[c] = (q1[c] << 1) | p1;
+	}
+
+	float palette[16][4];
+	for (int k = 0; k < 16; k++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			palette[k][c] = (float)(((64 - bc7Weights[k]) * r0[c] + bc7Weights[k] * r1[c] + 32) >> 6);
+		}
+	}
+	float error = nearestIndices(px, 4, palette, 16, indices);
+
+	// The first index is stored on 3 bits, so its high bit has to be 0
+	if (indices[0] >= 8)
+	{
+		std::swap(q0, q1);
+		std::swap(r0, r1);
+		std::swap(p0, p1);
+		for (int i = 0; i < 16; i++)
+		{
+			indices[i] = (unsigned char)(15 - indices[i]);
+		}
+	}
+
+	memset(out, 0, 16);
+	int position = 0;
+	writeBits(out, position, 1 << 6, 7);
+	for (int c = 0; c < 4; c++)
+	{
+		writeBits(out, position, q0[c], 7);
+		writeBits(out, position, q1[c], 7);
+	}
+	writeBits(out, position, p0, 1);
+	writeBits(out, position, p1, 1);
+	writeBits(out, position, indices[0], 3);
+	for (int i = 1; i < 16; i++)
+	{
+		writeBits(out, position, indices[i], 4);
+	}
+
+	for (int c = 0; c < 4; c++)
+	{
+		stored0[c] = (float)r0[c];
+		stored1[c] = (float)r1[c];
+	}
+	return error;
+}
+
+static void encodeBC7(const BlockPixels& px, CompressionPreset preset, unsigned char out[16])
+{
+	float weights[16];
+	for (int k = 0; k < 16; k++)
+	{
+		weights[k] = bc7Weights[k] / 64.0f;
+	}
+
+	float e0[4], e1[4];
+	unsigned char indices[16];
+	principalEndpoints(px, 4, preset == CompressionPreset::Quality ? 8 : 3, e0, e1);
+	float error = encodeBC7Endpoints(px, e0, e1, out, indices, e0, e1);
+
+	int refinements = preset == CompressionPreset::Quality ? 2 : 0;
+	for (int r = 0; r < refinements; r++)
+	{
+		if (!leastSquaresEndpoints(px, 4, indices, weights, e0, e1))
+		{
+			break;
+		}
+
+		unsigned char candidate[16];
+		unsigned char candidateIndices[16];
+		float stored0[4], stored1[4];
+		float candidateError = encodeBC7Endpoints(px, e0, e1, candidate, candidateIndices, stored0, stored1);
+		if (candidateError >= error)
+		{
+			break;
+		}
+		error = candidateError;
+		memcpy(out, candidate, 16);
+		memcpy(indices, candidateIndices, 16);
+		memcpy(e0, stored0, sizeof(stored0));
+		memcpy(e1, stored1, sizeof(stored1));
+	}
+}
+
+// ----- Images -----
+
+// Gathers a block, clamping the coordinates on the right and bottom edges
+static void loadBlock(const unsigned char* rgba, int width, int height, int blockX, int blockY, BlockPixels& px)
+{
+	for (int y = 0; y < 4; y++)
+	{
+		int sy = std::min(blockY * 4 + y, height - 1);
+		for (int x = 0; x < 4; x++)
+		{
+			int sx = std::min(blockX * 4 + x, width - 1);
+			const unsigned char* pixel = rgba + ((size_t)sy * width + sx) * 4;
+			for (int c = 0; c < 4; c++)
+			{
+				px[c][y * 4 + x] = pixel[c];
+			}
+		}
+	}
+}
+
+static void compressBlockRows(const unsigned char* rgba, int width, int height, BlockFormat format, CompressionPreset preset, int firstRow, int lastRow, unsigned char* out)
+{
+	int blocksX = std::max(1, (width + 3) / 4);
+	size_t bytes = blockBytes(format);
+
+	for (int by = firstRow; by < lastRow; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			BlockPixels px;
+			loadBlock(rgba, width, height, bx, by, px);
+			unsigned char* block = out + ((size_t)by * blocksX + bx) * bytes;
+
+			switch (format)
+			{
+			case BlockFormat::BC1:
+				encodeBC1(px, preset, block);
+				break;
+			case BlockFormat::BC3:
+				encodeBC4(px[3], preset, block);
+				encodeBC1(px, preset, block + 8);
+				break;
+			case BlockFormat::BC5:
+				encodeBC4(px[0], preset, block);
+				encodeBC4(px[1], preset, block + 8);
+				break;
+			case BlockFormat::BC7:
+				encodeBC7(px, preset, block);
+				break;
+			}
+		}
+	}
+}
+
+std::vector<unsigned char> compressImage(const unsigned char* rgba, int width, int height, BlockFormat format, CompressionPreset preset, JobSystem* jobs)
+{
+	std::vector<unsigned char> blocks(compressedSize(width, height, format));
+	int blocksY = std::max(1, (height + 3) / 4);
+
+	if (jobs == nullptr || blocksY < 2)
+	{
+		compressBlockRows(rgba, width, height, format, preset, 0, blocksY, blocks.data());
+		return blocks;
+	}
+
+	// A few chunks per thread so they stay busy when rows compress at different speeds
+	int chunk = std::max(1, blocksY / (int)((jobs->Size() + 1) * 4));
+	unsigned char* out = blocks.data();
+	jobs->ParallelFor(0, blocksY, chunk, [=](int row, int last) { compressBlockRows(rgba, width, height, format, preset, row, last, out); });
+	return blocks;
+}
+
+// ----- Decoding, for quality measurements -----
+
+static void decodeBC1(const unsigned char in[8], unsigned char out[16][4])
+{
+	uint16_t color0 = (uint16_t)(in[0] | (in[1] << 8));
+	uint16_t color1 = (uint16_t)(in[2] | (in[3] << 8));
+	int c0[3], c1[3];
+	unpackRGB565(color0, c0);
+	unpackRGB565(color1, c1);
+
+	int palette[4][4];
+	for (int c = 0; c < 3; c++)
+	{
+		palette[0][c] = c0[c];
+		palette[1][c] = c1[c];
+		if (color0 > color1)
+		{
+			palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+			palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (c0[c] + c1[c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	palette[0][3] = palette[1][3] = palette[2][3] = 255;
+	palette[3][3] = color0 > color1 ? 255 : 0;
+
+	uint32_t bits;
+	memcpy(&bits, in + 4, 4);
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			out[i][c] = (unsigned char)palette[(bits >> (2 * i)) & 3][c];
+		}
+	}
+}
+
+static void decodeBC4(const unsigned char in[8], unsigned char out[16][4], int channel)
+{
+	float palette[8][4] = {};
+	paletteBC4(in[0], in[1], palette);
+
+	uint64_t bits = 0;
+	for (int b = 0; b < 6; b++)
+	{
+		bits |= (uint64_t)in[2 + b] << (8 * b);
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		out[i][channel] = (unsigned char)palette[(bits >> (3 * i)) & 7][0];
+	}
+}
+
+static void decodeBC7(const unsigned char in[16], unsigned char out[16][4])
+{
+	// Only mode 6 is written by the encoder, other modes decode to magenta
+	if ((in[0] & 0x7F) != 0x40)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			out[i][0] = 255;
+			out[i][1] = 0;
+			out[i][2] = 255;
+			out[i][3] = 255;
+		}
+		return;
+	}
+
+	int position = 7;
+	int q0[4], q1[4];
+	for (int c = 0; c < 4; c++)
+	{
+		q0[c] = (int)readBits(in, position, 7);
+		q1[c] = (int)readBits(in, position, 7);
+	}
+	int p0 = (int)readBits(in, position, 1);
+	int p1 = (int)readBits(in, position, 1);
+
+	for (int i = 0; i < 16; i++)
+	{
+		int index = (int)readBits(in, position, i == 0 ? 3 : 4);
+		for (int c = 0; c < 4; c++)
+		{
+			int r0 = (q0[c] << 1) | p0;
+			int r1 = (q1[c] << 1) | p1;
+			out[i][c] = (unsigned char)(((64 - bc7Weights[index]) * r0 + bc7Weights[index] * r1 + 32) >> 6);
+		}
+	}
+}
+
+void decompressImage(const unsigned char* blocks, int width, int height, BlockFormat format, unsigned char* rgba)
+{
+	int blocksX = std::max(1, (width + 3) / 4);
+	int blocksY = std::max(1, (height + 3) / 4);
+	size_t bytes = blockBytes(format);
+
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			const unsigned char* block = blocks + ((size_t)by * blocksX + bx) * bytes;
+			unsigned char decoded[16][4] = {};
+
+			switch (format)
+			{
+			case BlockFormat::BC1:
+				decodeBC1(block, decoded);
+				break;
+			case BlockFormat::BC3:
+				decodeBC1(block + 8, decoded);
+				decodeBC4(block, decoded, 3);
+				break;
+			case BlockFormat::BC5:
+				decodeBC4(block, decoded, 0);
+				decodeBC4(block + 8, decoded, 1);
+				break;
+			case BlockFormat::BC7:
+				decodeBC7(block, decoded);
+				break;
+			}
+
+			// Drops the pixels of the padding on the edges
+			for (int y = 0; y < 4 && by * 4 + y < height; y++)
+			{
+				for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+				{
+					memcpy(rgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, decoded[y * 4 + x], 4);
+				}
+			}
+		}
+	}
+}
+
+double computePSNR(const unsigned char* reference, const unsigned char* decoded, int width, int height, BlockFormat format)
+{
+	// BC1 has no alpha and BC5 only stores red and green
+	int channels = format == BlockFormat::BC1 ? 3 : format == BlockFormat::BC5 ? 2 : 4;
+
+	double squaredError = 0.0;
+	size_t pixels = (size_t)width * height;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			double d = (double)reference[i * 4 + c] - decoded[i * 4 + c];
+			squaredError += d * d;
+		}
+	}
+
+	double mse = squaredError / (pixels * channels);
+	if (mse == 0.0)
+	{
+		return INFINITY;
+	}
+	return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
@@ -7,21 +7,106 @@ Camera::Camera(int width, int height, glm::vec3 position, float FOVdeg, float ne
 	Camera::width = width;
 	Camera::height = height;
 	Position = position;
+	PreviousPosition = position;
 }
 
-void Camera::updateMatrix(float FOVdeg, float nearPlane, float farPlane)
+void Camera::updateMatrix(float FOVdeg, float nearPlane, float farPlane, float alpha)
 {
-	// Initializes matrices since otherwise they will be the null matrix
-	glm::mat4 view = glm::mat4(1.0f);
-	glm::mat4 projection = glm::mat4(1.0f);
+	// Blends the last two steps so the motion stays smooth when frames and steps don't line up
+	glm::vec3 position = glm::mix(PreviousPosition, Position, alpha);
+	glm::vec3 orientation = glm::normalize(glm::mix(PreviousOrientation, Orientation, alpha));
 
-	// Makes camera look in the right direction from the right position
-	view = glm::lookAt(Position, Position + Orientation, Up);
-	// Adds perspective to the scene
-	projection = glm::perspective(glm::radians(FOVdeg), (float)width / height, nearPlane, farPlane);
+	bool changed = false;
+	if (!viewValid || position != viewPosition || orientation != viewOrientation || Up != viewUp)
+	{
+		// Makes camera look in the right direction from the right position
+		view = glm::lookAt(position, position + orientation, Up);
+		viewPosition = position;
+		viewOrientation = orientation;
+		viewUp = Up;
+		viewValid = true;
+		changed = true;
+	}
+	if (!projectionValid || FOVdeg != projectionFOV || nearPlane != projectionNear || farPlane != projectionFar ||
+		width != projectionWidth || height != projectionHeight || reverseZ != projectionReverseZ)
+	{
+		// Adds perspective to the scene
+		if (reverseZ)
+		{
+			// z_clip = near and w_clip = -z_view, so depth = near / distance: the float exponent keeps
+			// the precision even far away, and nothing is ever behind the far plane
+			float f = 1.0f / tan(glm::radians(FOVdeg) / 2.0f);
+			projection = glm::mat4(0.0f);
+			projection[0][0] = f / ((float)width / height);
+			projection[1][1] = f;
+			projection[2][3] = -1.0f;
+			projection[3][2] = nearPlane;
+		}
+		else
+		{
+			projection = glm::perspective(glm::radians(FOVdeg), (float)width / height, nearPlane, farPlane);
+		}
+		projectionFOV = FOVdeg;
+		projectionNear = nearPlane;
+		projectionFar = farPlane;
+		projectionWidth = width;
+		projectionHeight = height;
+		projectionReverseZ = reverseZ;
+		projectionValid = true;
+		changed = true;
+	}
+	if (!changed)
+	{
+		return;
+	}
 
 	// Sets new camera matrix
 	cameraMatrix = projection * view;
+	inverseValid = false;
+
+	// Extracts the frustum planes from the rows of the camera matrix (Gribb & Hartmann)
+	glm::mat4 rows = glm::transpose(cameraMatrix);
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	if (reverseZ)
+	{
+		// Depth goes from 1 (near) to 0 (infinity): there is no far plane, its stand-in accepts every point
+		planes[4] = rows[3] - rows[2];
+		planes[5] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+	else
+	{
+		planes[4] = rows[3] + rows[2];
+		planes[5] = rows[3] - rows[2];
+	}
+	for (int i = 0; i < (reverseZ ? 5 : 6); i++)
+	{
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+const glm::mat4& Camera::inverseMatrix()
+{
+	if (!inverseValid)
+	{
+		inverse = glm::inverse(cameraMatrix);
+		inverseValid = true;
+	}
+	return inverse;
+}
+
+bool Camera::SphereVisible(glm::vec3 center, float radius) const
+{
+	for (const glm::vec4& plane : planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
 }
 
 void Camera::Matrix(Shader& shader, const char* uniform)
@@ -32,40 +117,47 @@ void Camera::Matrix(Shader& shader, const char* uniform)
 
 
 
-void Camera::Inputs(GLFWwindow* window)
+void Camera::Inputs(GLFWwindow* window, float dt)
 {
+	// Keeps the state of the previous step to interpolate from
+	PreviousPosition = Position;
+	PreviousOrientation = Orientation;
+
+	// Distance covered during this step
+	float step = speed * dt;
+
 	// Handles key inputs
 	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
 	{
-		Position += speed * Orientation;
+		Position += step * Orientation;
 	}
 	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
 	{
-		Position += speed * -glm::normalize(glm::cross(Orientation, Up));
+		Position += step * -glm::normalize(glm::cross(Orientation, Up));
 	}
 	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
 	{
-		Position += speed * -Orientation;
+		Position += step * -Orientation;
 	}
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 	{
-		Position += speed * glm::normalize(glm::cross(Orientation, Up));
+		Position += step * glm::normalize(glm::cross(Orientation, Up));
 	}
 	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
 	{
-		Position += speed * Up;
+		Position += step * Up;
 	}
 	if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
 	{
-		Position += speed * -Up;
+		Position += step * -Up;
 	}
 	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
 	{
-		speed = 0.4f;
+		speed = 24.0f;
 	}
 	else if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_RELEASE)
 	{
-		speed = 0.1f;
+		speed = 6.0f;
 	}
 
 
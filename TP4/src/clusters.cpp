@@ -0,0 +1,252 @@
+#include "clusters.h"
+#include "glState.h"
+#include "cpuProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLUSTERS_USE_SSE
+#endif
+
+// Clusters in one depth slice, a multiple of 4 so they are tested four at a time
+const int SLICE_CLUSTERS = CLUSTERS_X * CLUSTERS_Y;
+static_assert(SLICE_CLUSTERS % 4 == 0, "a slice has to hold whole groups of four clusters");
+
+ClusterGrid::ClusterGrid(float nearPlane, float farPlane, JobSystem* jobs)
+	: nearPlane(nearPlane), farPlane(farPlane), jobs(jobs)
+{
+	minX.resize(CLUSTER_COUNT);
+	minY.resize(CLUSTER_COUNT);
+	minZ.resize(CLUSTER_COUNT);
+	maxX.resize(CLUSTER_COUNT);
+	maxY.resize(CLUSTER_COUNT);
+	maxZ.resize(CLUSTER_COUNT);
+	clusterLights.resize(CLUSTER_COUNT);
+	ranges.resize(2 * CLUSTER_COUNT);
+}
+
+// Distance to the camera where a depth slice starts, the same formula as in the shader
+static float sliceDepth(int slice, float nearPlane, float farPlane)
+{
+	return nearPlane * std::pow(farPlane / nearPlane, (float)slice / CLUSTERS_Z);
+}
+
+void ClusterGrid::SetProjection(const glm::mat4& newProjection)
+{
+	if (newProjection == projection)
+	{
+		return;
+	}
+	projection = newProjection;
+
+	// A point of the screen at normalized (x, y) seen at a distance d is at (x * d / P00, y * d / P11, -d),
+	// for the standard projection as well as the reversed infinite one
+	for (int z = 0; z < CLUSTERS_Z; z++)
+	{
+		float depths[2] = { sliceDepth(z, nearPlane, farPlane), sliceDepth(z + 1, nearPlane, farPlane) };
+		for (int y = 0; y < CLUSTERS_Y; y++)
+		{
+			for (int x = 0; x < CLUSTERS_X; x++)
+			{
+				glm::vec3 lo(1e30f), hi(-1e30f);
+				for (float d : depths)
+				{
+					for (int corner = 0; corner < 4; corner++)
+					{
+						float nx = -1.0f + 2.0f * (x + (corner & 1)) / CLUSTERS_X;
+						float ny = -1.0f + 2.0f * (y + (corner >> 1)) / CLUSTERS_Y;
+						glm::vec3 point(nx * d / projection[0][0], ny * d / projection[1][1], -d);
+						lo = glm::min(lo, point);
+						hi = glm::max(hi, point);
+					}
+				}
+				int cluster = x + CLUSTERS_X * (y + CLUSTERS_Y * z);
+				minX[cluster] = lo.x;
+				minY[cluster] = lo.y;
+				minZ[cluster] = lo.z;
+				maxX[cluster] = hi.x;
+				maxY[cluster] = hi.y;
+				maxZ[cluster] = hi.z;
+			}
+		}
+	}
+}
+
+void ClusterGrid::Bin(const std::vector<Light>& lights, const glm::mat4& view)
+{
+	// Spot lights are binned as the sphere around them
+	size_t lightCount = std::min(lights.size(), (size_t)MAX_CLUSTERED_LIGHTS);
+	viewLights.resize(lightCount);
+	for (size_t i = 0; i < lightCount; i++)
+	{
+		viewLights[i] = glm::vec4(glm::vec3(view * glm::vec4(lights[i].position, 1.0f)), lights[i].radius);
+	}
+
+	auto binSlice = [this](int z)
+	{
+		PROFILE_ZONE("bin slice");
+		float sliceNear = sliceDepth(z, nearPlane, farPlane);
+		float sliceFar = sliceDepth(z + 1, nearPlane, farPlane);
+		int first = z * SLICE_CLUSTERS;
+		for (int cluster = first; cluster < first + SLICE_CLUSTERS; cluster++)
+		{
+			clusterLights[cluster].clear();
+		}
+
+		for (uint32_t light = 0; light < (uint32_t)viewLights.size(); light++)
+		{
+			glm::vec4 sphere = viewLights[light];
+			float depth = -sphere.z;
+			if (depth + sphere.w < sliceNear || depth - sphere.w > sliceFar)
+			{
+				continue;
+			}
+
+			float radiusSquared = sphere.w * sphere.w;
+#ifdef CLUSTERS_USE_SSE
+			// Squared distance from the center to four boxes at once
+			__m128 zero = _mm_setzero_ps();
+			__m128 cx = _mm_set1_ps(sphere.x);
+			__m128 cy = _mm_set1_ps(sphere.y);
+			__m128 cz = _mm_set1_ps(sphere.z);
+			__m128 r2 = _mm_set1_ps(radiusSquared);
+			for (int cluster = first; cluster < first + SLICE_CLUSTERS; cluster += 4)
+			{
+				__m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minX[cluster]), cx), _mm_sub_ps(cx, _mm_loadu_ps(&maxX[cluster]))));
+				__m128 dy = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minY[cluster]), cy), _mm_sub_ps(cy, _mm_loadu_ps(&maxY[cluster]))));
+				__m128 dz = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minZ[cluster]), cz), _mm_sub_ps(cz, _mm_loadu_ps(&maxZ[cluster]))));
+				__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+				int touched = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, r2));
+				for (int bit = 0; touched != 0; bit++, touched >>= 1)
+				{
+					if (touched & 1)
+					{
+						clusterLights[cluster + bit].push_back(light);
+					}
+				}
+			}
+#else
+			for (int cluster = first; cluster < first + SLICE_CLUSTERS; cluster++)
+			{
+				float dx = std::max(0.0f, std::max(minX[cluster] - sphere.x, sphere.x - maxX[cluster]));
+				float dy = std::max(0.0f, std::max(minY[cluster] - sphere.y, sphere.y - maxY[cluster]));
+				float dz = std::max(0.0f, std::max(minZ[cluster] - sphere.z, sphere.z - maxZ[cluster]));
+				if (dx * dx + dy * dy + dz * dz <= radiusSquared)
+				{
+					clusterLights[cluster].push_back(light);
+				}
+			}
+#endif
+		}
+	};
+
+	// The slices write to their own clusters only, so they run in parallel without locking
+	if (jobs != nullptr)
+	{
+		jobs->ParallelFor(0, CLUSTERS_Z, 1, [&binSlice](int first, int last)
+		{
+			for (int z = first; z < last; z++)
+			{
+				binSlice(z);
+			}
+		});
+	}
+	else
+	{
+		for (int z = 0; z < CLUSTERS_Z; z++)
+		{
+			binSlice(z);
+		}
+	}
+
+	// Flattens the lists
+	indices.clear();
+	for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+	{
+		ranges[2 * cluster] = (uint32_t)indices.size();
+		ranges[2 * cluster + 1] = (uint32_t)clusterLights[cluster].size();
+		indices.insert(indices.end(), clusterLights[cluster].begin(), clusterLights[cluster].end());
+	}
+}
+
+ClusterBuffers::ClusterBuffers()
+{
+	const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	glGenBuffers(3, buffers);
+	glGenTextures(3, textures);
+	for (int i = 0; i < 3; i++)
+	{
+		// Never empty, a buffer texture needs some storage
+		GLState::Current().BindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		capacities[i] = 16;
+		GLState::Current().BindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+	}
+	GLState::Current().BindTexture(GL_TEXTURE_BUFFER, 0);
+	GLState::Current().BindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusterBuffers::Fill(int buffer, const void* data, size_t size)
+{
+	GLState::Current().BindBuffer(GL_TEXTURE_BUFFER, buffers[buffer]);
+	if (size > capacities[buffer])
+	{
+		// Grows with some margin so a few more lights don't reallocate every frame
+		capacities[buffer] = size + size / 2;
+	}
+	// Orphans the storage the previous frame may still be reading
+	glBufferData(GL_TEXTURE_BUFFER, capacities[buffer], NULL, GL_STREAM_DRAW);
+	if (size > 0)
+	{
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+	}
+}
+
+void ClusterBuffers::Upload(const std::vector<Light>& lights, const ClusterGrid& grid)
+{
+	size_t lightCount = std::min(lights.size(), (size_t)MAX_CLUSTERED_LIGHTS);
+	Fill(0, lights.data(), lightCount * sizeof(Light));
+	Fill(1, grid.ranges.data(), grid.ranges.size() * sizeof(uint32_t));
+	Fill(2, grid.indices.data(), grid.indices.size() * sizeof(uint32_t));
+	GLState::Current().BindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusterBuffers::Bind(Shader& shader, GLuint firstUnit, const ClusterGrid& grid, int screenWidth, int screenHeight, const glm::mat4& view)
+{
+	// Looked up when the shader changes only, the samplers keep their units in the program
+	if (shader.ID != locationsProgram || firstUnit != samplerUnit)
+	{
+		const char* samplers[3] = { "lightData", "clusterRanges", "clusterLightIndices" };
+		for (int i = 0; i < 3; i++)
+		{
+			glUniform1i(glGetUniformLocation(shader.ID, samplers[i]), firstUnit + i);
+		}
+		viewLocation = glGetUniformLocation(shader.ID, "viewMatrix");
+		screenSizeLocation = glGetUniformLocation(shader.ID, "screenSize");
+		clusterDepthsLocation = glGetUniformLocation(shader.ID, "clusterDepths");
+		locationsProgram = shader.ID;
+		samplerUnit = firstUnit;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		GLState::Current().ActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		GLState::Current().BindTexture(GL_TEXTURE_BUFFER, textures[i]);
+	}
+	GLState::Current().ActiveTexture(GL_TEXTURE0);
+
+	glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view));
+	glUniform2f(screenSizeLocation, (float)screenWidth, (float)screenHeight);
+	glUniform2f(clusterDepthsLocation, grid.nearPlane, grid.farPlane);
+}
+
+void ClusterBuffers::Delete()
+{
+	GLState::Current().DeleteTextures(3, textures);
+	GLState::Current().DeleteBuffers(3, buffers);
+}
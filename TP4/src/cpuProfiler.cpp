@@ -0,0 +1,131 @@
+#include "cpuProfiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+struct ProfileEvent
+{
+	const char* name;
+	int64_t start;
+	int64_t end;
+};
+
+// Events are appended by their thread only. The count is published after the event is written,
+// so the writer of the file reads complete events without taking a lock
+struct ProfileChunk
+{
+	static const size_t CAPACITY = 4096;
+	ProfileEvent events[CAPACITY];
+	std::atomic<size_t> count{ 0 };
+	std::atomic<ProfileChunk*> next{ nullptr };
+};
+
+// Buffer of one thread, kept until the end of the program since the file can be written at any time
+struct ProfileThread
+{
+	uint32_t id;
+	ProfileChunk* first;
+	ProfileChunk* last;
+	ProfileThread* next;
+};
+
+static std::atomic<bool> started{ false };
+static std::chrono::steady_clock::time_point startTime;
+static std::atomic<ProfileThread*> threads{ nullptr };
+static std::atomic<uint32_t> threadCount{ 0 };
+static thread_local ProfileThread* localThread = nullptr;
+
+void startCPUProfile()
+{
+	startTime = std::chrono::steady_clock::now();
+	started.store(true, std::memory_order_release);
+}
+
+bool cpuProfileStarted()
+{
+	return started.load(std::memory_order_acquire);
+}
+
+int64_t cpuProfileTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void recordCPUZone(const char* name, int64_t start, int64_t end)
+{
+	if (localThread == nullptr)
+	{
+		// First zone of the thread: its buffer is pushed on the list with a compare and swap
+		localThread = new ProfileThread();
+		localThread->id = ++threadCount;
+		localThread->first = new ProfileChunk();
+		localThread->last = localThread->first;
+		localThread->next = threads.load(std::memory_order_relaxed);
+		while (!threads.compare_exchange_weak(localThread->next, localThread, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	ProfileChunk* chunk = localThread->last;
+	size_t count = chunk->count.load(std::memory_order_relaxed);
+	if (count == ProfileChunk::CAPACITY)
+	{
+		ProfileChunk* full = chunk;
+		chunk = new ProfileChunk();
+		full->next.store(chunk, std::memory_order_release);
+		localThread->last = chunk;
+		count = 0;
+	}
+	chunk->events[count] = { name, start, end };
+	chunk->count.store(count + 1, std::memory_order_release);
+}
+
+// Names are string literals of the source, only quotes and backslashes could break the JSON
+static void writeEscaped(std::ofstream& file, const char* text)
+{
+	for (const char* c = text; *c != '\0'; c++)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			file << '\\';
+		}
+		file << *c;
+	}
+}
+
+bool writeCPUProfile(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "failed writing " << path << std::endl;
+		return false;
+	}
+
+	// Complete events ("X"), timestamps and durations in microseconds
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	const char* separator = "\n";
+	size_t events = 0;
+	for (ProfileThread* thread = threads.load(std::memory_order_acquire); thread != nullptr; thread = thread->next)
+	{
+		for (ProfileChunk* chunk = thread->first; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire))
+		{
+			size_t count = chunk->count.load(std::memory_order_acquire);
+			for (size_t i = 0; i < count; i++)
+			{
+				const ProfileEvent& event = chunk->events[i];
+				file << separator << "{\"name\":\"";
+				writeEscaped(file, event.name);
+				file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id << ",\"ts\":" << event.start / 1000.0
+					<< ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+				separator = ",\n";
+				events++;
+			}
+		}
+	}
+	file << "\n]}\n";
+	std::cout << events << " CPU zones written to " << path << std::endl;
+	return true;
+}
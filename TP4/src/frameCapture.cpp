@@ -0,0 +1,450 @@
+#include "frameCapture.h"
+#include "glState.h"
+#include "cpuProfiler.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+static bool endsWith(const std::string& text, const char* suffix)
+{
+	size_t length = strlen(suffix);
+	return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+// Whether a valid pattern holds its conversion, %% being a plain %
+static bool hasConversion(const std::string& pattern)
+{
+	for (size_t i = 0; i < pattern.size(); i++)
+	{
+		if (pattern[i] == '%')
+		{
+			if (i + 1 < pattern.size() && pattern[i + 1] == '%')
+			{
+				i++;
+				continue;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+static void appendBigEndian(std::vector<unsigned char>& bytes, uint32_t value)
+{
+	bytes.push_back((unsigned char)(value >> 24));
+	bytes.push_back((unsigned char)(value >> 16));
+	bytes.push_back((unsigned char)(value >> 8));
+	bytes.push_back((unsigned char)value);
+}
+
+static std::array<uint32_t, 256> crc32Table()
+{
+	std::array<uint32_t, 256> table;
+	for (uint32_t n = 0; n < 256; n++)
+	{
+		uint32_t c = n;
+		for (int k = 0; k < 8; k++)
+		{
+			c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		}
+		table[n] = c;
+	}
+	return table;
+}
+
+static uint32_t crc32(const unsigned char* bytes, size_t size)
+{
+	// Built on first use by the writer thread, the initialization of a local static is thread safe
+	static const std::array<uint32_t, 256> table = crc32Table();
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFFu;
+}
+
+// Length, type, data and CRC of the type and data
+static void appendChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& data)
+{
+	appendBigEndian(png, (uint32_t)data.size());
+	size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+	appendBigEndian(png, crc32(&png[start], png.size() - start));
+}
+
+bool writePNG(const std::string& path, const RGBImage& image)
+{
+	std::vector<unsigned char> header;
+	appendBigEndian(header, (uint32_t)image.width);
+	appendBigEndian(header, (uint32_t)image.height);
+	// 8 bits RGB, deflate, no filtering method other than the default, not interlaced
+	const unsigned char format[] = { 8, 2, 0, 0, 0 };
+	header.insert(header.end(), format, format + 5);
+
+	// Each row starts with its filter type, 0 leaves it as is
+	size_t rowBytes = (size_t)image.width * 3;
+	std::vector<unsigned char> rows;
+	rows.reserve((rowBytes + 1) * image.height);
+	for (int y = 0; y < image.height; y++)
+	{
+		rows.push_back(0);
+		rows.insert(rows.end(), image.pixels.begin() + y * rowBytes, image.pixels.begin() + (y + 1) * rowBytes);
+	}
+
+	// zlib stream of stored deflate blocks (65535 bytes at most each), ending with the Adler-32 of the rows
+	std::vector<unsigned char> data = { 0x78, 0x01 };
+	data.reserve(rows.size() + rows.size() / 65535 * 5 + 16);
+	size_t offset = 0;
+	do
+	{
+		size_t length = std::min<size_t>(rows.size() - offset, 65535);
+		data.push_back(offset + length == rows.size() ? 1 : 0);
+		data.push_back((unsigned char)length);
+		data.push_back((unsigned char)(length >> 8));
+		data.push_back((unsigned char)~length);
+		data.push_back((unsigned char)(~length >> 8));
+		data.insert(data.end(), rows.begin() + offset, rows.begin() + offset + length);
+		offset += length;
+	} while (offset < rows.size());
+	// The sums can go 5552 bytes without overflowing before they need the modulo
+	uint32_t a = 1, b = 0;
+	for (size_t start = 0; start < rows.size(); start += 5552)
+	{
+		size_t end = std::min<size_t>(rows.size(), start + 5552);
+		for (size_t i = start; i < end; i++)
+		{
+			a += rows[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	appendBigEndian(data, (b << 16) | a);
+
+	const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<unsigned char> png(signature, signature + 8);
+	appendChunk(png, "IHDR", header);
+	appendChunk(png, "IDAT", data);
+	appendChunk(png, "IEND", std::vector<unsigned char>());
+
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	bool written = fwrite(png.data(), 1, png.size(), file) == png.size();
+	fclose(file);
+	return written;
+}
+
+bool validCapturePattern(const std::string& pattern)
+{
+	int conversions = 0;
+	for (size_t i = 0; i < pattern.size(); i++)
+	{
+		if (pattern[i] != '%')
+		{
+			continue;
+		}
+		if (i + 1 < pattern.size() && pattern[i + 1] == '%')
+		{
+			i++;
+			continue;
+		}
+		// Flags, width and precision, no * (it would take an argument) and no length modifier
+		size_t end = i + 1;
+		while (end < pattern.size() && strchr("-+ #0", pattern[end]) != nullptr)
+		{
+			end++;
+		}
+		while (end < pattern.size() && isdigit((unsigned char)pattern[end]))
+		{
+			end++;
+		}
+		if (end < pattern.size() && pattern[end] == '.')
+		{
+			end++;
+			while (end < pattern.size() && isdigit((unsigned char)pattern[end]))
+			{
+				end++;
+			}
+		}
+		if (end == pattern.size() || strchr("diuxXo", pattern[end]) == nullptr)
+		{
+			return false;
+		}
+		conversions++;
+		i = end;
+	}
+	// None is fine, the constructor adds one
+	return conversions <= 1;
+}
+
+FrameCapture::FrameCapture(const std::string& pattern, int width, int height, int numPBOs, int maxQueued)
+	: pattern(pattern), width(width), height(height), maxQueued(maxQueued > 0 ? maxQueued : 1)
+{
+	format = endsWith(pattern, ".ppm") ? Format::PPM : endsWith(pattern, ".raw") ? Format::Raw : Format::PNG;
+	if (format == Format::PNG && !endsWith(pattern, ".png"))
+	{
+		std::cout << "capture format of " << pattern << " unknown, writing PNG" << std::endl;
+	}
+	// The pattern becomes a format string, one the caller didn't check is taken literally
+	if (!validCapturePattern(pattern))
+	{
+		std::cout << "capture pattern " << pattern << " isn't a single integer conversion, taken as a file name" << std::endl;
+		this->pattern.clear();
+		for (char c : pattern)
+		{
+			this->pattern += c == '%' ? "%%" : std::string(1, c);
+		}
+	}
+	// Without a number every frame would overwrite the same file
+	if (!hasConversion(this->pattern))
+	{
+		size_t dot = this->pattern.rfind('.');
+		this->pattern.insert(dot == std::string::npos ? this->pattern.size() : dot, "%04d");
+	}
+
+	ring.resize(numPBOs > 0 ? numPBOs : 1);
+	GLsizeiptr size = (GLsizeiptr)width * height * 4;
+	for (Slot& slot : ring)
+	{
+		glGenBuffers(1, &slot.PBO);
+		GLState::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+		// Read back by the CPU once
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+	}
+	GLState::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	writer = std::thread(&FrameCapture::WriterLoop, this);
+}
+
+void FrameCapture::Capture()
+{
+	PROFILE_ZONE("capture");
+	auto start = std::chrono::steady_clock::now();
+
+	while (Collect(false))
+	{
+	}
+
+	if (inFlight == ring.size())
+	{
+		droppedInFlight++;
+	}
+	else
+	{
+		Slot& slot = ring[next];
+		// Reads what the frame was drawn in, bindings are known to the driver without waiting on the GPU
+		GLint readFramebuffer = 0, drawFramebuffer = 0;
+		glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, drawFramebuffer);
+		// With a bound pack buffer the read only queues a copy, the pointer is an offset into the buffer
+		GLState::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		GLState::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.frame = frames;
+		next = (next + 1) % ring.size();
+		inFlight++;
+	}
+	frames++;
+
+	captureMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool FrameCapture::Collect(bool wait)
+{
+	if (inFlight == 0)
+	{
+		return false;
+	}
+	Slot& slot = ring[oldest];
+	if (wait)
+	{
+		while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED)
+		{
+		}
+	}
+	else
+	{
+		GLenum status = glClientWaitSync(slot.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		{
+			return false;
+		}
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+	oldest = (oldest + 1) % ring.size();
+	inFlight--;
+
+	std::vector<unsigned char> pixels;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (wait)
+		{
+			drained.wait(lock, [this]() { return queue.size() < maxQueued; });
+		}
+		else if (queue.size() >= maxQueued)
+		{
+			// Not worth mapping, the buffer is free again all the same
+			droppedQueueFull++;
+			return true;
+		}
+		if (!spare.empty())
+		{
+			pixels = std::move(spare.back());
+			spare.pop_back();
+		}
+	}
+
+	size_t size = (size_t)width * height * 4;
+	pixels.resize(size);
+	GLState::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_READ_BIT);
+	if (mapped != nullptr)
+	{
+		memcpy(pixels.data(), mapped, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	GLState::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (mapped == nullptr)
+	{
+		failed++;
+		return true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(Frame{ slot.frame, std::move(pixels) });
+	}
+	captured++;
+	wakeUp.notify_one();
+	return true;
+}
+
+void FrameCapture::WriterLoop()
+{
+	while (true)
+	{
+		Frame frame;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeUp.wait(lock, [this]() { return stopping || !queue.empty(); });
+			if (queue.empty())
+			{
+				return;
+			}
+			frame = std::move(queue.front());
+			queue.pop_front();
+			writing = true;
+		}
+
+		Write(frame);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			spare.push_back(std::move(frame.pixels));
+			writing = false;
+		}
+		drained.notify_all();
+	}
+}
+
+void FrameCapture::Write(const Frame& frame)
+{
+	PROFILE_ZONE("encode frame");
+	char path[1024];
+	snprintf(path, sizeof(path), pattern.c_str(), (int)frame.number);
+
+	bool saved;
+	if (format == Format::Raw)
+	{
+		FILE* file = fopen(path, "wb");
+		saved = file != nullptr && fwrite(frame.pixels.data(), 1, frame.pixels.size(), file) == frame.pixels.size();
+		if (file != nullptr)
+		{
+			fclose(file);
+		}
+	}
+	else
+	{
+		// GL puts the bottom row first, the files the top one
+		RGBImage image;
+		image.width = width;
+		image.height = height;
+		image.pixels.resize((size_t)width * height * 3);
+		for (int y = 0; y < height; y++)
+		{
+			const unsigned char* source = &frame.pixels[(size_t)(height - 1 - y) * width * 4];
+			unsigned char* destination = &image.pixels[(size_t)y * width * 3];
+			for (int x = 0; x < width; x++)
+			{
+				destination[x * 3] = source[x * 4];
+				destination[x * 3 + 1] = source[x * 4 + 1];
+				destination[x * 3 + 2] = source[x * 4 + 2];
+			}
+		}
+		saved = format == Format::PNG ? writePNG(path, image) : writePPM(path, image);
+	}
+
+	if (saved)
+	{
+		written++;
+	}
+	else if (failed++ == 0)
+	{
+		std::cout << "failed writing " << path << std::endl;
+	}
+}
+
+void FrameCapture::Finish()
+{
+	while (Collect(true))
+	{
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	drained.wait(lock, [this]() { return queue.empty() && !writing; });
+}
+
+void FrameCapture::Delete()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_one();
+	if (writer.joinable())
+	{
+		writer.join();
+	}
+
+	for (Slot& slot : ring)
+	{
+		if (slot.fence != nullptr)
+		{
+			glDeleteSync(slot.fence);
+		}
+		GLState::Current().DeleteBuffers(1, &slot.PBO);
+	}
+	ring.clear();
+	inFlight = 0;
+}
+
+void FrameCapture::Print() const
+{
+	std::cout << "capture: " << written << " of " << frames << " frames written, " << droppedInFlight << " dropped with every buffer in flight, "
+		<< droppedQueueFull << " with the writer behind, " << failed << " failed, "
+		<< (frames > 0 ? captureMs / frames : 0.0) << " ms per frame on the GL thread" << std::endl;
+}
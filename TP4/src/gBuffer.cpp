@@ -0,0 +1,74 @@
+#include "gBuffer.h"
+#include "glState.h"
+
+// Creates a screen-sized texture that is read texel by texel
+static GLuint screenTexture(int width, int height, GLenum internalFormat, GLenum format, GLenum type)
+{
+    GLuint texture;
+    glGenTextures(1,&texture);
+    GLState::Current().BindTexture(GL_TEXTURE_2D,texture);
+    glTexImage2D(GL_TEXTURE_2D,0,internalFormat,width,height,0,format,type,NULL);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+GBuffer::GBuffer(int width, int height, GLenum depthFormat)
+{
+    GBuffer::width = width;
+    GBuffer::height = height;
+
+    albedoTexture = screenTexture(width,height,GL_RGBA8,GL_RGBA,GL_UNSIGNED_BYTE);
+    // Half floats keep the normals signed and precise enough for the specular highlights
+    normalTexture = screenTexture(width,height,GL_RGBA16F,GL_RGBA,GL_FLOAT);
+    depthTexture = screenTexture(width,height,depthFormat,GL_DEPTH_COMPONENT,GL_FLOAT);
+    GLState::Current().BindTexture(GL_TEXTURE_2D,0);
+
+    glGenFramebuffers(1,&ID);
+    glBindFramebuffer(GL_FRAMEBUFFER,ID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,albedoTexture,0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT1,GL_TEXTURE_2D,normalTexture,0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_DEPTH_ATTACHMENT,GL_TEXTURE_2D,depthTexture,0);
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2,drawBuffers);
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+}
+
+bool GBuffer::Complete()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER,ID);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+    return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void GBuffer::Bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER,ID);
+}
+
+void GBuffer::Unbind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+}
+
+void GBuffer::BindTextures(GLuint firstUnit)
+{
+    const GLuint textures[3] = { albedoTexture, normalTexture, depthTexture };
+    for (int i = 0; i < 3; i++)
+    {
+        GLState::Current().ActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        GLState::Current().BindTexture(GL_TEXTURE_2D,textures[i]);
+    }
+    GLState::Current().ActiveTexture(GL_TEXTURE0);
+}
+
+void GBuffer::Delete()
+{
+    glDeleteFramebuffers(1,&ID);
+    GLState::Current().DeleteTextures(1,&albedoTexture);
+    GLState::Current().DeleteTextures(1,&normalTexture);
+    GLState::Current().DeleteTextures(1,&depthTexture);
+}
@@ -0,0 +1,226 @@
+#include "glState.h"
+
+// Targets and capabilities the cache follows, anything else is passed through (and counted as issued)
+static const GLenum bufferTargets[] = { GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_TEXTURE_BUFFER, GL_PIXEL_UNPACK_BUFFER, GL_PIXEL_PACK_BUFFER };
+static const GLenum textureTargets[] = { GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BUFFER };
+static const GLenum capabilities[] = { GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_DEPTH_CLAMP };
+
+// Position of value in list, -1 if it isn't there
+static int indexOf(const GLenum* list, int count, GLenum value)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (list[i] == value)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+GLState& GLState::Current()
+{
+	static GLState state;
+	return state;
+}
+
+GLState::GLState()
+{
+	Invalidate();
+}
+
+void GLState::Invalidate()
+{
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	activeUnit = UNKNOWN;
+	for (GLuint& buffer : buffers)
+	{
+		buffer = UNKNOWN;
+	}
+	for (int unit = 0; unit < UNITS; unit++)
+	{
+		for (int target = 0; target < TEXTURE_TARGETS; target++)
+		{
+			textures[unit][target] = UNKNOWN;
+		}
+	}
+	for (int& capability : enabled)
+	{
+		capability = -1;
+	}
+}
+
+bool GLState::Changed(GLuint& cached, GLuint value)
+{
+	if (cached == value)
+	{
+		frame.elided++;
+		return false;
+	}
+	cached = value;
+	frame.issued++;
+	return true;
+}
+
+void GLState::UseProgram(GLuint newProgram)
+{
+	if (Changed(program, newProgram))
+	{
+		glUseProgram(newProgram);
+	}
+}
+
+void GLState::BindVertexArray(GLuint newVertexArray)
+{
+	if (Changed(vertexArray, newVertexArray))
+	{
+		glBindVertexArray(newVertexArray);
+		// The element buffer binding belongs to the vertex array
+		buffers[1] = UNKNOWN;
+	}
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+	int index = indexOf(bufferTargets, BUFFER_TARGETS, target);
+	if (index < 0)
+	{
+		frame.issued++;
+		glBindBuffer(target, buffer);
+	}
+	else if (Changed(buffers[index], buffer))
+	{
+		glBindBuffer(target, buffer);
+	}
+}
+
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	// Indexed bindings aren't followed, the call always goes through
+	frame.issued++;
+	glBindBufferBase(target, index, buffer);
+	int targetIndex = indexOf(bufferTargets, BUFFER_TARGETS, target);
+	if (targetIndex >= 0)
+	{
+		buffers[targetIndex] = buffer;
+	}
+}
+
+void GLState::ActiveTexture(GLenum unit)
+{
+	if (Changed(activeUnit, unit - GL_TEXTURE0))
+	{
+		glActiveTexture(unit);
+	}
+}
+
+void GLState::BindTexture(GLenum target, GLuint texture)
+{
+	int index = indexOf(textureTargets, TEXTURE_TARGETS, target);
+	if (index < 0 || activeUnit >= (GLuint)UNITS)
+	{
+		frame.issued++;
+		glBindTexture(target, texture);
+	}
+	else if (Changed(textures[activeUnit][index], texture))
+	{
+		glBindTexture(target, texture);
+	}
+}
+
+void GLState::SetEnabled(GLenum capability, bool enable)
+{
+	int index = indexOf(capabilities, CAPABILITIES, capability);
+	if (index >= 0 && enabled[index] == (int)enable)
+	{
+		frame.elided++;
+		return;
+	}
+	if (index >= 0)
+	{
+		enabled[index] = (int)enable;
+	}
+	frame.issued++;
+	if (enable)
+	{
+		glEnable(capability);
+	}
+	else
+	{
+		glDisable(capability);
+	}
+}
+
+void GLState::Enable(GLenum capability)
+{
+	SetEnabled(capability, true);
+}
+
+void GLState::Disable(GLenum capability)
+{
+	SetEnabled(capability, false);
+}
+
+void GLState::DeleteProgram(GLuint deleted)
+{
+	if (program == deleted)
+	{
+		program = UNKNOWN;
+	}
+	glDeleteProgram(deleted);
+}
+
+void GLState::DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays)
+{
+	for (GLsizei i = 0; i < count; i++)
+	{
+		if (vertexArray == vertexArrays[i])
+		{
+			vertexArray = UNKNOWN;
+			buffers[1] = UNKNOWN;
+		}
+	}
+	glDeleteVertexArrays(count, vertexArrays);
+}
+
+void GLState::DeleteBuffers(GLsizei count, const GLuint* deleted)
+{
+	for (GLsizei i = 0; i < count; i++)
+	{
+		for (GLuint& buffer : buffers)
+		{
+			if (buffer == deleted[i])
+			{
+				buffer = UNKNOWN;
+			}
+		}
+	}
+	glDeleteBuffers(count, deleted);
+}
+
+void GLState::DeleteTextures(GLsizei count, const GLuint* deleted)
+{
+	for (GLsizei i = 0; i < count; i++)
+	{
+		for (int unit = 0; unit < UNITS; unit++)
+		{
+			for (int target = 0; target < TEXTURE_TARGETS; target++)
+			{
+				if (textures[unit][target] == deleted[i])
+				{
+					textures[unit][target] = UNKNOWN;
+				}
+			}
+		}
+	}
+	glDeleteTextures(count, deleted);
+}
+
+void GLState::NextFrame()
+{
+	total.issued += frame.issued;
+	total.elided += frame.elided;
+	frame = GLStateCounters();
+	frames++;
+}
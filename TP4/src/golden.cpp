@@ -0,0 +1,225 @@
+#include "golden.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+// Skips the spaces and comments between the fields of a PPM header
+static void skipSeparators(FILE* file)
+{
+	int c = fgetc(file);
+	while (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '#')
+	{
+		if (c == '#')
+		{
+			while (c != '\n' && c != EOF)
+			{
+				c = fgetc(file);
+			}
+		}
+		c = fgetc(file);
+	}
+	ungetc(c, file);
+}
+
+bool readPPM(const std::string& path, RGBImage& image)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	char magic[2] = { 0, 0 };
+	int maxValue = 0;
+	bool valid = fread(magic, 1, 2, file) == 2 && magic[0] == 'P' && magic[1] == '6';
+	if (valid)
+	{
+		skipSeparators(file);
+		valid = fscanf(file, "%d", &image.width) == 1;
+		skipSeparators(file);
+		valid = valid && fscanf(file, "%d", &image.height) == 1;
+		skipSeparators(file);
+		valid = valid && fscanf(file, "%d", &maxValue) == 1 && maxValue == 255;
+		// A single whitespace before the pixels
+		valid = valid && fgetc(file) != EOF && image.width > 0 && image.height > 0;
+	}
+	if (valid)
+	{
+		image.pixels.resize((size_t)image.width * image.height * 3);
+		valid = fread(image.pixels.data(), 1, image.pixels.size(), file) == image.pixels.size();
+	}
+	fclose(file);
+	return valid;
+}
+
+bool writePPM(const std::string& path, const RGBImage& image)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", image.width, image.height);
+	bool written = fwrite(image.pixels.data(), 1, image.pixels.size(), file) == image.pixels.size();
+	fclose(file);
+	return written;
+}
+
+RGBImage downsample(const RGBImage& image, int factor)
+{
+	RGBImage small;
+	small.width = image.width / factor;
+	small.height = image.height / factor;
+	small.pixels.resize((size_t)small.width * small.height * 3);
+	for (int y = 0; y < small.height; y++)
+	{
+		for (int x = 0; x < small.width; x++)
+		{
+			for (int channel = 0; channel < 3; channel++)
+			{
+				int sum = 0;
+				for (int dy = 0; dy < factor; dy++)
+				{
+					for (int dx = 0; dx < factor; dx++)
+					{
+						sum += image.pixels[((size_t)(y * factor + dy) * image.width + x * factor + dx) * 3 + channel];
+					}
+				}
+				small.pixels[((size_t)y * small.width + x) * 3 + channel] = (unsigned char)((sum + factor * factor / 2) / (factor * factor));
+			}
+		}
+	}
+	return small;
+}
+
+OffscreenTarget::OffscreenTarget(int width, int height) : width(width), height(height)
+{
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &ID);
+	glBindFramebuffer(GL_FRAMEBUFFER, ID);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool OffscreenTarget::Complete()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, ID);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void OffscreenTarget::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, ID);
+	glViewport(0, 0, width, height);
+}
+
+RGBImage OffscreenTarget::Read()
+{
+	RGBImage image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize((size_t)width * height * 3);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, ID);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	// RGB rows are not 4 bytes aligned for every width
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, image.pixels.data());
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	// GL puts the bottom row first
+	size_t rowBytes = (size_t)width * 3;
+	for (int y = 0; y < height / 2; y++)
+	{
+		std::swap_ranges(image.pixels.begin() + y * rowBytes, image.pixels.begin() + (y + 1) * rowBytes,
+			image.pixels.begin() + (height - 1 - y) * rowBytes);
+	}
+	return image;
+}
+
+void OffscreenTarget::Delete()
+{
+	glDeleteFramebuffers(1, &ID);
+	glDeleteRenderbuffers(1, &colorBuffer);
+	glDeleteRenderbuffers(1, &depthBuffer);
+}
+
+// Squared YIQ distance of two colors, as in the perceptual metric of Kotsarenko and Ramos (35215 at most)
+static double colorDistance(const unsigned char* a, const unsigned char* b)
+{
+	double dr = (double)a[0] - b[0];
+	double dg = (double)a[1] - b[1];
+	double db = (double)a[2] - b[2];
+	double y = dr * 0.29889531 + dg * 0.58662247 + db * 0.11448223;
+	double i = dr * 0.59597799 - dg * 0.27417610 - db * 0.32180189;
+	double q = dr * 0.21147017 - dg * 0.52261711 + db * 0.31114694;
+	return 0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q;
+}
+
+ImageDifference compareImages(const RGBImage& a, const RGBImage& b, double threshold)
+{
+	const double maxDistance = 35215.0;
+	ImageDifference difference;
+	size_t pixels = (size_t)a.width * a.height;
+	for (size_t pixel = 0; pixel < pixels; pixel++)
+	{
+		double distance = colorDistance(&a.pixels[pixel * 3], &b.pixels[pixel * 3]) / maxDistance;
+		if (distance > threshold * threshold)
+		{
+			difference.differentPixels++;
+		}
+		difference.maxDistance = std::max(difference.maxDistance, std::sqrt(distance));
+	}
+	return difference;
+}
+
+bool checkGolden(const RGBImage& image, const std::string& reference, bool update, double threshold, double maxDifferent)
+{
+	if (update)
+	{
+		bool written = writePPM(reference, image);
+		std::cout << (written ? "golden image written to " : "failed writing ") << reference << std::endl;
+		return written;
+	}
+
+	RGBImage expected;
+	if (!readPPM(reference, expected))
+	{
+		std::cout << "golden image " << reference << " missing or unreadable (--golden-update writes it)" << std::endl;
+		return false;
+	}
+	if (expected.width != image.width || expected.height != image.height)
+	{
+		std::cout << "golden image " << reference << " is " << expected.width << "x" << expected.height
+			<< ", the render " << image.width << "x" << image.height << std::endl;
+		return false;
+	}
+
+	ImageDifference difference = compareImages(image, expected, threshold);
+	double fraction = (double)difference.differentPixels / ((double)image.width * image.height);
+	bool passed = fraction <= maxDifferent;
+	std::cout << "golden image " << reference << (passed ? ": passed, " : ": FAILED, ") << difference.differentPixels
+		<< " pixels differ (" << fraction * 100.0 << "%, " << maxDifferent * 100.0 << "% allowed), largest difference "
+		<< difference.maxDistance << std::endl;
+	if (!passed)
+	{
+		std::string actual = reference + ".actual.ppm";
+		if (writePPM(actual, image))
+		{
+			std::cout << "render written to " << actual << std::endl;
+		}
+	}
+	return passed;
+}
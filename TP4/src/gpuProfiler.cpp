@@ -0,0 +1,204 @@
+#include "gpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+GPUProfiler::GPUProfiler(int frameLatency)
+{
+	ring.resize(std::max(1, frameLatency));
+}
+
+bool GPUProfiler::Enable()
+{
+	// A driver may accept the queries without a counter behind them
+	GLint bits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+	enabled = bits > 0;
+	if (!enabled)
+	{
+		std::cout << "no GPU timestamp counter, GPU profiling disabled" << std::endl;
+	}
+	return enabled;
+}
+
+GLuint GPUProfiler::NextQuery(Frame& frame)
+{
+	if (frame.usedQueries == frame.queries.size())
+	{
+		GLuint query;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+	}
+	return frame.queries[frame.usedQueries++];
+}
+
+void GPUProfiler::Collect(Frame& frame)
+{
+	if (frame.scopes.empty())
+	{
+		return;
+	}
+
+	// The end of the frame scope is the last query written
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(frame.scopes[0].end, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		stalls++;
+	}
+
+	std::vector<std::string> paths(frame.scopes.size());
+	for (size_t i = 0; i < frame.scopes.size(); i++)
+	{
+		const Scope& scope = frame.scopes[i];
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(scope.start, GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(scope.end, GL_QUERY_RESULT, &end);
+		double ms = end > start ? (end - start) / 1e6 : 0.0;
+
+		// Parents are always recorded before their children
+		paths[i] = scope.parent >= 0 ? paths[scope.parent] + "/" + scope.name : scope.name;
+		auto found = scopeIndex.find(paths[i]);
+		if (found == scopeIndex.end())
+		{
+			GPUScopeStats stats;
+			stats.path = paths[i];
+			stats.depth = (int)std::count(paths[i].begin(), paths[i].end(), '/');
+			stats.minMs = ms;
+			stats.maxMs = ms;
+			found = scopeIndex.emplace(paths[i], scopes.size()).first;
+			scopes.push_back(stats);
+		}
+		GPUScopeStats& stats = scopes[found->second];
+		stats.calls++;
+		stats.totalMs += ms;
+		stats.minMs = std::min(stats.minMs, ms);
+		stats.maxMs = std::max(stats.maxMs, ms);
+	}
+	frames++;
+	frame.scopes.clear();
+	frame.usedQueries = 0;
+}
+
+void GPUProfiler::BeginFrame()
+{
+	if (!enabled)
+	{
+		return;
+	}
+	current = (current + 1) % ring.size();
+	Collect(ring[current]);
+	stack.clear();
+	Push("frame");
+}
+
+void GPUProfiler::EndFrame()
+{
+	if (!enabled)
+	{
+		return;
+	}
+	Pop();
+}
+
+void GPUProfiler::Push(const char* name)
+{
+	if (!enabled)
+	{
+		return;
+	}
+	Frame& frame = ring[current];
+	Scope scope;
+	scope.name = name;
+	scope.parent = stack.empty() ? -1 : stack.back();
+	scope.start = NextQuery(frame);
+	scope.end = NextQuery(frame);
+	glQueryCounter(scope.start, GL_TIMESTAMP);
+	stack.push_back((int)frame.scopes.size());
+	frame.scopes.push_back(scope);
+}
+
+void GPUProfiler::Pop()
+{
+	if (!enabled || stack.empty())
+	{
+		return;
+	}
+	glQueryCounter(ring[current].scopes[stack.back()].end, GL_TIMESTAMP);
+	stack.pop_back();
+}
+
+void GPUProfiler::Finish()
+{
+	if (!enabled)
+	{
+		return;
+	}
+	// Oldest first, the frame being recorded included if it was closed
+	for (size_t i = 1; i <= ring.size(); i++)
+	{
+		Collect(ring[(current + i) % ring.size()]);
+	}
+}
+
+bool GPUProfiler::Write(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "failed writing " << path << std::endl;
+		return false;
+	}
+	long long perFrame = std::max(1LL, frames);
+	bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+	if (json)
+	{
+		file << "{\n\t\"frames\": " << frames << ",\n\t\"stalls\": " << stalls << ",\n\t\"scopes\": [";
+		for (size_t i = 0; i < scopes.size(); i++)
+		{
+			const GPUScopeStats& scope = scopes[i];
+			// Scope names are plain identifiers, nothing to escape
+			file << (i > 0 ? ",\n" : "\n") << "\t\t{ \"scope\": \"" << scope.path << "\", \"depth\": " << scope.depth
+				<< ", \"calls\": " << scope.calls << ", \"ms_per_frame\": " << scope.totalMs / perFrame
+				<< ", \"avg_ms\": " << scope.totalMs / scope.calls << ", \"min_ms\": " << scope.minMs << ", \"max_ms\": " << scope.maxMs << " }";
+		}
+		file << "\n\t]\n}\n";
+	}
+	else
+	{
+		file << "scope,depth,calls,ms_per_frame,avg_ms,min_ms,max_ms\n";
+		for (const GPUScopeStats& scope : scopes)
+		{
+			file << scope.path << "," << scope.depth << "," << scope.calls << "," << scope.totalMs / perFrame << ","
+				<< scope.totalMs / scope.calls << "," << scope.minMs << "," << scope.maxMs << "\n";
+		}
+	}
+	return true;
+}
+
+void GPUProfiler::Print() const
+{
+	long long perFrame = std::max(1LL, frames);
+	std::cout << "GPU time per frame over " << frames << " frames (" << stalls << " waits for results):" << std::endl;
+	for (const GPUScopeStats& scope : scopes)
+	{
+		size_t nameStart = scope.path.rfind('/');
+		std::cout << std::string(2 * (scope.depth + 1), ' ') << scope.path.substr(nameStart == std::string::npos ? 0 : nameStart + 1)
+			<< " " << scope.totalMs / perFrame << " ms" << std::endl;
+	}
+}
+
+void GPUProfiler::Delete()
+{
+	for (Frame& frame : ring)
+	{
+		if (!frame.queries.empty())
+		{
+			glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+		}
+		frame.queries.clear();
+		frame.scopes.clear();
+		frame.usedQueries = 0;
+	}
+}
@@ -0,0 +1,232 @@
+#include "jobSystem.h"
+
+#include <algorithm>
+
+// System and queue of the worker running on this thread, if any
+static thread_local const JobSystem* currentSystem = nullptr;
+static thread_local int currentWorker = -1;
+
+JobSystem::JobSystem(unsigned int numWorkers)
+{
+	if (numWorkers == 0)
+	{
+		// Leaves one hardware thread to the GL thread
+		unsigned int hardware = std::thread::hardware_concurrency();
+		numWorkers = hardware > 1 ? hardware - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i <= numWorkers; i++)
+	{
+		queues.push_back(std::unique_ptr<Queue>(new Queue()));
+	}
+	for (unsigned int i = 0; i < numWorkers; i++)
+	{
+		workers.emplace_back(&JobSystem::WorkerLoop, this, (int)i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	stopping = true;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wakeUp.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+int JobSystem::CurrentWorker() const
+{
+	return currentSystem == this ? currentWorker : -1;
+}
+
+void JobSystem::Push(Job job)
+{
+	int worker = CurrentWorker();
+	Queue& queue = *queues[worker >= 0 ? worker : workers.size()];
+	// Counted first so a worker woken up for it never sees one job less than there is
+	queued++;
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	{
+		// Sleeping workers check queued under this lock, taking it keeps the notification from slipping in between
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wakeUp.notify_one();
+}
+
+bool JobSystem::Take(int worker, Job& job)
+{
+	// Its own jobs first, newest first
+	if (worker >= 0)
+	{
+		Queue& own = *queues[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			queued--;
+			return true;
+		}
+	}
+
+	// Then the jobs of the outside threads, then the oldest job of another worker, starting with the next one
+	size_t count = queues.size();
+	size_t start = worker >= 0 ? worker + 1 : workers.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t index = (start + i) % count;
+		if ((int)index == worker)
+		{
+			continue;
+		}
+		Queue& other = *queues[index];
+		std::lock_guard<std::mutex> lock(other.mutex);
+		for (auto found = other.jobs.begin(); found != other.jobs.end(); ++found)
+		{
+			// An outside thread only helps with jobs of a group it could be waiting on, never with a background
+			// task (a texture decode) that could hold the GL thread for frames
+			if (worker < 0 && found->counter == nullptr)
+			{
+				continue;
+			}
+			job = std::move(*found);
+			other.jobs.erase(found);
+			queued--;
+			if (index != workers.size())
+			{
+				steals++;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+bool JobSystem::RunOne(int worker)
+{
+	Job job;
+	if (!Take(worker, job))
+	{
+		return false;
+	}
+	job.work();
+	executed++;
+	Finish(job.counter);
+	return true;
+}
+
+void JobSystem::Finish(JobCounter* counter)
+{
+	if (counter == nullptr)
+	{
+		return;
+	}
+	counter->finishing++;
+	if (counter->pending.fetch_sub(1) == 1)
+	{
+		std::vector<std::pair<std::function<void()>, JobCounter*>> ready;
+		{
+			std::lock_guard<std::mutex> lock(counter->mutex);
+			ready.swap(counter->dependents);
+		}
+		// Their counters were incremented by RunAfter already
+		for (auto& dependent : ready)
+		{
+			Push(Job{ std::move(dependent.first), dependent.second });
+		}
+	}
+	counter->finishing--;
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter* counter)
+{
+	if (counter != nullptr)
+	{
+		counter->pending++;
+	}
+	Push(Job{ std::move(job), counter });
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter)
+{
+	// The job belongs to its group from now on, waiting on the group waits for the dependency too
+	if (counter != nullptr)
+	{
+		counter->pending++;
+	}
+	{
+		std::lock_guard<std::mutex> lock(dependency.mutex);
+		if (dependency.pending.load() != 0)
+		{
+			dependency.dependents.emplace_back(std::move(job), counter);
+			return;
+		}
+	}
+	Push(Job{ std::move(job), counter });
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	int worker = CurrentWorker();
+	while (!counter.Done())
+	{
+		// The jobs left may be running on other threads, there is nothing to help with then
+		if (!RunOne(worker))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::ParallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body)
+{
+	grain = std::max(1, grain);
+	if (end - begin <= grain)
+	{
+		if (end > begin)
+		{
+			body(begin, end);
+		}
+		return;
+	}
+
+	JobCounter counter;
+	int first = begin;
+	for (; end - first > grain; first += grain)
+	{
+		int last = first + grain;
+		Run([&body, first, last]() { body(first, last); }, &counter);
+	}
+	// The last range on this thread, it would only wait otherwise
+	body(first, end);
+	Wait(counter);
+}
+
+void JobSystem::WorkerLoop(int worker)
+{
+	currentSystem = this;
+	currentWorker = worker;
+	while (true)
+	{
+		if (RunOne(worker))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeUp.wait(lock, [this]() { return stopping || queued.load() > 0; });
+		// Drains the queues before stopping so no future is left without a value
+		if (stopping && queued.load() <= 0)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,109 @@
+#include "lights.h"
+#include "glState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+
+static_assert(sizeof(Light) == 48, "Light has to match the std140 layout of the shaders");
+
+LightBuffer::LightBuffer(GLuint bindingPoint) : bindingPoint(bindingPoint)
+{
+	glGenBuffers(1, &ID);
+	GLState::Current().BindBuffer(GL_UNIFORM_BUFFER, ID);
+	glBufferData(GL_UNIFORM_BUFFER, MAX_LIGHTS * sizeof(Light), NULL, GL_DYNAMIC_DRAW);
+	GLState::Current().BindBuffer(GL_UNIFORM_BUFFER, 0);
+	GLState::Current().BindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ID);
+}
+
+void LightBuffer::Upload(const std::vector<Light>& lights)
+{
+	size_t count = std::min(lights.size(), (size_t)MAX_LIGHTS);
+	GLState::Current().BindBuffer(GL_UNIFORM_BUFFER, ID);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(Light), lights.data());
+	GLState::Current().BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void LightBuffer::Link(Shader& shader)
+{
+	GLuint block = glGetUniformBlockIndex(shader.ID, "Lights");
+	if (block != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(shader.ID, block, bindingPoint);
+	}
+}
+
+void LightBuffer::Delete()
+{
+	GLState::Current().DeleteBuffers(1, &ID);
+}
+
+bool lightTouchesSphere(const Light& light, glm::vec3 center, float radius)
+{
+	glm::vec3 toCenter = center - light.position;
+	float distanceSquared = glm::dot(toCenter, toCenter);
+	float reach = light.radius + radius;
+	if (distanceSquared > reach * reach)
+	{
+		return false;
+	}
+	if (light.cosCutoff <= -1.0f)
+	{
+		return true;
+	}
+
+	// Sphere against cone: distance from the center to the closest line of the cone
+	float along = glm::dot(toCenter, light.direction);
+	float sinCutoff = std::sqrt(std::max(0.0f, 1.0f - light.cosCutoff * light.cosCutoff));
+	float across = std::sqrt(std::max(0.0f, distanceSquared - along * along));
+	float distanceToCone = light.cosCutoff * across - along * sinCutoff;
+	return distanceToCone <= radius && along >= -radius;
+}
+
+int cullLights(const std::vector<Light>& lights, const std::vector<int>& candidates, glm::vec3 center, float radius, int* indices, int maxLights)
+{
+	// (distance / radius of the light, index), the lower the more the light counts
+	std::pair<float, int> touching[MAX_LIGHTS];
+	int count = 0;
+	for (int index : candidates)
+	{
+		const Light& light = lights[index];
+		if (count < MAX_LIGHTS && lightTouchesSphere(light, center, radius))
+		{
+			touching[count++] = std::make_pair(glm::length(center - light.position) / light.radius, index);
+		}
+	}
+
+	if (count > maxLights)
+	{
+		std::partial_sort(touching, touching + maxLights, touching + count);
+		count = maxLights;
+	}
+	for (int i = 0; i < count; i++)
+	{
+		indices[i] = touching[i].second;
+	}
+	return count;
+}
+
+std::vector<Light> randomLights(int count, glm::vec3 boxMin, glm::vec3 boxMax, float minRadius, float maxRadius, unsigned int seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<Light> lights(count);
+	for (Light& light : lights)
+	{
+		light.position = boxMin + (boxMax - boxMin) * glm::vec3(unit(random), unit(random), unit(random));
+		light.radius = minRadius + (maxRadius - minRadius) * unit(random);
+		// Saturated colors, one channel kept low
+		light.color = glm::vec3(unit(random), unit(random), unit(random));
+		light.color[random() % 3] *= 0.2f;
+		light.color /= std::max(light.color.r, std::max(light.color.g, light.color.b));
+		light.intensity = 1.0f;
+		light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+		light.cosCutoff = (random() % 4 == 0) ? std::cos(glm::radians(30.0f)) : -1.0f;
+	}
+	return lights;
+}
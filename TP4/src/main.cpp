@@ -1,7 +1,12 @@
 #include <iostream>
-#include <GL/glew.h>
+#include "glTrace.h"
 #include <GLFW/glfw3.h>
 #include <math.h>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -11,8 +16,25 @@
 #include "VAO.h"
 #include "VBO.h"
 #include "EBO.h"
+#include "FBO.h"
 #include "camera.h"
 #include "texture.h"
+#include "textureLoader.h"
+#include "textureArray.h"
+#include "textureCache.h"
+#include "clock.h"
+#include "benchmark.h"
+#include "lights.h"
+#include "scene.h"
+#include "clusters.h"
+#include "gBuffer.h"
+#include "shadows.h"
+#include "glState.h"
+#include "gpuProfiler.h"
+#include "cpuProfiler.h"
+#include "golden.h"
+#include "frameCapture.h"
+#include "jobSystem.h"
 
 /// constants for the camera
 const float FOV = 45.0f;
@@ -27,20 +49,26 @@ const float radius = 1.0f;
 const float lightFaces = 32.0f;
 const float lightRadius = 0.25f;
 
+// Frame compared with the golden image, late enough for the simulation to have moved
+const int GOLDEN_FRAMES = 30;
+// Spheres or lights culled per job, fewer are tested on the GL thread alone
+const int CULLING_GRAIN = 1024;
+
 // use left mouse button to interact with the camera
 // use z, q, d, d to move the camera
 // use left control to move down
 // use space to move up
 
-// Vertices coordinates
-GLfloat vertices[32 * 32 * 11]; 
-GLfloat lightVertices[32 * 32 * 11]; 
+// Vertices coordinates, (faces + 1) * (faces + 1) vertices of 11 floats
+GLfloat vertices[33 * 33 * 11];
+GLfloat lightVertices[33 * 33 * 11];
 
 // Indices for vertices order
 GLuint indices[32 * 32 * 6]; 
 GLuint lightIndices[32 * 32 * 6];
 
 void generateSphere(float radius, int faces, GLfloat* vertices, GLuint* indices) {
+    PROFILE_ZONE("generateSphere");
     int vertexIndex = 0;
     int indexIndex = 0;
 
@@ -93,13 +121,41 @@ void generateSphere(float radius, int faces, GLfloat* vertices, GLuint* indices)
     }
 }
 
-int main(){
+// Returns the position of option in the command line, 0 if it isn't there
+int findOption(int argc, char* argv[], const char* option)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == option)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]){
+    // --cpu-trace file.json records the CPU zones of every thread from here on, to open in chrome://tracing
+    int cpuTraceOption = findOption(argc, argv, "--cpu-trace");
+    if (cpuTraceOption != 0 && cpuTraceOption + 1 < argc)
+    {
+        startCPUProfile();
+    }
+
+    // --golden reference.ppm renders the default scene offscreen, without the texture files and with the placeholder,
+    // and compares frame GOLDEN_FRAMES with the reference (--golden-update rewrites it). The exit code is 1 if they differ
+    int goldenOption = findOption(argc, argv, "--golden");
+    bool golden = goldenOption != 0 && goldenOption + 1 < argc;
 
     glfwInit();
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR,3);
     glfwWindowHint(GLFW_OPENGL_PROFILE,GLFW_OPENGL_CORE_PROFILE);
+    if (golden)
+    {
+        glfwWindowHint(GLFW_VISIBLE,GLFW_FALSE);
+    }
 
     
 
@@ -117,13 +173,100 @@ int main(){
 
     glViewport(0,0,width,height);
 
-    // Generate sphere vertices and indices
-    generateSphere(radius, faces, vertices, indices);
-	generateSphere(lightRadius, lightFaces, lightVertices, lightIndices);
-	
+    // --bench-textures [count] [image] [container] compares synchronous, asynchronous and precompiled texture loading
+    if (argc > 1 && std::string(argv[1]) == "--bench-textures")
+    {
+        int count = argc > 2 ? std::atoi(argv[2]) : 128;
+        const char* image = argc > 3 ? argv[3] : "./textures/texture1.png";
+        const char* container = argc > 4 ? argv[4] : nullptr;
+        benchmarkTextureLoading(image, count, container);
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
+    // --bench-clusters times the light binning of the clustered path from 1 to 10k lights
+    if (argc > 1 && std::string(argv[1]) == "--bench-clusters")
+    {
+        benchmarkClusteredLights();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
+    // --bench-jobs times the job system from 1 to N workers, --stress-jobs [rounds] checks its results under load
+    if (argc > 1 && std::string(argv[1]) == "--bench-jobs")
+    {
+        benchmarkJobSystem();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--stress-jobs")
+    {
+        bool passed = stressJobSystem(argc > 2 ? std::atoi(argv[2]) : 100);
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return passed ? 0 : 1;
+    }
+
+    // --atlas [images...] packs the sphere texture (or the given images) in a texture array
+    std::vector<const char*> atlasImages;
+    int atlasOption = findOption(argc, argv, "--atlas");
+    bool useAtlas = atlasOption != 0;
+    if (useAtlas)
+    {
+        // The image list ends at the next option
+        for (int i = atlasOption + 1; i < argc && std::string(argv[i]).rfind("--", 0) != 0; i++)
+        {
+            atlasImages.push_back(argv[i]);
+        }
+    }
+    if (useAtlas && atlasImages.empty())
+    {
+        atlasImages.push_back("./textures/texture1.png");
+    }
+
+    // --spheres N draws a grid of N x N spheres, --lights N adds N random lights over it,
+    // --clustered bins them in a grid of clusters instead of giving each sphere its list (for thousands of lights)
+    int spheresOption = findOption(argc, argv, "--spheres");
+    int lightsOption = findOption(argc, argv, "--lights");
+    bool clustered = findOption(argc, argv, "--clustered") != 0;
+    int spheresPerSide = (spheresOption != 0 && spheresOption + 1 < argc) ? std::max(1, std::atoi(argv[spheresOption + 1])) : 1;
+    int randomLightCount = (lightsOption != 0 && lightsOption + 1 < argc) ? std::max(0, std::atoi(argv[lightsOption + 1])) : 0;
+    // --shadows gives the main light a cube shadow map, --sun adds a directional light with cascaded shadow maps,
+    // --pcf 0|1|2 filters them with one tap, the hardware 2x2 or a kernel, --orbit-light moves the main light around
+    bool shadows = findOption(argc, argv, "--shadows") != 0;
+    bool sun = findOption(argc, argv, "--sun") != 0;
+    bool orbitLight = findOption(argc, argv, "--orbit-light") != 0;
+    int pcfOption = findOption(argc, argv, "--pcf");
+    ShadowPCF pcf = (pcfOption != 0 && pcfOption + 1 < argc) ? (ShadowPCF)std::min(2, std::max(0, std::atoi(argv[pcfOption + 1]))) : ShadowPCF::Hardware;
+    std::string shadowDefines = std::string(shadows ? "#define SHADOWS\n" : "") + (sun ? "#define SUN\n" : "");
+    int maxLights = clustered ? MAX_CLUSTERED_LIGHTS : MAX_LIGHTS;
+    if (randomLightCount + 1 > maxLights)
+    {
+        std::cout << "at most " << maxLights - 1 << " extra lights" << std::endl;
+        randomLightCount = maxLights - 1;
+    }
+
+	// Workers for everything that can leave the GL thread: meshes, culling, light binning, texture decoding
+	JobSystem jobs;
+
+    // Generate sphere vertices and indices, both meshes at once
+	JobCounter meshes;
+	jobs.Run([&]() { generateSphere(radius, faces, vertices, indices); }, &meshes);
+	jobs.Run([&]() { generateSphere(lightRadius, lightFaces, lightVertices, lightIndices); }, &meshes);
+	jobs.Wait(meshes);
+
+	// Points the sphere texture coordinates to its region of the atlas, before they are uploaded
+	TextureArray* atlas = nullptr;
+	if (useAtlas)
+	{
+		atlas = new TextureArray(atlasImages, 1024, GL_TEXTURE0, &jobs);
+		remapUVs(vertices, (faces + 1) * (faces + 1), 11, 6, atlas->regions[0]);
+	}
 
-    // Generates Shader object using shaders default.vert and default.frag
-	Shader shaderProgram("./shaders/default.vert.txt", "./shaders/default.frag.txt");
+    // Generates Shader object using shaders default.vert and default.frag (sampling the atlas with TEXTURE_ARRAY)
+	std::string defines = std::string(useAtlas ? "#define TEXTURE_ARRAY\n" : "") + (clustered ? "#define CLUSTERED\n" : "") + shadowDefines;
+	Shader shaderProgram("./shaders/default.vert.txt", "./shaders/default.frag.txt", defines.c_str());
 	// Generates Vertex Array Object and binds it
 	VAO VAO1;
 	VAO1.Bind();
@@ -142,6 +285,28 @@ int main(){
 	EBO1.Unbind();
 
 
+	// Positions only, for the depth pre-pass: a fraction of the vertex data to fetch, same indices
+	static GLfloat positions[33 * 33 * 3];
+	for (int i = 0; i < (faces + 1) * (faces + 1); i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			positions[3 * i + j] = vertices[11 * i + j];
+		}
+	}
+	VAO positionVAO;
+	positionVAO.Bind();
+	VBO positionVBO(positions, sizeof(positions));
+	EBO1.Bind();
+	positionVAO.LinkAttrib(positionVBO, 0, 3, GL_FLOAT, 3 * sizeof(float), (void*)0);
+	positionVAO.Unbind();
+	positionVBO.Unbind();
+	EBO1.Unbind();
+	// Depth only, the same shader as the cascades of the shadows
+	Shader depthShader("./shaders/shadow.vert.txt", "./shaders/shadow.frag.txt");
+	GLint depthMatrixLocation = glGetUniformLocation(depthShader.ID, "lightMatrix");
+	GLint depthModelLocation = glGetUniformLocation(depthShader.ID, "model");
+
 	// Shader for light cube
 	Shader lightShader("./shaders/light.vert.txt", "./shaders/light.frag.txt");
 	// Generates Vertex Array Object and binds it
@@ -162,94 +327,837 @@ int main(){
 	VBO2.Unbind();
 	EBO2.Unbind();
 
+	// Deferred path: the spheres and the lights go in a G-buffer, then the ambient term and each light
+	// are added up on the screen, a light only over the pixels its sphere covers
+	std::string gBufferDefines = std::string(useAtlas ? "#define TEXTURE_ARRAY\n" : "") + "#define GBUFFER\n";
+	Shader gBufferShader("./shaders/default.vert.txt", "./shaders/default.frag.txt", gBufferDefines.c_str());
+	Shader lightGBufferShader("./shaders/light.vert.txt", "./shaders/light.frag.txt", "#define GBUFFER\n");
+	std::string ambientDefines = std::string("#define DEFERRED\n#define AMBIENT\n") + (sun ? "#define SUN\n" : "");
+	Shader ambientShader("./shaders/fullscreen.vert.txt", "./shaders/default.frag.txt", ambientDefines.c_str());
+	std::string volumeDefines = std::string("#define DEFERRED\n") + (shadows ? "#define SHADOWS\n" : "");
+	Shader lightVolumeShader("./shaders/default.vert.txt", "./shaders/default.frag.txt", volumeDefines.c_str());
+	// Holds no attribute, the fullscreen triangle comes from the vertex index
+	VAO emptyVAO;
+
+
 
+	// The spheres of the scene
+	std::vector<SceneObject> objects = sphereGrid(spheresPerSide, 3.0f, radius);
 
-	glm::vec4 lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-	glm::vec3 lightPos = glm::vec3(1.5f, 1.5f, 3.0f);
-	glm::mat4 lightModel = glm::mat4(1.0f);
-	lightModel = glm::translate(lightModel, lightPos);
+	// The white light reaching the whole scene, then the random ones spread over the spheres
+	Light mainLight;
+	mainLight.position = glm::vec3(1.5f, 1.5f, 3.0f);
+	mainLight.radius = 100.0f;
+	mainLight.color = glm::vec3(1.0f, 1.0f, 1.0f);
+	mainLight.intensity = 1.0f;
+	mainLight.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	mainLight.cosCutoff = -1.0f;
+	std::vector<Light> lights = { mainLight };
+	float gridHalfWidth = (spheresPerSide - 1) * 1.5f + 2.0f;
+	std::vector<Light> randomOnes = randomLights(randomLightCount, glm::vec3(-gridHalfWidth, -1.0f, -(spheresPerSide - 1) * 3.0f - 2.0f),
+		glm::vec3(gridHalfWidth, 2.5f, 2.0f), 1.5f, 4.0f);
+	lights.insert(lights.end(), randomOnes.begin(), randomOnes.end());
 
-	glm::vec3 pos = glm::vec3(0.0f, 0.0f, 0.0f);
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, pos);
+	// Every light goes in a uniform buffer once, each draw only gets the indices of the ones touching it
+	LightBuffer lightBuffer;
+	lightBuffer.Upload(lights);
+	lightBuffer.Link(shaderProgram);
 
+	GLint modelLocation = glGetUniformLocation(shaderProgram.ID, "model");
+	GLint lightCountLocation = glGetUniformLocation(shaderProgram.ID, "lightCount");
+	GLint lightIndicesLocation = glGetUniformLocation(shaderProgram.ID, "lightIndices");
+	GLint lightModelLocation = glGetUniformLocation(lightShader.ID, "model");
+	GLint lightColorLocation = glGetUniformLocation(lightShader.ID, "lightColor");
+	GLint gBufferModelLocation = glGetUniformLocation(gBufferShader.ID, "model");
+	GLint lightGBufferModelLocation = glGetUniformLocation(lightGBufferShader.ID, "model");
+	GLint lightGBufferColorLocation = glGetUniformLocation(lightGBufferShader.ID, "lightColor");
+	GLint volumeModelLocation = glGetUniformLocation(lightVolumeShader.ID, "model");
+	GLint volumeLightIndexLocation = glGetUniformLocation(lightVolumeShader.ID, "lightIndex");
+	GLint volumeLightLocations[3] = {
+		glGetUniformLocation(lightVolumeShader.ID, "light.positionRadius"),
+		glGetUniformLocation(lightVolumeShader.ID, "light.colorIntensity"),
+		glGetUniformLocation(lightVolumeShader.ID, "light.directionCutoff") };
 
-	lightShader.Activate();
-	glUniformMatrix4fv(glGetUniformLocation(lightShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(lightModel));
-	glUniform4f(glGetUniformLocation(lightShader.ID, "lightColor"), lightColor.x, lightColor.y, lightColor.z, lightColor.w);
-	shaderProgram.Activate();
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgram.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
-	glUniform4f(glGetUniformLocation(shaderProgram.ID, "lightColor"), lightColor.x, lightColor.y, lightColor.z, lightColor.w);
-	glUniform3f(glGetUniformLocation(shaderProgram.ID, "lightPos"), lightPos.x, lightPos.y, lightPos.z);
+	// Clustered path: lights binned on the workers each frame, handed to the shader in buffer textures.
+	// The grid stops at the far plane even when reverse-Z removes it from the projection
+	ClusterGrid clusterGrid(nearPlane, farPlane, &jobs);
+	ClusterBuffers* clusterBuffers = clustered ? new ClusterBuffers() : nullptr;
+	double binningMs = 0.0;
 
-    // Texture
-	Texture sphereTex("./textures/texture1.png", GL_TEXTURE_2D, GL_TEXTURE0, GL_RGB, GL_UNSIGNED_BYTE);
+	// Lights in the view this frame and what the objects got, for the statistics printed at the end
+	std::vector<int> visibleLights;
+	long long drawnObjects = 0;
+	long long assignedLights = 0;
+	long long frames = 0;
+	SystemClock frameClock;
+
+    // Texture, decoded in the background while a placeholder is bound
+	TextureLoader textureLoader(jobs);
+	// Prefers the container precompiled by texconv, which needs no decoding
+	std::ifstream precompiled("./textures/texture1.gtex");
+	Texture sphereTex = golden ? Texture(GL_TEXTURE_2D, GL_TEXTURE0)
+		: precompiled.good() ? Texture("./textures/texture1.gtex", GL_TEXTURE_2D, GL_TEXTURE0)
+		: textureLoader.Load("./textures/texture1.png", GL_TEXTURE_2D, GL_TEXTURE0, GL_RGB, GL_UNSIGNED_BYTE);
 	sphereTex.texUnit(shaderProgram, "tex0", 0);
+	sphereTex.texUnit(gBufferShader, "tex0", 0);
+
+	// --texture-budget <MB> binds the sphere texture through a cache limited to that much video memory
+	TextureCache* textureCache = nullptr;
+	int sphereHandle = -1;
+	int budgetOption = findOption(argc, argv, "--texture-budget");
+	if (budgetOption != 0 && budgetOption + 1 < argc)
+	{
+		textureCache = new TextureCache((size_t)(std::atof(argv[budgetOption + 1]) * 1024 * 1024));
+		sphereHandle = textureCache->Add(precompiled.good() ? "./textures/texture1.gtex" : "./textures/texture1.png", GL_TEXTURE_2D, GL_RGB);
+	}
+	if (atlas != nullptr)
+	{
+		// Layer of the sphere material, the only per-object state left with an atlas
+		atlas->texUnit(shaderProgram, "tex0", 0);
+		glUniform1i(glGetUniformLocation(shaderProgram.ID, "layer"), atlas->regions[0].layer);
+		atlas->texUnit(gBufferShader, "tex0", 0);
+		glUniform1i(glGetUniformLocation(gBufferShader.ID, "layer"), atlas->regions[0].layer);
+	}
 
 	// Enables the Depth Buffer
-	glEnable(GL_DEPTH_TEST);
+	GLState::Current().Enable(GL_DEPTH_TEST);
 
 	// Creates camera object
 	Camera camera(width, height, glm::vec3(0.0f, 0.0f, 5.0f), FOV, nearPlane, farPlane);
 
+	// --reverse-z renders into a 32-bit float depth buffer with depth 1 at the near plane and 0 at infinity,
+	// which keeps the precision spread evenly over any view distance
+	FBO* reverseZTarget = nullptr;
+	if (findOption(argc, argv, "--reverse-z") != 0)
+	{
+		if (GLEW_VERSION_4_5 || GLEW_ARB_clip_control)
+		{
+			reverseZTarget = new FBO(width, height, GL_DEPTH_COMPONENT32F);
+			if (!reverseZTarget->Complete())
+			{
+				std::cout << "float depth buffer not supported, reverse-Z disabled" << std::endl;
+				reverseZTarget->Delete();
+				delete reverseZTarget;
+				reverseZTarget = nullptr;
+			}
+		}
+		else
+		{
+			std::cout << "glClipControl not supported, reverse-Z disabled" << std::endl;
+		}
+	}
+	if (reverseZTarget != nullptr)
+	{
+		// Keeps the [0, 1] depth range as is instead of remapping [-1, 1] to it, which would lose the precision near 0
+		glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+		glDepthFunc(GL_GREATER);
+		glClearDepth(0.0);
+		camera.reverseZ = true;
+	}
+
+	// --depth-prepass lays the depth of the spheres down first, so the shading pass (GL_EQUAL) runs once per pixel.
+	// The spheres are drawn front to back unless --no-sort is given. --overdraw counts the shaded fragments
+	// per covered pixel (it reads the depth back every frame, for debugging only)
+	bool prePass = findOption(argc, argv, "--depth-prepass") != 0;
+	bool sortFrontToBack = findOption(argc, argv, "--no-sort") == 0;
+	bool countOverdraw = findOption(argc, argv, "--overdraw") != 0;
+	// --gl-stats prints how many binds and enables reached the driver and how many the state cache dropped
+	bool glStats = findOption(argc, argv, "--gl-stats") != 0;
+	// --gl-trace file.csv writes the GL calls, draws and uploads of each frame to a file (built with -DGL_TRACE=ON)
+	int traceOption = findOption(argc, argv, "--gl-trace");
+	if (traceOption != 0 && traceOption + 1 < argc && !startGLTrace(argv[traceOption + 1]))
+	{
+		std::cout << "no GL trace written to " << argv[traceOption + 1] << " (needs a GL_TRACE build)" << std::endl;
+	}
+	// --gpu-profile file.csv (or .json) times the passes on the GPU and writes the time of each at exit
+	int gpuProfileOption = findOption(argc, argv, "--gpu-profile");
+	GPUProfiler gpuProfiler;
+	if (gpuProfileOption != 0 && gpuProfileOption + 1 < argc)
+	{
+		gpuProfiler.Enable();
+	}
+	// --capture frames/frame%04d.png (.ppm, .raw) writes every frame to a file from a writer thread,
+	// read back a few frames late so the GPU is never waited for; frames are dropped rather than stall
+	int captureOption = findOption(argc, argv, "--capture");
+	FrameCapture* capture = nullptr;
+	if (captureOption != 0 && captureOption + 1 < argc)
+	{
+		if (validCapturePattern(argv[captureOption + 1]))
+		{
+			capture = new FrameCapture(argv[captureOption + 1], width, height);
+		}
+		else
+		{
+			std::cout << "capture pattern " << argv[captureOption + 1] << " must hold one integer conversion for the frame number"
+				<< " (frame%04d.png) and no other % than %%, no capture" << std::endl;
+		}
+	}
+	GLenum depthFunc = reverseZTarget != nullptr ? GL_GREATER : GL_LESS;
+	std::vector<std::pair<float, int>> drawOrder;
+	// Culling results of each sphere and light, written by the workers
+	std::vector<unsigned char> objectInView;
+	std::vector<float> objectDepth;
+	std::vector<unsigned char> lightInView;
+	GLuint overdrawQuery;
+	glGenQueries(1, &overdrawQuery);
+	std::vector<float> depthPixels(countOverdraw ? width * height : 0);
+	long long shadedFragments = 0;
+	long long coveredPixels = 0;
+
+	// --deferred starts with the deferred path, G switches between the two at any time.
+	// --bench-deferred switches every 100 frames by itself and stops after 1000
+	bool deferred = findOption(argc, argv, "--deferred") != 0;
+	bool benchDeferred = findOption(argc, argv, "--bench-deferred") != 0;
+	bool toggleWasDown = false;
+	// Same depth precision as the target the forward path draws in
+	GBuffer gBuffer(width, height, reverseZTarget != nullptr ? GL_DEPTH_COMPONENT32F : GL_DEPTH_COMPONENT24);
+	if (!gBuffer.Complete())
+	{
+		std::cout << "G-buffer not supported, deferred shading disabled" << std::endl;
+		deferred = false;
+		benchDeferred = false;
+	}
+	// The G-buffer textures go on the units after the sphere texture
+	const char* gBufferSamplers[3] = { "gAlbedoTex", "gNormalTex", "gDepthTex" };
+	for (Shader* shader : { &ambientShader, &lightVolumeShader })
+	{
+		shader->Activate();
+		for (int i = 0; i < 3; i++)
+		{
+			glUniform1i(glGetUniformLocation(shader->ID, gBufferSamplers[i]), 1 + i);
+		}
+		glUniform1f(glGetUniformLocation(shader->ID, "clearDepth"), reverseZTarget != nullptr ? 0.0f : 1.0f);
+		glUniform1i(glGetUniformLocation(shader->ID, "depthZeroToOne"), reverseZTarget != nullptr);
+	}
+
+	// Shadow maps, rendered at the start of the frame when what they see changed. The spheres don't move,
+	// so the casters keep version 0 and only the light (or the camera for the cascades) triggers a render
+	Shader cubeShadowShader("./shaders/shadow.vert.txt", "./shaders/shadow.frag.txt", "#define CUBE\n");
+	Shader cascadeShadowShader("./shaders/shadow.vert.txt", "./shaders/shadow.frag.txt");
+	CubeShadowMap* cubeShadow = shadows ? new CubeShadowMap(1024) : nullptr;
+	CascadedShadowMap* sunShadow = sun ? new CascadedShadowMap(2048) : nullptr;
+	const float shadowDistance = 40.0f;
+	glm::vec3 sunDirection = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+	glm::vec3 sunColor(0.5f, 0.48f, 0.45f);
+	if (cubeShadow != nullptr)
+	{
+		cubeShadow->SetFiltering(pcf);
+	}
+	if (sunShadow != nullptr)
+	{
+		sunShadow->SetFiltering(pcf);
+	}
+	// The shadow maps go on the units after the cluster and G-buffer textures
+	for (Shader* shader : { &shaderProgram, &ambientShader, &lightVolumeShader })
+	{
+		shader->Activate();
+		glUniform1i(glGetUniformLocation(shader->ID, "shadowCube"), 4);
+		glUniform1i(glGetUniformLocation(shader->ID, "shadowCascades"), 5);
+		glUniform1i(glGetUniformLocation(shader->ID, "shadowPCF"), (int)pcf);
+		glUniform3fv(glGetUniformLocation(shader->ID, "sunDirection"), 1, glm::value_ptr(sunDirection));
+		glUniform3fv(glGetUniformLocation(shader->ID, "sunColor"), 1, glm::value_ptr(sunColor));
+	}
+	// Hands the shadow maps of this frame to a shader
+	auto bindShadows = [&](Shader& shader)
+	{
+		if (cubeShadow != nullptr)
+		{
+			cubeShadow->Bind(4);
+			glUniform3fv(glGetUniformLocation(shader.ID, "shadowLightPosition"), 1, glm::value_ptr(lights[0].position));
+			glUniform1f(glGetUniformLocation(shader.ID, "shadowFar"), lights[0].radius);
+		}
+		if (sunShadow != nullptr)
+		{
+			sunShadow->Bind(5);
+			glUniformMatrix4fv(glGetUniformLocation(shader.ID, "cascadeMatrices"), sunShadow->cascades, GL_FALSE, glm::value_ptr(sunShadow->matrices[0]));
+		}
+	};
+	// Every sphere casts, whether the camera sees it or not
+	auto drawCasters = [&](GLint modelLoc)
+	{
+		VAO1.Bind();
+		for (const SceneObject& object : objects)
+		{
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), object.position);
+			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+			glDrawElements(GL_TRIANGLES, sizeof(indices) / sizeof(int), GL_UNSIGNED_INT, 0);
+		}
+	};
+	float lightAngle = 0.0f;
+	GLuint shadowQueries[2][2];
+	glGenQueries(4, &shadowQueries[0][0]);
+	double shadowGPUMs = 0.0;
+	double shadowCPUMs = 0.0;
+
+	// GPU time of each path between two timestamps, read two frames late so the result is never waited for
+	GLuint timerQueries[2][2];
+	glGenQueries(4, &timerQueries[0][0]);
+	bool queryDeferred[2] = { false, false };
+	double pathGPUMs[2] = { 0.0, 0.0 };
+	long long pathFrames[2] = { 0, 0 };
+
+	// The simulation runs at a fixed 60 steps per second and the rendering at whatever rate it can,
+	// --deterministic simulates exactly one step per frame whatever the frame rate
+	SystemClock systemClock;
+	ManualClock manualClock;
+	bool deterministic = golden || findOption(argc, argv, "--deterministic") != 0;
+	Clock* clock = &systemClock;
+	if (deterministic)
+	{
+		clock = &manualClock;
+	}
+	FixedTimestep timestep(*clock);
+	OffscreenTarget* goldenTarget = nullptr;
+	bool goldenPassed = true;
+	if (golden)
+	{
+		goldenTarget = new OffscreenTarget(width, height);
+		if (!goldenTarget->Complete())
+		{
+			std::cout << "offscreen target not supported, no golden image check" << std::endl;
+			goldenPassed = false;
+			glfwSetWindowShouldClose(window, GLFW_TRUE);
+		}
+	}
+	// The loading calls are not part of a frame
+	GLState::Current().frame = GLStateCounters();
 
     while (!glfwWindowShouldClose(window))
     {
-        // Specify the color of the background
-		glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
-		// Clean the back buffer and depth buffer
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		PROFILE_ZONE("frame");
+		// Switches between forward and deferred shading
+		bool toggleDown = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+		if (benchDeferred && frames > 0 && frames % 100 == 0)
+		{
+			toggleDown = !toggleWasDown;
+			if (frames == 1000)
+			{
+				glfwSetWindowShouldClose(window, GLFW_TRUE);
+			}
+		}
+		if (toggleDown && !toggleWasDown)
+		{
+			deferred = !deferred;
+			std::cout << (deferred ? "deferred" : "forward") << " shading" << std::endl;
+		}
+		toggleWasDown = toggleDown;
+		gpuProfiler.BeginFrame();
 
-		// Handles camera inputs
-		camera.Inputs(window);
+		int query = frames % 2;
+		if (frames >= 2)
+		{
+			GLuint64 start, end;
+			glGetQueryObjectui64v(timerQueries[query][0], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(timerQueries[query][1], GL_QUERY_RESULT, &end);
+			pathGPUMs[queryDeferred[query]] += (end - start) / 1e6;
+			pathFrames[queryDeferred[query]]++;
+			glGetQueryObjectui64v(shadowQueries[query][0], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(shadowQueries[query][1], GL_QUERY_RESULT, &end);
+			shadowGPUMs += (end - start) / 1e6;
+		}
+		queryDeferred[query] = deferred;
+		glQueryCounter(timerQueries[query][0], GL_TIMESTAMP);
+
+		if (deferred)
+		{
+			// Only the depth needs clearing, pixels left at the clear depth are skipped by the lighting passes
+			gBuffer.Bind();
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+		else if (reverseZTarget != nullptr)
+		{
+			reverseZTarget->Bind();
+		}
+		else if (goldenTarget != nullptr)
+		{
+			goldenTarget->Bind();
+		}
+		if (!deferred)
+		{
+			// Specify the color of the background
+			glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
+			// Clean the back buffer and depth buffer
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
+		// Uploads the textures that finished decoding
+		{
+			PROFILE_ZONE("textures");
+			textureLoader.Update();
+			if (textureCache != nullptr)
+			{
+				textureCache->NextFrame();
+			}
+		}
+
+		// Runs the simulation steps due since the last frame
+		{
+			PROFILE_ZONE("simulation");
+			if (deterministic)
+			{
+				manualClock.Advance(timestep.Step());
+			}
+			for (int steps = timestep.Advance(); steps > 0; steps--)
+			{
+				// Handles camera inputs
+				camera.Inputs(window, timestep.Step());
+				if (orbitLight)
+				{
+					lightAngle += timestep.Step() * 0.5f;
+				}
+			}
+		}
 		// Updates and exports the camera matrix to the Vertex Shader
-		camera.updateMatrix(FOV, nearPlane, farPlane);
+		camera.updateMatrix(FOV, nearPlane, farPlane, timestep.Alpha());
+		if (orbitLight)
+		{
+			// Circles above the middle of the grid
+			lights[0].position = glm::vec3(3.0f * cos(lightAngle), 1.5f, -(spheresPerSide - 1) * 1.5f + 3.0f * sin(lightAngle));
+			lightBuffer.Upload(lights);
+		}
+
+		// Re-renders the shadow maps that are out of date
+		gpuProfiler.Push("shadows");
+		glQueryCounter(shadowQueries[query][0], GL_TIMESTAMP);
+		double shadowStart = frameClock.Now();
+		if (cubeShadow != nullptr)
+		{
+			PROFILE_ZONE("cube shadow map");
+			cubeShadow->Update(cubeShadowShader, lights[0].position, lights[0].radius, 0, drawCasters);
+		}
+		if (sunShadow != nullptr)
+		{
+			PROFILE_ZONE("cascaded shadow maps");
+			sunShadow->Update(cascadeShadowShader, camera.viewMatrix(), camera.projectionMatrix(), nearPlane, shadowDistance, sunDirection, 0, drawCasters);
+		}
+		shadowCPUMs += (frameClock.Now() - shadowStart) * 1000.0;
+		glQueryCounter(shadowQueries[query][1], GL_TIMESTAMP);
+		gpuProfiler.Pop();
 
+		// A light whose sphere is out of the view can't light anything visible
+		{
+			PROFILE_ZONE("light culling");
+			lightInView.resize(lights.size());
+			jobs.ParallelFor(0, (int)lights.size(), CULLING_GRAIN, [&](int first, int last)
+			{
+				for (int i = first; i < last; i++)
+				{
+					lightInView[i] = camera.SphereVisible(lights[i].position, lights[i].radius);
+				}
+			});
+			visibleLights.clear();
+			for (int i = 0; i < (int)lights.size(); i++)
+			{
+				if (lightInView[i])
+				{
+					visibleLights.push_back(i);
+				}
+			}
+		}
 
-		// Tells OpenGL which Shader Program we want to use
-		shaderProgram.Activate();
-		// Exports the camera Position to the Fragment Shader for specular lighting
-		glUniform3f(glGetUniformLocation(shaderProgram.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
-		// Export the camMatrix to the Vertex Shader of the pyramid
-		camera.Matrix(shaderProgram, "camMatrix");
 		// Binds texture so that is appears in rendering
-		sphereTex.Bind();
-		// Bind the VAO so OpenGL knows to use it
-		VAO1.Bind();
-		// Draw primitives, number of indices, datatype of indices, index of indices
-		glDrawElements(GL_TRIANGLES, sizeof(indices) / sizeof(int), GL_UNSIGNED_INT, 0);
+		if (atlas != nullptr)
+		{
+			atlas->Bind();
+		}
+		else if (textureCache != nullptr)
+		{
+			textureCache->Bind(sphereHandle);
+		}
+		else
+		{
+			sphereTex.Bind();
+		}
+
+		// Visible spheres by distance along the view, closest first so the depth test rejects what they hide
+		{
+			PROFILE_ZONE("sphere culling");
+			// Tested on the workers, gathered in scene order so the draw order doesn't depend on the timing
+			glm::mat4 view = camera.viewMatrix();
+			objectInView.resize(objects.size());
+			objectDepth.resize(objects.size());
+			jobs.ParallelFor(0, (int)objects.size(), CULLING_GRAIN, [&](int first, int last)
+			{
+				for (int i = first; i < last; i++)
+				{
+					objectInView[i] = camera.SphereVisible(objects[i].position, objects[i].radius);
+					objectDepth[i] = -(view * glm::vec4(objects[i].position, 1.0f)).z;
+				}
+			});
+			drawOrder.clear();
+			for (int i = 0; i < (int)objects.size(); i++)
+			{
+				if (objectInView[i])
+				{
+					drawOrder.push_back(std::make_pair(objectDepth[i], i));
+				}
+			}
+			if (sortFrontToBack)
+			{
+				std::sort(drawOrder.begin(), drawOrder.end());
+			}
+		}
+
+		// Depth of the visible spheres, from the positions alone and without writing any color
+		auto drawDepthPrePass = [&]()
+		{
+			depthShader.Activate();
+			glUniformMatrix4fv(depthMatrixLocation, 1, GL_FALSE, glm::value_ptr(camera.cameraMatrix));
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			positionVAO.Bind();
+			for (const std::pair<float, int>& entry : drawOrder)
+			{
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), objects[entry.second].position);
+				glUniformMatrix4fv(depthModelLocation, 1, GL_FALSE, glm::value_ptr(model));
+				glDrawElements(GL_TRIANGLES, sizeof(indices) / sizeof(int), GL_UNSIGNED_INT, 0);
+			}
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		};
+		if (prePass)
+		{
+			PROFILE_ZONE("depth pre-pass");
+			GPUScope scope(gpuProfiler, "depth pre-pass");
+			drawDepthPrePass();
+		}
+
+		// Draws the visible spheres, with the list of their lights for the forward path
+		auto drawObjects = [&](GLint modelLoc, bool lightLists)
+		{
+			if (prePass)
+			{
+				// Only the closest fragment of each pixel gets through, the depth is already there
+				glDepthFunc(GL_EQUAL);
+				glDepthMask(GL_FALSE);
+			}
+			if (countOverdraw)
+			{
+				glBeginQuery(GL_SAMPLES_PASSED, overdrawQuery);
+			}
+			// Bind the VAO so OpenGL knows to use it
+			VAO1.Bind();
+			for (const std::pair<float, int>& entry : drawOrder)
+			{
+				const SceneObject& object = objects[entry.second];
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), object.position);
+				glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+				int objectLightCount = 0;
+				if (lightLists)
+				{
+					int objectLights[MAX_OBJECT_LIGHTS];
+					objectLightCount = cullLights(lights, visibleLights, object.position, object.radius, objectLights, MAX_OBJECT_LIGHTS);
+					glUniform1i(lightCountLocation, objectLightCount);
+					glUniform1iv(lightIndicesLocation, objectLightCount, objectLights);
+				}
+				// Draw primitives, number of indices, datatype of indices, index of indices
+				glDrawElements(GL_TRIANGLES, sizeof(indices) / sizeof(int), GL_UNSIGNED_INT, 0);
+				if (lightLists)
+				{
+					drawnObjects++;
+					assignedLights += objectLightCount;
+				}
+			}
+			if (countOverdraw)
+			{
+				// Fragments that passed the depth test, so were shaded, against the pixels the spheres cover in the end
+				glEndQuery(GL_SAMPLES_PASSED);
+				GLuint samples = 0;
+				glGetQueryObjectuiv(overdrawQuery, GL_QUERY_RESULT, &samples);
+				shadedFragments += samples;
+				glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, depthPixels.data());
+				float clearDepth = reverseZTarget != nullptr ? 0.0f : 1.0f;
+				coveredPixels += std::count_if(depthPixels.begin(), depthPixels.end(), [clearDepth](float depth) { return depth != clearDepth; });
+			}
+			if (prePass)
+			{
+				glDepthFunc(depthFunc);
+				glDepthMask(GL_TRUE);
+			}
+		};
+		// Draws the visible lights with their color
+		auto drawLightMeshes = [&](GLint modelLoc, GLint colorLoc)
+		{
+			// Bind the VAO so OpenGL knows to use it
+			VAO2.Bind();
+			for (int i : visibleLights)
+			{
+				// The random lights are drawn smaller than the main one
+				glm::mat4 lightModel = glm::translate(glm::mat4(1.0f), lights[i].position);
+				if (i > 0)
+				{
+					lightModel = glm::scale(lightModel, glm::vec3(0.4f));
+				}
+				glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(lightModel));
+				glUniform4f(colorLoc, lights[i].color.r, lights[i].color.g, lights[i].color.b, 1.0f);
+				// Draw primitives, number of indices, datatype of indices, index of indices
+				glDrawElements(GL_TRIANGLES, sizeof(lightIndices) / sizeof(int), GL_UNSIGNED_INT, 0);
+			}
+		};
 
+		if (deferred)
+		{
+			PROFILE_ZONE("deferred shading");
+			// Geometry pass: albedo and normal of the closest surfaces, no lighting
+			gpuProfiler.Push("geometry");
+			gBufferShader.Activate();
+			camera.Matrix(gBufferShader, "camMatrix");
+			drawObjects(gBufferModelLocation, false);
+			lightGBufferShader.Activate();
+			camera.Matrix(lightGBufferShader, "camMatrix");
+			drawLightMeshes(lightGBufferModelLocation, lightGBufferColorLocation);
+			gpuProfiler.Pop();
 
+			// Lighting passes, straight to the screen (or the reverse-Z or golden image target)
+			if (reverseZTarget != nullptr)
+			{
+				reverseZTarget->Bind();
+			}
+			else if (goldenTarget != nullptr)
+			{
+				goldenTarget->Bind();
+			}
+			else
+			{
+				gBuffer.Unbind();
+			}
+			glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			gBuffer.BindTextures(1);
+			GLState::Current().Disable(GL_DEPTH_TEST);
 
-		// Tells OpenGL which Shader Program we want to use
-		lightShader.Activate();
-		// Export the camMatrix to the Vertex Shader of the light cube
-		camera.Matrix(lightShader, "camMatrix");
-		// Bind the VAO so OpenGL knows to use it
-		VAO2.Bind();
-		// Draw primitives, number of indices, datatype of indices, index of indices
-		glDrawElements(GL_TRIANGLES, sizeof(lightIndices) / sizeof(int), GL_UNSIGNED_INT, 0);
+			// Ambient term (and the sun) over every covered pixel
+			gpuProfiler.Push("ambient");
+			ambientShader.Activate();
+			glUniformMatrix4fv(glGetUniformLocation(ambientShader.ID, "inverseCamMatrix"), 1, GL_FALSE, glm::value_ptr(camera.inverseMatrix()));
+			glUniform3f(glGetUniformLocation(ambientShader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+			bindShadows(ambientShader);
+			emptyVAO.Bind();
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			gpuProfiler.Pop();
 
+			// Each light added over its volume. The sphere mesh turns its front faces inwards, so culling the back faces
+			// keeps the far half: it covers the pixels of the volume once, with the camera inside it too,
+			// and the depth clamp stops the near and far planes from cutting it
+			gpuProfiler.Push("light volumes");
+			lightVolumeShader.Activate();
+			camera.Matrix(lightVolumeShader, "camMatrix");
+			glUniformMatrix4fv(glGetUniformLocation(lightVolumeShader.ID, "inverseCamMatrix"), 1, GL_FALSE, glm::value_ptr(camera.inverseMatrix()));
+			glUniform3f(glGetUniformLocation(lightVolumeShader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+			bindShadows(lightVolumeShader);
+			GLState::Current().Enable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+			GLState::Current().Enable(GL_CULL_FACE);
+			glCullFace(GL_BACK);
+			GLState::Current().Enable(GL_DEPTH_CLAMP);
+			VAO2.Bind();
+			for (int i : visibleLights)
+			{
+				// The mesh is a bit inside the sphere it approximates
+				glm::mat4 volume = glm::translate(glm::mat4(1.0f), lights[i].position);
+				volume = glm::scale(volume, glm::vec3(lights[i].radius / lightRadius * 1.05f));
+				glUniformMatrix4fv(volumeModelLocation, 1, GL_FALSE, glm::value_ptr(volume));
+				glUniform1i(volumeLightIndexLocation, i);
+				for (int j = 0; j < 3; j++)
+				{
+					glUniform4fv(volumeLightLocations[j], 1, &lights[i].position.x + 4 * j);
+				}
+				glDrawElements(GL_TRIANGLES, sizeof(lightIndices) / sizeof(int), GL_UNSIGNED_INT, 0);
+			}
+			GLState::Current().Disable(GL_DEPTH_CLAMP);
+			GLState::Current().Disable(GL_CULL_FACE);
+			GLState::Current().Disable(GL_BLEND);
+			GLState::Current().Enable(GL_DEPTH_TEST);
+			gpuProfiler.Pop();
+		}
+		else
+		{
+			PROFILE_ZONE("forward shading");
+			gpuProfiler.Push("objects");
+			// Tells OpenGL which Shader Program we want to use
+			shaderProgram.Activate();
+			// Exports the camera Position to the Fragment Shader for specular lighting
+			glUniform3f(glGetUniformLocation(shaderProgram.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+			// Export the camMatrix to the Vertex Shader of the pyramid
+			camera.Matrix(shaderProgram, "camMatrix");
+			bindShadows(shaderProgram);
+			if (clusterBuffers != nullptr)
+			{
+				PROFILE_ZONE("clusters");
+				double binningStart = frameClock.Now();
+				clusterGrid.SetProjection(camera.projectionMatrix());
+				clusterGrid.Bin(lights, camera.viewMatrix());
+				binningMs += (frameClock.Now() - binningStart) * 1000.0;
+				clusterBuffers->Upload(lights, clusterGrid);
+				clusterBuffers->Bind(shaderProgram, 1, clusterGrid, width, height, camera.viewMatrix());
+			}
+			drawObjects(modelLocation, clusterBuffers == nullptr);
+			gpuProfiler.Pop();
 
-		// Swap the back buffer with the front buffer
-		glfwSwapBuffers(window);
-		// Take care of all GLFW events
-		glfwPollEvents();
+			// Tells OpenGL which Shader Program we want to use
+			gpuProfiler.Push("light meshes");
+			lightShader.Activate();
+			// Export the camMatrix to the Vertex Shader of the light cube
+			camera.Matrix(lightShader, "camMatrix");
+			drawLightMeshes(lightModelLocation, lightColorLocation);
+			gpuProfiler.Pop();
+		}
+
+		if (reverseZTarget != nullptr)
+		{
+			GPUScope scope(gpuProfiler, "blit");
+			reverseZTarget->BlitToScreen(goldenTarget != nullptr ? goldenTarget->ID : 0);
+		}
+		gpuProfiler.EndFrame();
+		glQueryCounter(timerQueries[query][1], GL_TIMESTAMP);
+
+		if (goldenTarget != nullptr && frames + 1 == GOLDEN_FRAMES)
+		{
+			// A quarter of the resolution is enough to see a change and keeps the references small
+			goldenPassed = checkGolden(downsample(goldenTarget->Read(), 4), argv[goldenOption + 1], findOption(argc, argv, "--golden-update") != 0);
+			glfwSetWindowShouldClose(window, GLFW_TRUE);
+		}
+		if (capture != nullptr)
+		{
+			capture->Capture();
+		}
+		{
+			PROFILE_ZONE("swap");
+			// Swap the back buffer with the front buffer
+			glfwSwapBuffers(window);
+			// Take care of all GLFW events
+			glfwPollEvents();
+		}
+		frames++;
+		GLState::Current().NextFrame();
+		endGLTraceFrame();
     }
 
+	if (capture != nullptr)
+	{
+		capture->Finish();
+		capture->Print();
+		capture->Delete();
+		delete capture;
+	}
+
+	printGLTraceSummary();
+	if (cpuProfileStarted())
+	{
+		writeCPUProfile(argv[cpuTraceOption + 1]);
+	}
+
+	if (gpuProfiler.Enabled())
+	{
+		gpuProfiler.Finish();
+		gpuProfiler.Print();
+		gpuProfiler.Write(argv[gpuProfileOption + 1]);
+	}
+	gpuProfiler.Delete();
+
+	if (glStats)
+	{
+		const GLState& state = GLState::Current();
+		long long stateFrames = std::max(1LL, state.frames);
+		std::cout << "GL state cache: " << (double)state.total.issued / stateFrames << " calls issued and "
+			<< (double)state.total.elided / stateFrames << " elided per frame over " << state.frames << " frames" << std::endl;
+	}
+
+	if (countOverdraw)
+	{
+		std::cout << "overdraw: " << (coveredPixels > 0 ? (double)shadedFragments / coveredPixels : 0.0) << " shaded fragments per covered pixel ("
+			<< (prePass ? "with" : "without") << " depth pre-pass, " << (sortFrontToBack ? "front to back" : "unsorted") << ")" << std::endl;
+	}
+	if (cubeShadow != nullptr || sunShadow != nullptr)
+	{
+		std::cout << "shadow pass: " << (cubeShadow != nullptr ? cubeShadow->renders : 0) << " cube map renders, "
+			<< (sunShadow != nullptr ? sunShadow->renders : 0) << " cascade renders over " << frames << " frames, "
+			<< (frames > 2 ? shadowGPUMs / (frames - 2) : 0.0) << " ms GPU and "
+			<< (frames > 0 ? shadowCPUMs / frames : 0.0) << " ms CPU per frame" << std::endl;
+	}
+	if (pathFrames[1] > 0)
+	{
+		std::cout << "GPU time per frame: forward " << (pathFrames[0] > 0 ? pathGPUMs[0] / pathFrames[0] : 0.0) << " ms over " << pathFrames[0]
+			<< " frames, deferred " << pathGPUMs[1] / pathFrames[1] << " ms over " << pathFrames[1] << " frames" << std::endl;
+	}
+	if (clusterBuffers != nullptr)
+	{
+		std::cout << objects.size() << " spheres, " << lights.size() << " clustered lights: "
+			<< clusterGrid.indices.size() << " light indices in the last frame, "
+			<< (frames > 0 ? binningMs / frames : 0.0) << " ms of binning and "
+			<< (frames > 0 ? frameClock.Now() * 1000.0 / frames : 0.0) << " ms per frame" << std::endl;
+		clusterBuffers->Delete();
+		delete clusterBuffers;
+	}
+	else if (spheresOption != 0 || lightsOption != 0)
+	{
+		std::cout << objects.size() << " spheres, " << lights.size() << " lights: "
+			<< (drawnObjects > 0 ? (double)assignedLights / drawnObjects : 0.0) << " lights per drawn sphere, "
+			<< (frames > 0 ? frameClock.Now() * 1000.0 / frames : 0.0) << " ms per frame" << std::endl;
+	}
+
     // Delete all the objects we've created
 	VAO1.Delete();
 	VBO1.Delete();
 	EBO1.Delete();
 	sphereTex.Delete();
+	if (atlas != nullptr)
+	{
+		atlas->Delete();
+		delete atlas;
+	}
+	if (textureCache != nullptr)
+	{
+		TextureCacheStats stats = textureCache->Stats();
+		std::cout << "texture residency: " << stats.residentBytes / 1024 << " KiB of " << stats.budgetBytes / 1024 << " KiB budget"
+			<< " (peak " << stats.peakBytes / 1024 << " KiB, " << stats.fullBytes / 1024 << " KiB at full resolution), "
+			<< stats.residentTextures << "/" << stats.textures << " textures resident, " << stats.reducedTextures << " reduced, "
+			<< stats.evictions << " evictions, " << stats.mipDrops << " mip drops, " << stats.reloads << " reloads" << std::endl;
+		textureCache->Delete();
+		delete textureCache;
+	}
+	if (reverseZTarget != nullptr)
+	{
+		reverseZTarget->Delete();
+		delete reverseZTarget;
+	}
+	lightBuffer.Delete();
+	textureLoader.Delete();
 	shaderProgram.Delete();
 	VAO2.Delete();
 	VBO2.Delete();
 	EBO2.Delete();
 	lightShader.Delete();
+	gBuffer.Delete();
+	gBufferShader.Delete();
+	lightGBufferShader.Delete();
+	ambientShader.Delete();
+	lightVolumeShader.Delete();
+	emptyVAO.Delete();
+	glDeleteQueries(4, &timerQueries[0][0]);
+	glDeleteQueries(4, &shadowQueries[0][0]);
+	cubeShadowShader.Delete();
+	positionVAO.Delete();
+	positionVBO.Delete();
+	depthShader.Delete();
+	glDeleteQueries(1, &overdrawQuery);
+	cascadeShadowShader.Delete();
+	if (cubeShadow != nullptr)
+	{
+		cubeShadow->Delete();
+		delete cubeShadow;
+	}
+	if (sunShadow != nullptr)
+	{
+		sunShadow->Delete();
+		delete sunShadow;
+	}
+	if (goldenTarget != nullptr)
+	{
+		goldenTarget->Delete();
+		delete goldenTarget;
+	}
 	// Delete window before ending the program
 	glfwDestroyWindow(window);
 	// Terminate GLFW before ending the program
 	glfwTerminate();
-	return 0;
+	return goldenPassed ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,367 @@
+#include "mipmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_USE_SSE
+#if defined(__GNUC__)
+#include <immintrin.h>
+// Compiled for AVX2 on its own and only called when the CPU reports it
+#define MIP_USE_AVX2
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIP_USE_NEON
+#endif
+
+// Levels are filtered as RGBA floats whatever the channel count, so every pixel fills a 4 lanes vector
+struct LinearImage
+{
+	std::vector<float> pixels;
+	int width;
+	int height;
+};
+
+// ----- 4 lanes vectors -----
+
+#if defined(MIP_USE_SSE)
+typedef __m128 Vec4;
+static inline Vec4 zero4() { return _mm_setzero_ps(); }
+static inline Vec4 load4(const float* p) { return _mm_loadu_ps(p); }
+static inline void store4(float* p, Vec4 v) { _mm_storeu_ps(p, v); }
+static inline Vec4 add4(Vec4 a, Vec4 b) { return _mm_add_ps(a, b); }
+static inline Vec4 madd4(Vec4 acc, float w, Vec4 v) { return _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w), v)); }
+#elif defined(MIP_USE_NEON)
+typedef float32x4_t Vec4;
+static inline Vec4 zero4() { return vdupq_n_f32(0.0f); }
+static inline Vec4 load4(const float* p) { return vld1q_f32(p); }
+static inline void store4(float* p, Vec4 v) { vst1q_f32(p, v); }
+static inline Vec4 add4(Vec4 a, Vec4 b) { return vaddq_f32(a, b); }
+static inline Vec4 madd4(Vec4 acc, float w, Vec4 v) { return vmlaq_n_f32(acc, v, w); }
+#else
+struct Vec4 { float v[4]; };
+static inline Vec4 zero4() { return Vec4{ { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+static inline Vec4 load4(const float* p) { return Vec4{ { p[0], p[1], p[2], p[3] } }; }
+static inline void store4(float* p, Vec4 v) { for (int c = 0; c < 4; c++) p[c] = v.v[c]; }
+static inline Vec4 add4(Vec4 a, Vec4 b) { for (int c = 0; c < 4; c++) a.v[c] += b.v[c]; return a; }
+static inline Vec4 madd4(Vec4 acc, float w, Vec4 v) { for (int c = 0; c < 4; c++) acc.v[c] += w * v.v[c]; return acc; }
+#endif
+
+// ----- Box filter rows -----
+
+// Averages the 2x2 footprints of two source rows, the source being at least 2 pixels wide
+typedef void (*BoxRowFunction)(const float* row0, const float* row1, float* out, int outWidth);
+
+static void boxRow128(const float* row0, const float* row1, float* out, int outWidth)
+{
+	for (int x = 0; x < outWidth; x++)
+	{
+		Vec4 sum = add4(add4(load4(row0 + 8 * x), load4(row0 + 8 * x + 4)), add4(load4(row1 + 8 * x), load4(row1 + 8 * x + 4)));
+		store4(out + 4 * x, madd4(zero4(), 0.25f, sum));
+	}
+}
+
+#ifdef MIP_USE_AVX2
+__attribute__((target("avx2"))) static void boxRowAVX2(const float* row0, const float* row1, float* out, int outWidth)
+{
+	const __m256 quarter = _mm256_set1_ps(0.25f);
+	int x = 0;
+	// Two output pixels per iteration: four source pixels from each row
+	for (; x + 2 <= outWidth; x += 2)
+	{
+		__m256 a = _mm256_add_ps(_mm256_loadu_ps(row0 + 8 * x), _mm256_loadu_ps(row1 + 8 * x));
+		__m256 b = _mm256_add_ps(_mm256_loadu_ps(row0 + 8 * x + 8), _mm256_loadu_ps(row1 + 8 * x + 8));
+		// Adds each pixel to its horizontal neighbour: (a.lo + a.hi, b.lo + b.hi)
+		__m256 left = _mm256_permute2f128_ps(a, b, 0x20);
+		__m256 right = _mm256_permute2f128_ps(a, b, 0x31);
+		_mm256_storeu_ps(out + 4 * x, _mm256_mul_ps(_mm256_add_ps(left, right), quarter));
+	}
+	if (x < outWidth)
+	{
+		boxRow128(row0 + 8 * x, row1 + 8 * x, out + 4 * x, outWidth - x);
+	}
+}
+#endif
+
+static BoxRowFunction selectBoxRow()
+{
+#ifdef MIP_USE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return boxRowAVX2;
+	}
+#endif
+	return boxRow128;
+}
+
+const char* mipmapInstructionSet()
+{
+#ifdef MIP_USE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return "AVX2";
+	}
+#endif
+#if defined(MIP_USE_SSE)
+	return "SSE2";
+#elif defined(MIP_USE_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+// ----- Kaiser filter -----
+
+// Modified Bessel function of the first kind, order 0
+static double besselI0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; k++)
+	{
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+// Weights of the 6 source pixels around each output pixel, at distances -2.5 to 2.5
+static const float* kaiserWeights()
+{
+	static float weights[6];
+	static bool ready = []()
+	{
+		const double alpha = 4.0, radius = 3.0, pi = 3.14159265358979323846;
+		double total = 0.0;
+		for (int k = 0; k < 6; k++)
+		{
+			double d = k - 2.5;
+			// Sinc with the cutoff halved for the 2x reduction
+			double t = pi * d / 2.0;
+			double sinc = std::sin(t) / t;
+			double window = besselI0(alpha * std::sqrt(1.0 - (d / radius) * (d / radius))) / besselI0(alpha);
+			weights[k] = (float)(sinc * window);
+			total += weights[k];
+		}
+		for (int k = 0; k < 6; k++)
+		{
+			weights[k] = (float)(weights[k] / total);
+		}
+		return true;
+	}();
+	(void)ready;
+	return weights;
+}
+
+// ----- Color space -----
+
+const int LINEAR_TABLE_SIZE = 16384;
+
+struct ColorTables
+{
+	float toLinear[256];
+	unsigned char toSrgb[LINEAR_TABLE_SIZE];
+
+	ColorTables()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < LINEAR_TABLE_SIZE; i++)
+		{
+			float l = i / (float)(LINEAR_TABLE_SIZE - 1);
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			toSrgb[i] = (unsigned char)(c * 255.0f + 0.5f);
+		}
+	}
+};
+
+static const ColorTables& colorTables()
+{
+	static ColorTables tables;
+	return tables;
+}
+
+// Channel c holds color: only the RGB of 3 and 4 channel images does, alpha and the channels of
+// 1 and 2 channel images (luminance-alpha, normals, masks) are linear
+static bool isColorChannel(int c, int channels)
+{
+	return channels >= 3 && c < 3;
+}
+
+// ----- Levels -----
+
+// Runs work over [first, last) row ranges, spread over the workers when a job system is given
+static void parallelRows(int rows, JobSystem* jobs, const std::function<void(int, int)>& work)
+{
+	if (jobs == nullptr || rows < 16)
+	{
+		work(0, rows);
+		return;
+	}
+
+	// A few ranges per thread so they stay busy when rows cost differently
+	jobs->ParallelFor(0, rows, std::max(1, rows / (int)((jobs->Size() + 1) * 4)), work);
+}
+
+static LinearImage toLinear(const unsigned char* pixels, int width, int height, int channels, bool srgb, JobSystem* jobs)
+{
+	const ColorTables& tables = colorTables();
+	LinearImage image;
+	image.width = width;
+	image.height = height;
+	image.pixels.assign((size_t)width * height * 4, 1.0f);
+
+	parallelRows(height, jobs, [&](int first, int last)
+	{
+		for (size_t i = (size_t)first * width; i < (size_t)last * width; i++)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				unsigned char value = pixels[i * channels + c];
+				image.pixels[i * 4 + c] = srgb && isColorChannel(c, channels) ? tables.toLinear[value] : value / 255.0f;
+			}
+		}
+	});
+	return image;
+}
+
+static TextureContainerImage toBytes(const LinearImage& image, int channels, bool srgb, JobSystem* jobs)
+{
+	const ColorTables& tables = colorTables();
+	TextureContainerImage result;
+	result.width = image.width;
+	result.height = image.height;
+	result.pixels.resize((size_t)image.width * image.height * channels);
+
+	parallelRows(image.height, jobs, [&](int first, int last)
+	{
+		for (size_t i = (size_t)first * image.width; i < (size_t)last * image.width; i++)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				// The Kaiser filter can overshoot, so clamp before the lookup
+				float value = std::min(1.0f, std::max(0.0f, image.pixels[i * 4 + c]));
+				result.pixels[i * channels + c] = srgb && isColorChannel(c, channels)
+					? tables.toSrgb[(int)(value * (LINEAR_TABLE_SIZE - 1) + 0.5f)]
+					: (unsigned char)(value * 255.0f + 0.5f);
+			}
+		}
+	});
+	return result;
+}
+
+static LinearImage downsampleBox(const LinearImage& source, JobSystem* jobs)
+{
+	LinearImage result;
+	result.width = std::max(1, source.width / 2);
+	result.height = std::max(1, source.height / 2);
+	result.pixels.resize((size_t)result.width * result.height * 4);
+
+	BoxRowFunction boxRow = selectBoxRow();
+	parallelRows(result.height, jobs, [&](int first, int last)
+	{
+		for (int y = first; y < last; y++)
+		{
+			// Odd heights drop their last row, a single row is averaged with itself
+			const float* row0 = &source.pixels[(size_t)std::min(2 * y, source.height - 1) * source.width * 4];
+			const float* row1 = &source.pixels[(size_t)std::min(2 * y + 1, source.height - 1) * source.width * 4];
+			float* out = &result.pixels[(size_t)y * result.width * 4];
+
+			if (source.width >= 2)
+			{
+				boxRow(row0, row1, out, result.width);
+			}
+			else
+			{
+				store4(out, madd4(zero4(), 0.5f, add4(load4(row0), load4(row1))));
+			}
+		}
+	});
+	return result;
+}
+
+static LinearImage downsampleKaiser(const LinearImage& source, JobSystem* jobs)
+{
+	const float* weights = kaiserWeights();
+	int width = std::max(1, source.width / 2);
+	int height = std::max(1, source.height / 2);
+
+	// Horizontal pass, every source row
+	LinearImage horizontal;
+	horizontal.width = width;
+	horizontal.height = source.height;
+	horizontal.pixels.resize((size_t)width * source.height * 4);
+
+	parallelRows(source.height, jobs, [&](int first, int last)
+	{
+		for (int y = first; y < last; y++)
+		{
+			const float* row = &source.pixels[(size_t)y * source.width * 4];
+			float* out = &horizontal.pixels[(size_t)y * width * 4];
+			for (int x = 0; x < width; x++)
+			{
+				Vec4 sum = zero4();
+				for (int k = 0; k < 6; k++)
+				{
+					int sx = std::min(source.width - 1, std::max(0, 2 * x - 2 + k));
+					sum = madd4(sum, weights[k], load4(row + 4 * sx));
+				}
+				store4(out + 4 * x, sum);
+			}
+		}
+	});
+
+	// Vertical pass, whole rows at once
+	LinearImage result;
+	result.width = width;
+	result.height = height;
+	result.pixels.resize((size_t)width * height * 4);
+
+	parallelRows(height, jobs, [&](int first, int last)
+	{
+		for (int y = first; y < last; y++)
+		{
+			const float* rows[6];
+			for (int k = 0; k < 6; k++)
+			{
+				int sy = std::min(source.height - 1, std::max(0, 2 * y - 2 + k));
+				rows[k] = &horizontal.pixels[(size_t)sy * width * 4];
+			}
+
+			float* out = &result.pixels[(size_t)y * width * 4];
+			for (int x = 0; x < width; x++)
+			{
+				Vec4 sum = zero4();
+				for (int k = 0; k < 6; k++)
+				{
+					sum = madd4(sum, weights[k], load4(rows[k] + 4 * x));
+				}
+				store4(out + 4 * x, sum);
+			}
+		}
+	});
+	return result;
+}
+
+std::vector<TextureContainerImage> generateMipChain(const unsigned char* pixels, int width, int height, int channels, MipFilter filter, bool srgb, JobSystem* jobs, int maxLevels)
+{
+	std::vector<TextureContainerImage> levels(1);
+	levels[0].width = width;
+	levels[0].height = height;
+	levels[0].pixels.assign(pixels, pixels + (size_t)width * height * channels);
+
+	// Every level is filtered from the previous one, kept in linear floats to avoid requantizing
+	LinearImage current = toLinear(pixels, width, height, channels, srgb, jobs);
+	while ((current.width > 1 || current.height > 1) && (maxLevels <= 0 || (int)levels.size() < maxLevels))
+	{
+		current = filter == MipFilter::Box ? downsampleBox(current, jobs) : downsampleKaiser(current, jobs);
+		levels.push_back(toBytes(current, channels, srgb, jobs));
+	}
+	return levels;
+}
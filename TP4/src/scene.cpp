@@ -0,0 +1,17 @@
+#include "scene.h"
+
+std::vector<SceneObject> sphereGrid(int perSide, float spacing, float radius)
+{
+	std::vector<SceneObject> objects;
+	for (int z = 0; z < perSide; z++)
+	{
+		for (int x = 0; x < perSide; x++)
+		{
+			SceneObject object;
+			object.position = glm::vec3((x - (perSide - 1) * 0.5f) * spacing, 0.0f, -z * spacing);
+			object.radius = radius;
+			objects.push_back(object);
+		}
+	}
+	return objects;
+}
@@ -1,4 +1,6 @@
 #include "shaderClass.h"
+#include "glState.h"
+#include "cpuProfiler.h"
 #include <stdexcept> // Include for std::runtime_error
 
 string get_file_contents(const char* filename)
@@ -17,10 +19,47 @@ string get_file_contents(const char* filename)
     throw std::runtime_error("Failed to open file: " + string(filename));
 }
 
-Shader::Shader(const char* vertexFile,const char* fragmentFile)
+// Inserts the defines on the line after #version, which has to stay first
+static string insertDefines(const string& code, const char* defines)
 {
-    string vertexCode = get_file_contents(vertexFile);
-    string fragmentCode = get_file_contents(fragmentFile);
+    size_t lineEnd = code.find('\n');
+    if (defines[0] == '\0' || lineEnd == string::npos)
+    {
+        return code;
+    }
+    return code.substr(0, lineEnd + 1) + defines + "\n" + code.substr(lineEnd + 1);
+}
+
+// Prints the log of a shader that didn't compile or a program that didn't link
+static void printErrors(GLuint object, bool program, const char* name)
+{
+    GLint success;
+    char log[1024];
+    if (program)
+    {
+        glGetProgramiv(object, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glGetProgramInfoLog(object, sizeof(log), NULL, log);
+            cout << "failed linking " << name << ":\n" << log << endl;
+        }
+    }
+    else
+    {
+        glGetShaderiv(object, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(object, sizeof(log), NULL, log);
+            cout << "failed compiling " << name << ":\n" << log << endl;
+        }
+    }
+}
+
+Shader::Shader(const char* vertexFile,const char* fragmentFile,const char* defines)
+{
+    PROFILE_ZONE("Shader::Shader");
+    string vertexCode = insertDefines(get_file_contents(vertexFile), defines);
+    string fragmentCode = insertDefines(get_file_contents(fragmentFile), defines);
 
     const char* vertexSource = vertexCode.c_str();
     const char* fragmentSource = fragmentCode.c_str();
@@ -28,10 +67,12 @@ Shader::Shader(const char* vertexFile,const char* fragmentFile)
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertexShader,1,&vertexSource,NULL);
     glCompileShader(vertexShader);
+    printErrors(vertexShader, false, vertexFile);
 
     GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(fragmentShader,1,&fragmentSource,NULL);
     glCompileShader(fragmentShader);
+    printErrors(fragmentShader, false, fragmentFile);
 
     ID = glCreateProgram();
 
@@ -39,6 +80,7 @@ Shader::Shader(const char* vertexFile,const char* fragmentFile)
     glAttachShader(ID,fragmentShader);
 
     glLinkProgram(ID);
+    printErrors(ID, true, fragmentFile);
 
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
@@ -46,10 +88,10 @@ Shader::Shader(const char* vertexFile,const char* fragmentFile)
 
 void Shader::Activate()
 {
-    glUseProgram(ID);
+    GLState::Current().UseProgram(ID);
 }
 
 void Shader::Delete()
 {
-    glDeleteProgram(ID);
+    GLState::Current().DeleteProgram(ID);
 }
\ No newline at end of file
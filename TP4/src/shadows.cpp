@@ -0,0 +1,271 @@
+#include "shadows.h"
+#include "glState.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Sets the state of the shadow passes, whatever the main pass uses (reverse-Z in particular),
+// and puts the previous one back when it goes out of scope
+class ShadowPassState
+{
+public:
+	ShadowPassState(GLuint framebuffer, int size, bool depthClamp)
+	{
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glGetIntegerv(GL_VIEWPORT, previousViewport);
+		glGetIntegerv(GL_DEPTH_FUNC, &previousDepthFunc);
+		glGetFloatv(GL_DEPTH_CLEAR_VALUE, &previousClearDepth);
+		clipControl = GLEW_VERSION_4_5 || GLEW_ARB_clip_control;
+		if (clipControl)
+		{
+			glGetIntegerv(GL_CLIP_DEPTH_MODE, &previousClipDepth);
+			glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+		}
+		clamp = depthClamp;
+		if (clamp)
+		{
+			// Casters between the light and the near plane still cast, flattened on it
+			GLState::Current().Enable(GL_DEPTH_CLAMP);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(0, 0, size, size);
+		glDepthFunc(GL_LESS);
+		glClearDepth(1.0);
+	}
+
+	~ShadowPassState()
+	{
+		if (clamp)
+		{
+			GLState::Current().Disable(GL_DEPTH_CLAMP);
+		}
+		if (clipControl)
+		{
+			glClipControl(GL_LOWER_LEFT, (GLenum)previousClipDepth);
+		}
+		glClearDepth(previousClearDepth);
+		glDepthFunc((GLenum)previousDepthFunc);
+		glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+		glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+	}
+
+private:
+	GLint previousFramebuffer;
+	GLint previousViewport[4];
+	GLint previousDepthFunc;
+	GLfloat previousClearDepth;
+	GLint previousClipDepth = GL_NEGATIVE_ONE_TO_ONE;
+	bool clipControl;
+	bool clamp;
+};
+
+// Depth comparison against the reference given with the coordinates, filtered as asked
+static void setShadowFiltering(GLenum target, GLuint texture, ShadowPCF pcf)
+{
+	GLenum filter = pcf == ShadowPCF::None ? GL_NEAREST : GL_LINEAR;
+	GLState::Current().BindTexture(target, texture);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	GLState::Current().BindTexture(target, 0);
+}
+
+CubeShadowMap::CubeShadowMap(int size) : size(size)
+{
+	glGenTextures(1, &texture);
+	GLState::Current().BindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	for (int face = 0; face < 6; face++)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	GLState::Current().BindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	SetFiltering(ShadowPCF::Hardware);
+
+	// Depth only, the faces are attached when rendered
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool CubeShadowMap::Update(Shader& shader, glm::vec3 lightPosition, float farPlane, unsigned int casterVersion, const DrawCasters& draw)
+{
+	if (valid && lightPosition == cachedPosition && farPlane == cachedFar && casterVersion == cachedVersion)
+	{
+		return false;
+	}
+	valid = true;
+	cachedPosition = lightPosition;
+	cachedFar = farPlane;
+	cachedVersion = casterVersion;
+
+	// Directions and up vectors of the faces, in the order of the GL_TEXTURE_CUBE_MAP_* targets
+	const glm::vec3 directions[6] = { glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1) };
+	const glm::vec3 ups[6] = { glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0) };
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, farPlane);
+
+	ShadowPassState state(framebuffer, size, false);
+	shader.Activate();
+	// The fragment shader writes the distance to the light, not the depth of the projection
+	glUniform3fv(glGetUniformLocation(shader.ID, "lightPosition"), 1, glm::value_ptr(lightPosition));
+	glUniform1f(glGetUniformLocation(shader.ID, "shadowFar"), farPlane);
+	GLint matrixLocation = glGetUniformLocation(shader.ID, "lightMatrix");
+	GLint modelLocation = glGetUniformLocation(shader.ID, "model");
+	for (int face = 0; face < 6; face++)
+	{
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, texture, 0);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glm::mat4 lightMatrix = projection * glm::lookAt(lightPosition, lightPosition + directions[face], ups[face]);
+		glUniformMatrix4fv(matrixLocation, 1, GL_FALSE, glm::value_ptr(lightMatrix));
+		draw(modelLocation);
+	}
+	renders++;
+	return true;
+}
+
+void CubeShadowMap::SetFiltering(ShadowPCF pcf)
+{
+	setShadowFiltering(GL_TEXTURE_CUBE_MAP, texture, pcf);
+}
+
+void CubeShadowMap::Bind(GLuint unit)
+{
+	GLState::Current().ActiveTexture(GL_TEXTURE0 + unit);
+	GLState::Current().BindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	GLState::Current().ActiveTexture(GL_TEXTURE0);
+}
+
+void CubeShadowMap::Delete()
+{
+	glDeleteFramebuffers(1, &framebuffer);
+	GLState::Current().DeleteTextures(1, &texture);
+}
+
+CascadedShadowMap::CascadedShadowMap(int size, int cascades) : size(size), cascades(cascades)
+{
+	matrices.resize(cascades, glm::mat4(1.0f));
+	splits.resize(cascades, 0.0f);
+	valid.resize(cascades, false);
+
+	glGenTextures(1, &texture);
+	GLState::Current().BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, cascades, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GLState::Current().BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	SetFiltering(ShadowPCF::Hardware);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+int CascadedShadowMap::Update(Shader& shader, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float shadowDistance,
+	glm::vec3 lightDirection, unsigned int casterVersion, const DrawCasters& draw)
+{
+	bool castersMoved = casterVersion != cachedVersion;
+	cachedVersion = casterVersion;
+
+	glm::mat4 cameraToWorld = glm::inverse(view);
+	glm::vec3 direction = glm::normalize(lightDirection);
+	glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	// Rotation only, so a translation of the camera moves the cascades by whole texels
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+	std::vector<int> changed;
+	float sliceNear = nearPlane;
+	for (int i = 0; i < cascades; i++)
+	{
+		// Between logarithmic and uniform splits, the usual "practical" scheme
+		float t = (float)(i + 1) / cascades;
+		float logarithmic = nearPlane * std::pow(shadowDistance / nearPlane, t);
+		float uniform = nearPlane + (shadowDistance - nearPlane) * t;
+		float sliceFar = 0.75f * logarithmic + 0.25f * uniform;
+		splits[i] = sliceFar;
+
+		// Sphere around the corners of the slice, its size only depends on the projection so the texels keep their size
+		glm::vec3 corners[8];
+		glm::vec3 center(0.0f);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			float d = (corner & 4) ? sliceFar : sliceNear;
+			float x = (corner & 1) ? 1.0f : -1.0f;
+			float y = (corner & 2) ? 1.0f : -1.0f;
+			// Same relation as in ClusterGrid::SetProjection, valid for the reversed infinite projection too
+			corners[corner] = glm::vec3(cameraToWorld * glm::vec4(x * d / projection[0][0], y * d / projection[1][1], -d, 1.0f));
+			center += corners[corner] / 8.0f;
+		}
+		float radius = 0.0f;
+		for (const glm::vec3& corner : corners)
+		{
+			radius = std::max(radius, glm::length(corner - center));
+		}
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+		sliceNear = sliceFar;
+
+		// Snapped to whole texels across, and to quarters of the radius along the light, with that much margin
+		float texel = 2.0f * radius / size;
+		glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+		lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+		lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+		float depthStep = radius * 0.25f;
+		lightCenter.z = std::floor(lightCenter.z / depthStep) * depthStep;
+		glm::mat4 lightProjection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius,
+			-lightCenter.z - radius - depthStep, -lightCenter.z + radius + depthStep);
+
+		glm::mat4 matrix = lightProjection * lightView;
+		if (!valid[i] || castersMoved || matrix != matrices[i])
+		{
+			matrices[i] = matrix;
+			valid[i] = true;
+			changed.push_back(i);
+		}
+	}
+	if (changed.empty())
+	{
+		return 0;
+	}
+
+	ShadowPassState state(framebuffer, size, true);
+	shader.Activate();
+	GLint matrixLocation = glGetUniformLocation(shader.ID, "lightMatrix");
+	GLint modelLocation = glGetUniformLocation(shader.ID, "model");
+	for (int i : changed)
+	{
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, i);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glUniformMatrix4fv(matrixLocation, 1, GL_FALSE, glm::value_ptr(matrices[i]));
+		draw(modelLocation);
+	}
+	renders += (int)changed.size();
+	return (int)changed.size();
+}
+
+void CascadedShadowMap::SetFiltering(ShadowPCF pcf)
+{
+	setShadowFiltering(GL_TEXTURE_2D_ARRAY, texture, pcf);
+}
+
+void CascadedShadowMap::Bind(GLuint unit)
+{
+	GLState::Current().ActiveTexture(GL_TEXTURE0 + unit);
+	GLState::Current().BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	GLState::Current().ActiveTexture(GL_TEXTURE0);
+}
+
+void CascadedShadowMap::Delete()
+{
+	glDeleteFramebuffers(1, &framebuffer);
+	GLState::Current().DeleteTextures(1, &texture);
+}
@@ -0,0 +1,208 @@
+// texconv: converts an image to a precompiled .gtex container holding the whole mip chain
+// usage: texconv <input image> <output.gtex> [--rgb | --rgba] [--format bc1|bc3|bc5|bc7] [--preset fast|quality]
+//                [--filter box|kaiser] [--linear] [--bench]
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "stb_image.h"
+#include "textureContainer.h"
+#include "blockCompression.h"
+#include "jobSystem.h"
+#include "mipmap.h"
+
+// Megapixels per second for an image of width x height processed in ms
+static double megapixelsPerSecond(int width, int height, double ms)
+{
+	return (double)width * height / 1e6 / (ms / 1000.0);
+}
+
+// Times the mip chain generation of each filter, single threaded and on the workers
+static void benchmarkMips(const unsigned char* pixels, int width, int height, int channels, JobSystem& jobs)
+{
+	const int runs = 10;
+	const char* names[2] = { "box", "kaiser" };
+	MipFilter filters[2] = { MipFilter::Box, MipFilter::Kaiser };
+
+	for (int f = 0; f < 2; f++)
+	{
+		for (JobSystem* workers : { (JobSystem*)nullptr, &jobs })
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (int r = 0; r < runs; r++)
+			{
+				generateMipChain(pixels, width, height, channels, filters[f], true, workers);
+			}
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / runs;
+			std::cout << names[f] << ", " << (workers ? jobs.Size() + 1 : 1) << " thread(s): " << ms << " ms, "
+				<< megapixelsPerSecond(width, height, ms) << " MP/s" << std::endl;
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cout << "usage: texconv <input image> <output.gtex> [--rgb | --rgba] [--format bc1|bc3|bc5|bc7] [--preset fast|quality]"
+			<< " [--filter box|kaiser] [--linear] [--bench]" << std::endl;
+		return 1;
+	}
+
+	int channels = 4;
+	bool compressed = false;
+	BlockFormat blockFormat = BlockFormat::BC1;
+	CompressionPreset preset = CompressionPreset::Quality;
+	MipFilter filter = MipFilter::Box;
+	bool srgb = true;
+	bool bench = false;
+	for (int i = 3; i < argc; i++)
+	{
+		std::string option = argv[i];
+		std::string value = i + 1 < argc ? argv[i + 1] : "";
+		if (option == "--rgb")
+		{
+			channels = 3;
+		}
+		else if (option == "--rgba")
+		{
+			channels = 4;
+		}
+		else if (option == "--format")
+		{
+			compressed = true;
+			if (value == "bc1") blockFormat = BlockFormat::BC1;
+			else if (value == "bc3") blockFormat = BlockFormat::BC3;
+			else if (value == "bc5") blockFormat = BlockFormat::BC5;
+			else if (value == "bc7") blockFormat = BlockFormat::BC7;
+			else
+			{
+				std::cout << "unknown format " << value << std::endl;
+				return 1;
+			}
+			i++;
+		}
+		else if (option == "--preset")
+		{
+			if (value == "fast") preset = CompressionPreset::Fast;
+			else if (value == "quality") preset = CompressionPreset::Quality;
+			else
+			{
+				std::cout << "unknown preset " << value << std::endl;
+				return 1;
+			}
+			i++;
+		}
+		else if (option == "--filter")
+		{
+			if (value == "box") filter = MipFilter::Box;
+			else if (value == "kaiser") filter = MipFilter::Kaiser;
+			else
+			{
+				std::cout << "unknown filter " << value << std::endl;
+				return 1;
+			}
+			i++;
+		}
+		else if (option == "--linear")
+		{
+			// Data textures such as normal maps are not gamma encoded, implied by --format bc5
+			srgb = false;
+		}
+		else if (option == "--bench")
+		{
+			bench = true;
+		}
+		else
+		{
+			std::cout << "unknown option " << option << std::endl;
+			return 1;
+		}
+	}
+
+	// The block encoder always reads RGBA pixels
+	if (compressed)
+	{
+		channels = 4;
+	}
+	// BC5 holds normals or other two channel data, never gamma encoded colors
+	if (compressed && blockFormat == BlockFormat::BC5)
+	{
+		srgb = false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Same orientation as Texture, so the levels can go straight to glTexImage2D
+	stbi_set_flip_vertically_on_load(true);
+	int width, height, fileChannels;
+	unsigned char* bytes = stbi_load(argv[1], &width, &height, &fileChannels, channels);
+	if (bytes == nullptr)
+	{
+		std::cout << "failed loading " << argv[1] << ": " << stbi_failure_reason() << std::endl;
+		return 1;
+	}
+
+	JobSystem jobs;
+	if (bench)
+	{
+		std::cout << "mip generation, " << width << "x" << height << ", " << mipmapInstructionSet() << std::endl;
+		benchmarkMips(bytes, width, height, channels, jobs);
+	}
+
+	// Builds the chain down to 1x1
+	auto mipStart = std::chrono::steady_clock::now();
+	std::vector<TextureContainerImage> levels = generateMipChain(bytes, width, height, channels, filter, srgb, &jobs);
+	double mipMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mipStart).count();
+	stbi_image_free(bytes);
+	std::cout << "mips: " << mipMs << " ms, " << megapixelsPerSecond(width, height, mipMs) << " MP/s ("
+		<< mipmapInstructionSet() << ", " << jobs.Size() + 1 << " threads)" << std::endl;
+
+	TextureContainerHeader header = {};
+	header.width = width;
+	header.height = height;
+	header.internalFormat = channels == 4 ? GL_RGBA8 : GL_RGB8;
+	header.format = channels == 4 ? GL_RGBA : GL_RGB;
+	header.pixelType = GL_UNSIGNED_BYTE;
+	header.channels = channels;
+
+	if (compressed)
+	{
+		size_t rawBytes = 0, compressedBytes = 0;
+		for (size_t level = 0; level < levels.size(); level++)
+		{
+			TextureContainerImage& image = levels[level];
+			std::vector<unsigned char> blocks = compressImage(image.pixels.data(), image.width, image.height, blockFormat, preset, &jobs);
+
+			// Quality of the full resolution level is what the viewer sees up close
+			if (level == 0)
+			{
+				std::vector<unsigned char> decoded(image.pixels.size());
+				decompressImage(blocks.data(), image.width, image.height, blockFormat, decoded.data());
+				std::cout << "PSNR: " << computePSNR(image.pixels.data(), decoded.data(), image.width, image.height, blockFormat) << " dB" << std::endl;
+			}
+
+			rawBytes += image.pixels.size();
+			compressedBytes += blocks.size();
+			image.pixels = std::move(blocks);
+		}
+		std::cout << "compressed " << rawBytes << " -> " << compressedBytes << " bytes" << std::endl;
+
+		// A zero format tells the loader to use glCompressedTexImage2D
+		header.internalFormat = blockInternalFormat(blockFormat);
+		header.format = 0;
+		header.pixelType = 0;
+	}
+
+	if (!writeTextureContainer(argv[2], header, levels))
+	{
+		std::cout << "failed writing " << argv[2] << std::endl;
+		return 1;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << argv[2] << ": " << width << "x" << height << ", " << levels.size() << " levels, " << ms << " ms" << std::endl;
+	return 0;
+}
@@ -1,7 +1,31 @@
 #include "texture.h"
+#include "glState.h"
+#include "cpuProfiler.h"
+#include "textureContainer.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Checks the driver can sample a block compressed format
+static bool compressedFormatSupported(GLenum internalFormat)
+{
+	switch (internalFormat)
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return GLEW_EXT_texture_compression_s3tc;
+	case GL_COMPRESSED_RG_RGTC2:
+		return GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc;
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+	default:
+		return false;
+	}
+}
 
 Texture::Texture(const char* image, GLenum texType, GLenum slot, GLenum format, GLenum pixelType)
 {
+	PROFILE_ZONE("Texture::Texture");
 	// Assigns the type of the texture ot the texture object
 	type = texType;
 
@@ -9,14 +33,14 @@ Texture::Texture(const char* image, GLenum texType, GLenum slot, GLenum format,
 	int widthImg, heightImg, numColCh;
 	// Flips the image so it appears right side up
 	stbi_set_flip_vertically_on_load(true);
-	// Reads the image from a file and stores it in bytes
-	unsigned char* bytes = stbi_load(image, &widthImg, &heightImg, &numColCh, 0);
+	// Reads the image from a file and stores it in bytes, with the channels format describes
+	unsigned char* bytes = stbi_load(image, &widthImg, &heightImg, &numColCh, channelsForFormat(format));
 
 	// Generates an OpenGL texture object
 	glGenTextures(1, &ID);
 	// Assigns the texture to a Texture Unit
-	glActiveTexture(slot);
-	glBindTexture(texType, ID);
+	GLState::Current().ActiveTexture(slot);
+	GLState::Current().BindTexture(texType, ID);
 
 	// Configures the type of algorithm that is used to make the image smaller or bigger
 	glTexParameteri(texType, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
@@ -30,8 +54,10 @@ Texture::Texture(const char* image, GLenum texType, GLenum slot, GLenum format,
 	// float flatColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
 	// glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, flatColor);
 
-	// Assigns the image to the OpenGL Texture object
-	glTexImage2D(texType, 0, GL_RGBA, widthImg, heightImg, 0, format, pixelType, bytes);
+	// Assigns the image to the OpenGL Texture object, without padding RGB images to RGBA
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(texType, 0, internalFormatFor(format), widthImg, heightImg, 0, format, pixelType, bytes);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 	// Generates MipMaps
 	glGenerateMipmap(texType);
 
@@ -39,7 +65,117 @@ Texture::Texture(const char* image, GLenum texType, GLenum slot, GLenum format,
 	stbi_image_free(bytes);
 
 	// Unbinds the OpenGL Texture object so that it can't accidentally be modified
-	glBindTexture(texType, 0);
+	GLState::Current().BindTexture(texType, 0);
+}
+
+Texture::Texture(GLenum texType, GLenum slot)
+{
+	PROFILE_ZONE("Texture::Texture (placeholder)");
+	type = texType;
+
+	// Magenta and black checker so a missing texture is obvious on screen
+	unsigned char placeholder[] = {
+		255, 0, 255, 255,   0, 0, 0, 255,
+		0, 0, 0, 255,       255, 0, 255, 255,
+	};
+
+	glGenTextures(1, &ID);
+	GLState::Current().ActiveTexture(slot);
+	GLState::Current().BindTexture(texType, ID);
+
+	// No mipmaps for the placeholder, the real image brings its own
+	glTexParameteri(texType, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(texType, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(texType, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(texType, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	glTexImage2D(texType, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+	GLState::Current().BindTexture(texType, 0);
+}
+
+Texture::Texture(const char* container, GLenum texType, GLenum slot)
+{
+	PROFILE_ZONE("Texture::Texture (container)");
+	type = texType;
+
+	glGenTextures(1, &ID);
+	GLState::Current().ActiveTexture(slot);
+	GLState::Current().BindTexture(texType, ID);
+
+	glTexParameteri(texType, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glTexParameteri(texType, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(texType, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(texType, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	uploadTextureContainer(container, texType);
+	GLState::Current().BindTexture(texType, 0);
+}
+
+size_t uploadTextureContainer(const char* container, GLenum texType, uint32_t firstLevel)
+{
+	MappedFile file;
+	const TextureContainerHeader* header;
+	const TextureContainerLevel* levels;
+	if (!file.Open(container) || !parseTextureContainer(file.data, file.size, header, levels))
+	{
+		std::cout << "failed loading texture container " << container << std::endl;
+		file.Close();
+		return 0;
+	}
+
+	if (header->format == 0 && !compressedFormatSupported(header->internalFormat))
+	{
+		std::cout << "texture container " << container << " uses a compressed format this driver can't sample" << std::endl;
+		file.Close();
+		return 0;
+	}
+
+	// Never skips the last level
+	firstLevel = std::min(firstLevel, header->levelCount - 1);
+
+	size_t bytes = 0;
+	// Levels are tightly packed, whatever the channel count
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (uint32_t level = firstLevel; level < header->levelCount; level++)
+	{
+		// Reads straight from the mapping, the pages are only faulted in by the upload
+		const unsigned char* pixels = file.data + levels[level].offset;
+		GLint target = level - firstLevel;
+		if (header->format == 0)
+		{
+			glCompressedTexImage2D(texType, target, header->internalFormat, levels[level].width, levels[level].height, 0,
+				(GLsizei)levels[level].size, pixels);
+		}
+		else
+		{
+			glTexImage2D(texType, target, header->internalFormat, levels[level].width, levels[level].height, 0,
+				header->format, header->pixelType, pixels);
+		}
+		bytes += levels[level].size;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(texType, GL_TEXTURE_MAX_LEVEL, header->levelCount - firstLevel - 1);
+
+	file.Close();
+	return bytes;
+}
+
+size_t uploadMipChain(GLenum texType, const std::vector<TextureContainerImage>& levels, GLenum format, uint32_t firstLevel)
+{
+	firstLevel = std::min(firstLevel, (uint32_t)levels.size() - 1);
+
+	size_t bytes = 0;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (uint32_t level = firstLevel; level < levels.size(); level++)
+	{
+		glTexImage2D(texType, level - firstLevel, internalFormatFor(format), levels[level].width, levels[level].height, 0,
+			format, GL_UNSIGNED_BYTE, levels[level].pixels.data());
+		bytes += levels[level].pixels.size();
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(texType, GL_TEXTURE_MAX_LEVEL, (GLint)(levels.size() - firstLevel - 1));
+	return bytes;
 }
 
 void Texture::texUnit(Shader& shader, const char* uniform, GLuint unit)
@@ -54,15 +190,39 @@ void Texture::texUnit(Shader& shader, const char* uniform, GLuint unit)
 
 void Texture::Bind()
 {
-	glBindTexture(type, ID);
+	GLState::Current().BindTexture(type, ID);
 }
 
 void Texture::Unbind()
 {
-	glBindTexture(type, 0);
+	GLState::Current().BindTexture(type, 0);
 }
 
 void Texture::Delete()
 {
-	glDeleteTextures(1, &ID);
+	GLState::Current().DeleteTextures(1, &ID);
+}
+
+GLenum internalFormatFor(GLenum format)
+{
+	switch (format)
+	{
+	case GL_RED: return GL_R8;
+	case GL_RG: return GL_RG8;
+	case GL_RGB: return GL_RGB8;
+	default: return GL_RGBA8;
+	}
+}
+
+int channelsForFormat(GLenum format)
+{
+	switch (format)
+	{
+	case GL_RED: return 1;
+	case GL_RG: return 2;
+	case GL_RGB: return 3;
+	case GL_RGBA: return 4;
+	// Keeps whatever the file contains
+	default: return 0;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "textureArray.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "stb_image.h"
+#include "glState.h"
+#include "mipmap.h"
+
+// Empty pixels around each image so filtering and mipmaps don't bleed between neighbours
+const int GUTTER = 4;
+// Mip levels past the base one, the gutter halves with each and is gone after log2(GUTTER)
+const int GUTTER_LEVELS = 2;
+
+struct PackedImage
+{
+	unsigned char* bytes;
+	int width;
+	int height;
+	int layer;
+	int x;
+	int y;
+};
+
+// Row of images sharing the same top, filled left to right
+struct Shelf
+{
+	int layer;
+	int y;
+	int height;
+	int usedWidth;
+};
+
+// Shelf packing, tallest images first so each shelf wastes little height
+static int packImages(std::vector<PackedImage>& images, int size)
+{
+	std::vector<size_t> order(images.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return images[a].height > images[b].height; });
+
+	std::vector<Shelf> shelves;
+	std::vector<int> layerHeights;
+	for (size_t i : order)
+	{
+		PackedImage& image = images[i];
+		int w = image.width + 2 * GUTTER;
+		int h = image.height + 2 * GUTTER;
+
+		Shelf* target = nullptr;
+		for (Shelf& shelf : shelves)
+		{
+			if (h <= shelf.height && shelf.usedWidth + w <= size)
+			{
+				target = &shelf;
+				break;
+			}
+		}
+
+		if (target == nullptr)
+		{
+			// Opens a shelf under the last one of a layer with room left, or a new layer
+			int layer = 0;
+			while (layer < (int)layerHeights.size() && layerHeights[layer] + h > size)
+			{
+				layer++;
+			}
+			if (layer == (int)layerHeights.size())
+			{
+				layerHeights.push_back(0);
+			}
+			shelves.push_back({ layer, layerHeights[layer], h, 0 });
+			layerHeights[layer] += h;
+			target = &shelves.back();
+		}
+
+		image.layer = target->layer;
+		image.x = target->usedWidth + GUTTER;
+		image.y = target->y + GUTTER;
+		target->usedWidth += w;
+	}
+	return (int)layerHeights.size();
+}
+
+TextureArray::TextureArray(const std::vector<const char*>& images, int layerSize, GLenum slot, JobSystem* jobs)
+{
+	// Same orientation as Texture
+	stbi_set_flip_vertically_on_load(true);
+
+	std::vector<PackedImage> packed;
+	size = layerSize;
+	for (const char* image : images)
+	{
+		PackedImage entry = {};
+		int channels;
+		entry.bytes = stbi_load(image, &entry.width, &entry.height, &channels, 4);
+		if (entry.bytes == nullptr)
+		{
+			std::cout << "failed loading texture " << image << ": " << stbi_failure_reason() << std::endl;
+			// Keeps the regions in order with a 1x1 white image
+			entry.bytes = (unsigned char*)malloc(4);
+			memset(entry.bytes, 255, 4);
+			entry.width = entry.height = 1;
+		}
+		// Grows the layers so the largest image fits
+		size = std::max(size, std::max(entry.width, entry.height) + 2 * GUTTER);
+		packed.push_back(entry);
+	}
+
+	layers = std::max(1, packImages(packed, size));
+
+	// Copies the images in their layers, replicating their edges into the gutter
+	std::vector<unsigned char> pixels((size_t)size * size * layers * 4, 0);
+	for (const PackedImage& image : packed)
+	{
+		unsigned char* layer = pixels.data() + (size_t)image.layer * size * size * 4;
+		for (int y = -GUTTER; y < image.height + GUTTER; y++)
+		{
+			int sy = std::min(image.height - 1, std::max(0, y));
+			for (int x = -GUTTER; x < image.width + GUTTER; x++)
+			{
+				int sx = std::min(image.width - 1, std::max(0, x));
+				memcpy(layer + ((size_t)(image.y + y) * size + image.x + x) * 4, image.bytes + ((size_t)sy * image.width + sx) * 4, 4);
+			}
+		}
+
+		TextureRegion region;
+		region.layer = image.layer;
+		region.offset = glm::vec2((float)image.x / size, (float)image.y / size);
+		region.scale = glm::vec2((float)image.width / size, (float)image.height / size);
+		regions.push_back(region);
+		stbi_image_free(image.bytes);
+	}
+
+	glGenTextures(1, &ID);
+	GLState::Current().ActiveTexture(slot);
+	GLState::Current().BindTexture(type, ID);
+
+	glTexParameteri(type, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glTexParameteri(type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	// Regions can't repeat inside a layer
+	glTexParameteri(type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(type, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// The mips of every layer are averaged in linear space like the other textures, then uploaded level by level
+	// with the layers one after the other
+	int levels = 1 + GUTTER_LEVELS;
+	std::vector<std::vector<unsigned char>> levelPixels(levels);
+	for (int layer = 0; layer < layers; layer++)
+	{
+		std::vector<TextureContainerImage> chain = generateMipChain(pixels.data() + (size_t)layer * size * size * 4, size, size, 4, MipFilter::Box, true, jobs, levels);
+		levels = std::min(levels, (int)chain.size());
+		for (int level = 0; level < levels; level++)
+		{
+			levelPixels[level].insert(levelPixels[level].end(), chain[level].pixels.begin(), chain[level].pixels.end());
+		}
+	}
+	for (int level = 0; level < levels; level++)
+	{
+		int levelSize = std::max(1, size >> level);
+		glTexImage3D(type, level, GL_RGBA8, levelSize, levelSize, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, levelPixels[level].data());
+	}
+	// Past these the neighbours would bleed into each other
+	glTexParameteri(type, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+	GLState::Current().BindTexture(type, 0);
+}
+
+void TextureArray::texUnit(Shader& shader, const char* uniform, GLuint unit)
+{
+	GLuint texUni = glGetUniformLocation(shader.ID, uniform);
+	shader.Activate();
+	glUniform1i(texUni, unit);
+}
+
+void TextureArray::Bind()
+{
+	GLState::Current().BindTexture(type, ID);
+}
+
+void TextureArray::Unbind()
+{
+	GLState::Current().BindTexture(type, 0);
+}
+
+void TextureArray::Delete()
+{
+	GLState::Current().DeleteTextures(1, &ID);
+}
+
+void remapUVs(GLfloat* vertices, size_t vertexCount, int stride, int uvOffset, const TextureRegion& region)
+{
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		GLfloat* uv = vertices + i * stride + uvOffset;
+		uv[0] = region.offset.x + uv[0] * region.scale.x;
+		uv[1] = region.offset.y + uv[1] * region.scale.y;
+	}
+}
@@ -0,0 +1,303 @@
+#include "textureCache.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "texture.h"
+#include "mipmap.h"
+#include "glState.h"
+
+// Top levels are dropped down to this size before a texture is evicted completely
+const uint32_t MIN_REDUCED_SIZE = 16;
+
+TextureCache::TextureCache(size_t budgetBytes) : budget(budgetBytes)
+{
+}
+
+int TextureCache::Add(const char* path, GLenum texType, GLenum format)
+{
+	Entry entry;
+	entry.path = path;
+	entry.type = texType;
+	entry.format = format;
+	entries.push_back(entry);
+	return (int)entries.size() - 1;
+}
+
+void TextureCache::Load(Entry& entry, uint32_t firstLevel)
+{
+	if (entry.ID != 0)
+	{
+		GLState::Current().DeleteTextures(1, &entry.ID);
+		resident -= entry.bytes;
+	}
+
+	glGenTextures(1, &entry.ID);
+	GLState::Current().BindTexture(entry.type, entry.ID);
+	glTexParameteri(entry.type, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glTexParameteri(entry.type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(entry.type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(entry.type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	bool container = entry.path.size() > 5 && entry.path.compare(entry.path.size() - 5, 5, ".gtex") == 0;
+	if (container)
+	{
+		// Cheap to reload: the levels are mapped and uploaded as they are
+		entry.bytes = uploadTextureContainer(entry.path.c_str(), entry.type, firstLevel);
+	}
+	else
+	{
+		// Decoding and filtering would stall the frame, it is only done the first time
+		if (entry.mips.empty())
+		{
+			stbi_set_flip_vertically_on_load(true);
+			int width, height, channels;
+			unsigned char* bytes = stbi_load(entry.path.c_str(), &width, &height, &channels, channelsForFormat(entry.format));
+			if (bytes == nullptr)
+			{
+				std::cout << "failed loading texture " << entry.path << ": " << stbi_failure_reason() << std::endl;
+			}
+			else
+			{
+				int decodedChannels = channelsForFormat(entry.format) != 0 ? channelsForFormat(entry.format) : channels;
+				entry.mips = generateMipChain(bytes, width, height, decodedChannels, MipFilter::Box, true);
+				stbi_image_free(bytes);
+			}
+		}
+		entry.bytes = entry.mips.empty() ? 0 : uploadMipChain(entry.type, entry.mips, entry.format, firstLevel);
+	}
+
+	// The upload clamps firstLevel, the level count comes back from the texture itself
+	GLint maxLevel = 0;
+	glGetTexParameteriv(entry.type, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+	entry.firstLevel = entry.bytes > 0 ? firstLevel : 0;
+	entry.levelCount = entry.firstLevel + maxLevel + 1;
+	if (entry.firstLevel == 0)
+	{
+		entry.fullBytes = entry.bytes;
+	}
+
+	resident += entry.bytes;
+	peak = std::max(peak, resident);
+}
+
+// Bytes of one pixel of the uncompressed internal formats the textures are loaded with
+static size_t bytesPerPixel(GLint internalFormat)
+{
+	switch (internalFormat)
+	{
+	case GL_R8: return 1;
+	case GL_RG8: return 2;
+	case GL_RGB8: case GL_SRGB8: return 3;
+	default: return 4;
+	}
+}
+
+bool TextureCache::DropTopLevel(Entry& entry)
+{
+	if (!(GLEW_VERSION_4_3 || GLEW_ARB_copy_image) || entry.firstLevel + 1 >= entry.levelCount)
+	{
+		return false;
+	}
+
+	// Sizes of the levels kept, read from the texture itself so it works for containers and images alike
+	GLState::Current().BindTexture(entry.type, entry.ID);
+	GLint internalFormat = 0, compressed = GL_FALSE;
+	glGetTexLevelParameteriv(entry.type, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+	glGetTexLevelParameteriv(entry.type, 0, GL_TEXTURE_COMPRESSED, &compressed);
+	uint32_t count = entry.levelCount - entry.firstLevel;
+	std::vector<GLint> widths(count), heights(count), sizes(count);
+	for (uint32_t level = 0; level < count; level++)
+	{
+		glGetTexLevelParameteriv(entry.type, level, GL_TEXTURE_WIDTH, &widths[level]);
+		glGetTexLevelParameteriv(entry.type, level, GL_TEXTURE_HEIGHT, &heights[level]);
+		if (compressed)
+		{
+			glGetTexLevelParameteriv(entry.type, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &sizes[level]);
+		}
+		else
+		{
+			sizes[level] = (GLint)(widths[level] * heights[level] * bytesPerPixel(internalFormat));
+		}
+	}
+
+	GLuint reduced;
+	glGenTextures(1, &reduced);
+	GLState::Current().BindTexture(entry.type, reduced);
+	glTexParameteri(entry.type, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glTexParameteri(entry.type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(entry.type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(entry.type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(entry.type, GL_TEXTURE_MAX_LEVEL, count - 2);
+	size_t bytes = 0;
+	for (uint32_t level = 1; level < count; level++)
+	{
+		// Allocated empty, the copy needs the whole chain in place
+		if (compressed)
+		{
+			glCompressedTexImage2D(entry.type, level - 1, internalFormat, widths[level], heights[level], 0, sizes[level], nullptr);
+		}
+		else
+		{
+			glTexImage2D(entry.type, level - 1, internalFormat, widths[level], heights[level], 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+		bytes += sizes[level];
+	}
+	// Filled from the old texture without leaving the GPU
+	for (uint32_t level = 1; level < count; level++)
+	{
+		glCopyImageSubData(entry.ID, entry.type, level, 0, 0, 0, reduced, entry.type, level - 1, 0, 0, 0, widths[level], heights[level], 1);
+	}
+
+	GLState::Current().DeleteTextures(1, &entry.ID);
+	entry.ID = reduced;
+	resident -= entry.bytes;
+	entry.bytes = bytes;
+	resident += entry.bytes;
+	entry.firstLevel++;
+	return true;
+}
+
+size_t TextureCache::RestoredBytes(const Entry& entry) const
+{
+	if (!entry.mips.empty())
+	{
+		size_t bytes = 0;
+		for (size_t level = entry.firstLevel - 1; level < entry.mips.size(); level++)
+		{
+			bytes += entry.mips[level].pixels.size();
+		}
+		return bytes;
+	}
+	// A level holds about three times the ones below it together
+	return std::min(entry.fullBytes, entry.bytes * 4);
+}
+
+void TextureCache::NextFrame()
+{
+	frame++;
+
+	// One level of one texture per frame, so restoring never costs more than an upload of that level
+	Entry* restored = nullptr;
+	for (Entry& entry : entries)
+	{
+		if (entry.ID != 0 && entry.firstLevel > 0 && (restored == nullptr || entry.lastUse > restored->lastUse))
+		{
+			restored = &entry;
+		}
+	}
+	if (restored != nullptr && resident - restored->bytes + RestoredBytes(*restored) <= budget)
+	{
+		Load(*restored, restored->firstLevel - 1);
+		reloads++;
+		GLState::Current().BindTexture(restored->type, 0);
+	}
+}
+
+void TextureCache::Bind(int handle)
+{
+	Entry& entry = entries[handle];
+	entry.lastUse = frame;
+
+	if (entry.ID == 0)
+	{
+		// Back at the resolution it was evicted with, NextFrame restores the top levels once there is room
+		if (entry.fullBytes > 0)
+		{
+			reloads++;
+		}
+		Load(entry, entry.firstLevel);
+		Enforce();
+	}
+
+	GLState::Current().BindTexture(entry.type, entry.ID);
+}
+
+void TextureCache::SetBudget(size_t budgetBytes)
+{
+	budget = budgetBytes;
+	Enforce();
+}
+
+void TextureCache::Enforce()
+{
+	while (resident > budget)
+	{
+		// Least recently bound texture that still holds memory and wasn't used this frame
+		Entry* victim = nullptr;
+		for (Entry& entry : entries)
+		{
+			if (entry.ID != 0 && entry.lastUse < frame && (victim == nullptr || entry.lastUse < victim->lastUse))
+			{
+				victim = &entry;
+			}
+		}
+		if (victim == nullptr)
+		{
+			// Everything resident is in use this frame, the stats will show the overshoot
+			return;
+		}
+
+		// Halving a texture frees three quarters of it, so drop top levels before evicting
+		GLint width = 0, height = 0;
+		GLState::Current().BindTexture(victim->type, victim->ID);
+		glGetTexLevelParameteriv(victim->type, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(victim->type, 0, GL_TEXTURE_HEIGHT, &height);
+		if (victim->firstLevel + 1 < victim->levelCount && (uint32_t)std::max(width, height) > MIN_REDUCED_SIZE)
+		{
+			if (!DropTopLevel(*victim))
+			{
+				Load(*victim, victim->firstLevel + 1);
+			}
+			mipDrops++;
+		}
+		else
+		{
+			GLState::Current().DeleteTextures(1, &victim->ID);
+			victim->ID = 0;
+			resident -= victim->bytes;
+			victim->bytes = 0;
+			evictions++;
+		}
+		GLState::Current().BindTexture(victim->type, 0);
+	}
+}
+
+TextureCacheStats TextureCache::Stats() const
+{
+	TextureCacheStats stats = {};
+	stats.budgetBytes = budget;
+	stats.residentBytes = resident;
+	stats.peakBytes = peak;
+	stats.textures = (unsigned int)entries.size();
+	stats.evictions = evictions;
+	stats.mipDrops = mipDrops;
+	stats.reloads = reloads;
+	for (const Entry& entry : entries)
+	{
+		stats.fullBytes += entry.fullBytes;
+		if (entry.ID != 0)
+		{
+			stats.residentTextures++;
+			if (entry.firstLevel > 0)
+			{
+				stats.reducedTextures++;
+			}
+		}
+	}
+	return stats;
+}
+
+void TextureCache::Delete()
+{
+	for (Entry& entry : entries)
+	{
+		if (entry.ID != 0)
+		{
+			GLState::Current().DeleteTextures(1, &entry.ID);
+			entry.ID = 0;
+		}
+		entry.mips.clear();
+	}
+	resident = 0;
+}
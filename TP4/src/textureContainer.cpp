@@ -0,0 +1,240 @@
+#include "textureContainer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Rounds an offset up to the next level alignment
+static uint64_t alignLevel(uint64_t offset)
+{
+	return (offset + 15) & ~(uint64_t)15;
+}
+
+bool writeTextureContainer(const char* path, TextureContainerHeader header, const std::vector<TextureContainerImage>& levels)
+{
+	memcpy(header.magic, TEXTURE_CONTAINER_MAGIC, sizeof(header.magic));
+	header.version = TEXTURE_CONTAINER_VERSION;
+	header.levelCount = (uint32_t)levels.size();
+
+	// Lays out the level table before writing anything
+	std::vector<TextureContainerLevel> table(levels.size());
+	uint64_t offset = alignLevel(sizeof(header) + table.size() * sizeof(TextureContainerLevel));
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		table[i].offset = offset;
+		table[i].size = levels[i].pixels.size();
+		table[i].width = levels[i].width;
+		table[i].height = levels[i].height;
+		offset = alignLevel(offset + table[i].size);
+	}
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && fwrite(table.data(), sizeof(TextureContainerLevel), table.size(), file) == table.size();
+
+	const unsigned char padding[16] = {};
+	for (size_t i = 0; ok && i < levels.size(); i++)
+	{
+		size_t gap = (size_t)(table[i].offset - (uint64_t)ftell(file));
+		ok = fwrite(padding, 1, gap, file) == gap;
+		ok = ok && fwrite(levels[i].pixels.data(), 1, levels[i].pixels.size(), file) == levels[i].pixels.size();
+	}
+
+	return fclose(file) == 0 && ok;
+}
+
+// Bytes a width x height level takes in the format of header, 0 for a format the loader doesn't know
+static uint64_t expectedLevelSize(const TextureContainerHeader& header, uint64_t width, uint64_t height)
+{
+	if (header.format == 0)
+	{
+		// Compressed, 4x4 blocks of 8 or 16 bytes
+		uint64_t blocks = ((width + 3) / 4) * ((height + 3) / 4);
+		switch (header.internalFormat)
+		{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RED_RGTC1:
+			return blocks * 8;
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_RG_RGTC2:
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+			return blocks * 16;
+		default:
+			return 0;
+		}
+	}
+
+	uint64_t components;
+	switch (header.format)
+	{
+	case GL_RED: components = 1; break;
+	case GL_RG: components = 2; break;
+	case GL_RGB: components = 3; break;
+	case GL_RGBA: components = 4; break;
+	default: return 0;
+	}
+	uint64_t componentBytes;
+	switch (header.pixelType)
+	{
+	case GL_UNSIGNED_BYTE: componentBytes = 1; break;
+	case GL_UNSIGNED_SHORT:
+	case GL_HALF_FLOAT: componentBytes = 2; break;
+	case GL_FLOAT: componentBytes = 4; break;
+	default: return 0;
+	}
+	// Rows are tightly packed, the loader uploads with an unpack alignment of 1
+	return width * height * components * componentBytes;
+}
+
+bool parseTextureContainer(const unsigned char* data, size_t size, const TextureContainerHeader*& header, const TextureContainerLevel*& levels)
+{
+	if (data == nullptr || size < sizeof(TextureContainerHeader))
+	{
+		return false;
+	}
+
+	header = reinterpret_cast<const TextureContainerHeader*>(data);
+	if (memcmp(header->magic, TEXTURE_CONTAINER_MAGIC, sizeof(header->magic)) != 0 || header->version != TEXTURE_CONTAINER_VERSION)
+	{
+		return false;
+	}
+	// A full chain of a 2^31 texture has 32 levels
+	if (header->width == 0 || header->height == 0 || header->levelCount > 32)
+	{
+		return false;
+	}
+	if (header->levelCount == 0 || sizeof(TextureContainerHeader) + header->levelCount * sizeof(TextureContainerLevel) > size)
+	{
+		return false;
+	}
+
+	levels = reinterpret_cast<const TextureContainerLevel*>(data + sizeof(TextureContainerHeader));
+	for (uint32_t i = 0; i < header->levelCount; i++)
+	{
+		// Rejects truncated files instead of reading past the mapping
+		if (levels[i].offset > size || levels[i].size > size - levels[i].offset)
+		{
+			return false;
+		}
+		// and levels holding less than their size and format need, which GL would read past the mapping too
+		if (levels[i].width != std::max(1u, header->width >> i) || levels[i].height != std::max(1u, header->height >> i))
+		{
+			return false;
+		}
+		uint64_t expected = expectedLevelSize(*header, levels[i].width, levels[i].height);
+		if (expected == 0 || levels[i].size != expected)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path)
+{
+	fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		fileHandle = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(fileHandle, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle != nullptr)
+	{
+		data = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != nullptr)
+	{
+		CloseHandle(fileHandle);
+	}
+	data = nullptr;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+	size = 0;
+}
+
+#else
+
+bool MappedFile::Open(const char* path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || status.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+	size = (size_t)status.st_size;
+
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file alive on its own
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		size = 0;
+		return false;
+	}
+
+	// Levels are read front to back once, so let the kernel read ahead
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	data = (const unsigned char*)mapping;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != nullptr)
+	{
+		munmap((void*)data, size);
+	}
+	data = nullptr;
+	size = 0;
+}
+
+#endif
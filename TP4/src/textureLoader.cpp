@@ -0,0 +1,162 @@
+#include "textureLoader.h"
+#include "glState.h"
+#include "cpuProfiler.h"
+#include "mipmap.h"
+
+#include <cstring>
+#include <iostream>
+
+TextureLoader::TextureLoader(JobSystem& jobs, unsigned int numPBOs) : jobs(jobs)
+{
+	PBOs.resize(numPBOs > 0 ? numPBOs : 1);
+	glGenBuffers((GLsizei)PBOs.size(), PBOs.data());
+}
+
+Texture TextureLoader::Load(const char* image, GLenum texType, GLenum slot, GLenum format, GLenum pixelType)
+{
+	// The texture object exists right away so it can be bound while the image decodes
+	Texture texture(texType, slot);
+
+	Request request;
+	request.ID = texture.ID;
+	request.type = texType;
+	request.format = format;
+	request.pixelType = pixelType;
+	request.path = image;
+
+	int channels = channelsForFormat(format);
+	std::string path = image;
+	JobSystem* workers = &jobs;
+	request.image = jobs.Submit([path, channels, workers]()
+	{
+		PROFILE_ZONE("decode image");
+		DecodedImage decoded;
+		// The flip flag is global in stb_image, so each worker sets its own copy
+		stbi_set_flip_vertically_on_load_thread(true);
+		int width, height, fileChannels;
+		unsigned char* bytes = stbi_load(path.c_str(), &width, &height, &fileChannels, channels);
+		if (bytes == nullptr)
+		{
+			decoded.error = stbi_failure_reason();
+			return decoded;
+		}
+
+		// Gamma correct mips, filtered here rather than by the driver on the GL thread. The rows are split over
+		// the idle workers, this one runs the others' jobs while it waits so a large image doesn't hold one worker
+		decoded.levels = generateMipChain(bytes, width, height, channels != 0 ? channels : fileChannels, MipFilter::Box, true, workers);
+		stbi_image_free(bytes);
+		return decoded;
+	});
+
+	requests.push_back(std::move(request));
+	return texture;
+}
+
+unsigned int TextureLoader::Update(unsigned int maxUploads)
+{
+	unsigned int uploaded = 0;
+
+	for (size_t i = 0; i < requests.size();)
+	{
+		if (maxUploads != 0 && uploaded >= maxUploads)
+		{
+			break;
+		}
+
+		// Skips the images that are still decoding
+		if (requests[i].image.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			i++;
+			continue;
+		}
+
+		DecodedImage image = requests[i].image.get();
+		Upload(requests[i], image);
+
+		requests[i] = std::move(requests.back());
+		requests.pop_back();
+		uploaded++;
+	}
+
+	return uploaded;
+}
+
+void TextureLoader::Finish()
+{
+	while (!requests.empty())
+	{
+		requests.front().image.wait();
+		Update();
+	}
+}
+
+void TextureLoader::Upload(Request& request, DecodedImage& image)
+{
+	PROFILE_ZONE("upload image");
+	if (image.levels.empty())
+	{
+		// Keeps the placeholder so the failure shows on screen
+		std::cout << "failed loading texture " << request.path << ": " << image.error << std::endl;
+		return;
+	}
+
+	// Every level goes in the same buffer, one after the other
+	std::vector<GLsizeiptr> offsets;
+	GLsizeiptr size = 0;
+	for (const TextureContainerImage& level : image.levels)
+	{
+		offsets.push_back(size);
+		size += (GLsizeiptr)level.pixels.size();
+	}
+
+	// Cycles through the ring so the driver can still be reading the previous buffers
+	GLuint PBO = PBOs[nextPBO];
+	nextPBO = (nextPBO + 1) % PBOs.size();
+
+	GLState::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+	// Orphans the previous storage instead of waiting for it to be consumed
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped == nullptr)
+	{
+		GLState::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		std::cout << "failed mapping the upload buffer for " << request.path << std::endl;
+		return;
+	}
+	for (size_t level = 0; level < image.levels.size(); level++)
+	{
+		memcpy(mapped + offsets[level], image.levels[level].pixels.data(), image.levels[level].pixels.size());
+	}
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	GLState::Current().BindTexture(request.type, request.ID);
+	glTexParameteri(request.type, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glTexParameteri(request.type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// RGB rows are not always 4 bytes aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t level = 0; level < image.levels.size(); level++)
+	{
+		// With a bound unpack buffer the last argument is an offset into it
+		glTexImage2D(request.type, (GLint)level, internalFormatFor(request.format), image.levels[level].width, image.levels[level].height, 0,
+			request.format, request.pixelType, (void*)offsets[level]);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(request.type, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+
+	GLState::Current().BindTexture(request.type, 0);
+	GLState::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureLoader::Delete()
+{
+	// Waits for the workers before dropping their results
+	for (Request& request : requests)
+	{
+		request.image.wait();
+	}
+	requests.clear();
+
+	GLState::Current().DeleteBuffers((GLsizei)PBOs.size(), PBOs.data());
+	PBOs.clear();
+}